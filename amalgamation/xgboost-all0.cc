@@ -29,7 +29,9 @@
 
 // data
 #include "../src/data/data.cc"
+#include "../src/data/dense_dmatrix.cc"
 #include "../src/data/diff_dmatrix.cc"
+#include "../src/data/mapped_dmatrix.cc"
 #include "../src/data/reconfigurable_matrix.cc"
 #include "../src/data/reconfigurable_source.cc"
 #include "../src/data/simple_csr_source.cc"
@@ -67,6 +69,7 @@
 #include "../src/learner.cc"
 #include "../src/logging.cc"
 #include "../src/common/common.cc"
+#include "../src/common/io.cc"
 #include "../src/common/host_device_vector.cc"
 #include "../src/common/hist_util.cc"
 
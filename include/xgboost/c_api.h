@@ -199,6 +199,35 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const float *data,  // NOLINT
                                        bst_ulong nrow, bst_ulong ncol,
                                        float missing, DMatrixHandle *out,
                                        int nthread);
+/*!
+ * \brief create matrix from dense matrix, stored as a dense block of values
+ *  instead of sparse entries, which halves the memory of dense data
+ * \param data pointer to the data space
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromDense(const float *data,
+                                     bst_ulong nrow,
+                                     bst_ulong ncol,
+                                     float missing,
+                                     DMatrixHandle *out);
+/*!
+ * \brief create matrix from dense matrix, stored as a dense block of values
+ * \param data pointer to the data space
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param out created dmatrix
+ * \param nthread number of threads, if <=0 use all threads
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromDense_omp(const float *data,  // NOLINT
+                                         bst_ulong nrow, bst_ulong ncol,
+                                         float missing, DMatrixHandle *out,
+                                         int nthread);
 /*!
  * \brief create matrix content from python data table
  * \param data pointer to pointer to column data
@@ -262,6 +291,16 @@ XGB_DLL int XGDMatrixDiff(DMatrixHandle handle1, DMatrixHandle handle2);
  */
 XGB_DLL int XGDMatrixSaveBinary(DMatrixHandle handle,
                                 const char *fname, int silent);
+/*!
+ * \brief save a data matrix into a page aligned binary file, which is
+ *  memory mapped when loaded back
+ * \param handle a instance of data matrix
+ * \param fname file name
+ * \param silent print statistics when saving
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixSavePageAlignedBinary(DMatrixHandle handle,
+                                           const char *fname, int silent);
 /*!
  * \brief set float vector to a content in info
  * \param handle a instance of data matrix
@@ -418,8 +457,16 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
  * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
  *    when the parameter is set to 0, we will use all the trees
  * \param out_len used to store length of returning result
- * \param out_result used to set a pointer to array
+ * \param out_result used to set a pointer to array, owned by the calling thread
+ *    and valid until its next call
  * \return 0 when success, -1 when failure happens
+ *
+ *  Thread safety: for gbtree boosters predicting on CPU, XGBoosterPredict,
+ *  XGBoosterPredictFromDense and XGBoosterPredictFromCSR may be called from
+ *  any number of threads at once on the same handle, provided no call that
+ *  changes the booster (XGBoosterSetParam, XGBoosterUpdateOneIter,
+ *  XGBoosterLoadModel, ...) runs at the same time. A dmat shared between
+ *  threads must be held in memory, not in external memory.
  */
 XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              DMatrixHandle dmat,
@@ -427,6 +474,140 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              unsigned ntree_limit,
                              bst_ulong *out_len,
                              const float **out_result);
+/*!
+ * \brief make prediction for a dense row-major matrix read in place, without
+ *  creating a DMatrix
+ * \param handle handle
+ * \param data pointer to the nrow * ncol values
+ * \param nrow number of rows
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store the number of values written to out_result
+ * \param out_result caller's buffer of at least nrow * num_class values, nrow for single output models
+ * \return 0 when success, -1 when failure happens
+ *
+ *  Thread safe as described for XGBoosterPredict.
+ */
+XGB_DLL int XGBoosterPredictFromDense(BoosterHandle handle,
+                                      const float *data,
+                                      bst_ulong nrow,
+                                      bst_ulong ncol,
+                                      float missing,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      bst_ulong *out_len,
+                                      float *out_result);
+/*!
+ * \brief make prediction for CSR rows read in place, without creating a DMatrix
+ * \param handle handle
+ * \param indptr pointer to row headers
+ * \param indices findex
+ * \param data fvalue, NaN is missing
+ * \param nindptr number of rows + 1
+ * \param nelem number of nonzero elements
+ * \param num_col number of columns
+ * \param option_mask bit-mask of options taken in prediction, see XGBoosterPredictFromDense
+ * \param ntree_limit limit number of trees used for prediction
+ * \param out_len used to store the number of values written to out_result
+ * \param out_result caller's buffer of at least (nindptr - 1) * num_class values,
+ *    nindptr - 1 for single output models
+ * \return 0 when success, -1 when failure happens
+ *
+ *  Thread safe as described for XGBoosterPredict.
+ */
+XGB_DLL int XGBoosterPredictFromCSR(BoosterHandle handle,
+                                    const size_t* indptr,
+                                    const unsigned* indices,
+                                    const float* data,
+                                    size_t nindptr,
+                                    size_t nelem,
+                                    size_t num_col,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    bst_ulong *out_len,
+                                    float *out_result);
+/*!
+ * \brief decide for rows of a dense row-major matrix whether their margin
+ *  exceeds a cutoff, for thresholded binary classification. Each row stops
+ *  evaluating trees as soon as the smallest and largest sums of the leaves of
+ *  the remaining trees are both on one side of the cutoff, so the decision is
+ *  always the one of the full margin. Only for models with a single output.
+ * \param handle handle
+ * \param data pointer to the nrow * ncol values
+ * \param nrow number of rows
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param cutoff the margin cutoff, log(p / (1 - p)) for a probability threshold p of binary:logistic
+ * \param ntree_limit limit number of trees used for prediction
+ * \param out_decision caller's buffer of nrow values, 1 if the margin exceeds cutoff, 0 otherwise
+ * \param out_ntree caller's buffer of nrow values, the number of trees evaluated per row
+ * \return 0 when success, -1 when failure happens
+ *
+ *  Thread safe as described for XGBoosterPredict.
+ */
+XGB_DLL int XGBoosterPredictDecisionFromDense(BoosterHandle handle,
+                                              const float *data,
+                                              bst_ulong nrow,
+                                              bst_ulong ncol,
+                                              float missing,
+                                              float cutoff,
+                                              unsigned ntree_limit,
+                                              unsigned char *out_decision,
+                                              unsigned *out_ntree);
+/*!
+ * \brief make prediction for a single dense row on the calling thread, for
+ *  low latency online prediction. Once the booster has predicted one row this
+ *  does not allocate memory nor start OpenMP threads.
+ * \param handle handle
+ * \param row pointer to the ncol values of the row
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, see XGBoosterPredictFromDense
+ * \param ntree_limit limit number of trees used for prediction
+ * \param out_len used to store the number of values written to out_result
+ * \param out_result caller's buffer of at least num_class values, 1 for single output models
+ * \return 0 when success, -1 when failure happens
+ *
+ *  Thread safe as described for XGBoosterPredict.
+ */
+XGB_DLL int XGBoosterPredictRowFromDense(BoosterHandle handle,
+                                         const float *row,
+                                         bst_ulong ncol,
+                                         float missing,
+                                         int option_mask,
+                                         unsigned ntree_limit,
+                                         bst_ulong *out_len,
+                                         float *out_result);
+/*!
+ * \brief make prediction for a single sparse row on the calling thread, see
+ *  XGBoosterPredictRowFromDense
+ * \param handle handle
+ * \param indices findex of the present entries
+ * \param data fvalue of the present entries, NaN is missing
+ * \param nelem number of present entries
+ * \param num_col number of columns
+ * \param option_mask bit-mask of options taken in prediction, see XGBoosterPredictFromDense
+ * \param ntree_limit limit number of trees used for prediction
+ * \param out_len used to store the number of values written to out_result
+ * \param out_result caller's buffer of at least num_class values, 1 for single output models
+ * \return 0 when success, -1 when failure happens
+ *
+ *  Thread safe as described for XGBoosterPredict.
+ */
+XGB_DLL int XGBoosterPredictRowFromCSR(BoosterHandle handle,
+                                       const unsigned* indices,
+                                       const float* data,
+                                       size_t nelem,
+                                       size_t num_col,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       bst_ulong *out_len,
+                                       float *out_result);
 
 /*!
  * \brief load model from existing file
@@ -10,6 +10,7 @@
 #include <dmlc/base.h>
 #include <dmlc/data.h>
 #include <rabit/rabit.h>
+#include <cmath>
 #include <cstring>
 #include <memory>
 #include <numeric>
@@ -34,6 +35,13 @@ enum DataType {
   kUInt64 = 4
 };
 
+/*! \brief type of a feature */
+enum class FeatureType : uint8_t {
+  kNumerical = 0,
+  /*! \brief values are non-negative integer category ids */
+  kCategorical = 1
+};
+
 /*!
  * \brief Meta information about dataset, always sit in memory.
  */
@@ -67,6 +75,11 @@ class MetaInfo {
    * can be used to specify initial prediction to boost from.
    */
   HostDeviceVector<bst_float> base_margin_;
+  /*!
+   * \brief type of each feature, optional.
+   *  Features beyond the end of the vector are numerical.
+   */
+  std::vector<FeatureType> feature_types_;
   /*! \brief version flag, used to check version of this info */
   static const int kVersion = 2;
   /*! \brief version that introduced qid field */
@@ -89,6 +102,14 @@ class MetaInfo {
   inline unsigned GetRoot(size_t i) const {
     return root_index_.size() != 0 ? root_index_[i] : 0U;
   }
+  /*!
+   * \brief Whether a feature is categorical.
+   * \param fid Feature index.
+   */
+  inline bool IsCategorical(size_t fid) const {
+    return fid < feature_types_.size() &&
+           feature_types_[fid] == FeatureType::kCategorical;
+  }
   /*! \brief get sorted indexes (argsort) of labels by absolute value (used by cox loss) */
   inline const std::vector<size_t>& LabelAbsSort() const {
     if (label_order_cache_.size() == labels_.Size()) {
@@ -280,6 +301,96 @@ class SparsePage {
   size_t Size() { return offset.Size() - 1; }
 };
 
+/*!
+ * \brief Rows read in place from a caller's buffer, dense row-major or CSR,
+ *  to predict without building a DMatrix, or from the arrays of a DMatrix
+ *  that does not hold SparsePages. NaN entries are always absent.
+ */
+class ExternalRows {
+ public:
+  /*!
+   * \brief dense row-major rows
+   * \param data nrow * ncol values
+   * \param missing value of absent entries
+   */
+  static ExternalRows Dense(const bst_float* data, size_t nrow, size_t ncol,
+                            bst_float missing) {
+    ExternalRows rows;
+    rows.data_ = data;
+    rows.nrow_ = nrow;
+    rows.ncol_ = ncol;
+    rows.missing_ = missing;
+    return rows;
+  }
+  /*!
+   * \brief CSR rows
+   * \param indptr nrow + 1 offsets into indices and data
+   */
+  static ExternalRows CSR(const size_t* indptr, const unsigned* indices,
+                          const bst_float* data, size_t nrow, size_t ncol) {
+    ExternalRows rows;
+    rows.indptr_ = indptr;
+    rows.indices_ = indices;
+    rows.data_ = data;
+    rows.nrow_ = nrow;
+    rows.ncol_ = ncol;
+    return rows;
+  }
+  /*!
+   * \brief CSR rows stored as the offset and data arrays of a SparsePage
+   * \param offset nrow + 1 offsets into entries
+   */
+  static ExternalRows Entries(const size_t* offset, const Entry* entries,
+                              size_t nrow, size_t ncol) {
+    ExternalRows rows;
+    rows.indptr_ = offset;
+    rows.entries_ = entries;
+    rows.nrow_ = nrow;
+    rows.ncol_ = ncol;
+    return rows;
+  }
+  /*! \brief number of rows */
+  inline size_t Size() const { return nrow_; }
+  /*! \brief number of columns */
+  inline size_t NumCol() const { return ncol_; }
+  /*! \brief number of present entries of row i */
+  inline size_t RowSize(size_t i) const {
+    size_t n = 0;
+    this->ForEach(i, [&n](bst_uint, bst_float) { ++n; });
+    return n;
+  }
+  /*! \brief call fn(index, fvalue) for each present entry of row i */
+  template <typename Fn>
+  inline void ForEach(size_t i, Fn fn) const {
+    if (entries_ != nullptr) {
+      for (size_t j = indptr_[i]; j < indptr_[i + 1]; ++j) {
+        fn(entries_[j].index, entries_[j].fvalue);
+      }
+    } else if (indptr_ == nullptr) {
+      const bst_float* row = data_ + i * ncol_;
+      const bool nan_missing = std::isnan(missing_);
+      for (size_t j = 0; j < ncol_; ++j) {
+        if (std::isnan(row[j]) || (!nan_missing && row[j] == missing_)) continue;
+        fn(static_cast<bst_uint>(j), row[j]);
+      }
+    } else {
+      for (size_t j = indptr_[i]; j < indptr_[i + 1]; ++j) {
+        if (std::isnan(data_[j])) continue;
+        fn(indices_[j], data_[j]);
+      }
+    }
+  }
+
+ private:
+  const size_t* indptr_ {nullptr};
+  const unsigned* indices_ {nullptr};
+  const bst_float* data_ {nullptr};
+  const Entry* entries_ {nullptr};
+  size_t nrow_ {0};
+  size_t ncol_ {0};
+  bst_float missing_ {0.0f};
+};
+
 class BatchIteratorImpl {
  public:
   virtual ~BatchIteratorImpl() {}
@@ -432,6 +543,12 @@ class DMatrix {
    * \return The created DMatrix.
    */
   virtual void SaveToLocalFile(const std::string& fname);
+  /*!
+   * \brief Save DMatrix to local file in the page aligned binary layout.
+   *  DMatrix::Load memory maps such files and reads the rows in place.
+   * \param fname The file name to be saved.
+   */
+  virtual void SaveToPageAlignedFile(const std::string& fname);
   /*!
    * \brief Load DMatrix from URI.
    * \param uri The URI of input.
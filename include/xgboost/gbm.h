@@ -82,6 +82,17 @@ class GradientBooster {
   virtual void PredictBatch(DMatrix* dmat,
                             HostDeviceVector<bst_float>* out_preds,
                             unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief generate predictions for rows read in place from a caller's buffer
+   * \param rows the rows to predict
+   * \param out_preds buffer of rows.Size() * number of output groups values
+   * \param ntree_limit limit the number of trees used in prediction, when it equals 0, this means
+   *    we do not limit number of trees
+   */
+  virtual void PredictRows(const ExternalRows& rows, bst_float* out_preds,
+                           unsigned ntree_limit = 0) {
+    LOG(FATAL) << "Prediction from external rows is not supported by this booster";
+  }
   /*!
    * \brief online prediction function, predict score for one instance at a time
    *  NOTE: use the batch prediction interface if possible, batch prediction is usually
@@ -98,6 +109,32 @@ class GradientBooster {
                        std::vector<bst_float>* out_preds,
                        unsigned ntree_limit = 0,
                        unsigned root_index = 0) = 0;
+  /*!
+   * \brief online prediction of a single row read in place from a caller's
+   *  buffer, without allocating once warmed up
+   * \param row the row, row.Size() is 1
+   * \param out_preds buffer of one value per output group
+   * \param ntree_limit limit the number of trees used in prediction
+   * \sa PredictInstance
+   */
+  virtual void PredictRow(const ExternalRows& row, bst_float* out_preds,
+                          unsigned ntree_limit = 0) {
+    LOG(FATAL) << "Single row prediction is not supported by this booster";
+  }
+  /*!
+   * \brief decide for each row whether its margin exceeds cutoff, stopping
+   *  early once the remaining trees cannot change the decision
+   * \param rows the rows to decide
+   * \param cutoff the margin cutoff
+   * \param out_decision buffer of one value per row, 1 if the margin exceeds cutoff
+   * \param out_ntree buffer of one value per row, the number of trees evaluated
+   * \param ntree_limit limit the number of trees used in prediction
+   */
+  virtual void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                               uint8_t* out_decision, unsigned* out_ntree,
+                               unsigned ntree_limit = 0) {
+    LOG(FATAL) << "Early exit decisions are not supported by this booster";
+  }
   /*!
    * \brief predict the leaf index of each tree, the output will be nsample * ntree vector
    *        this is only valid in gbtree predictor
@@ -140,6 +177,15 @@ class GradientBooster {
   virtual std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                              bool with_stats,
                                              std::string format) const = 0;
+  /*!
+   * \brief generate C++ source predicting the margin of one row with the
+   *  model, see Learner::CompileModel
+   * \return the source
+   */
+  virtual std::string CompileModel() const {
+    LOG(FATAL) << "CompileModel is not supported by the current booster";
+    return "";
+  }
   /*!
    * \brief create a gradient booster from given name
    * \param name name of gradient booster
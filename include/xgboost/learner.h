@@ -118,6 +118,48 @@ class Learner : public rabit::Serializable {
                        bool approx_contribs = false,
                        bool pred_interactions = false) const = 0;
 
+  /*!
+   * \brief get prediction for rows read in place from a caller's buffer,
+   *  without building a DMatrix
+   * \param rows the rows to predict
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param out_preds buffer of at least rows.Size() * number of output groups values
+   * \param ntree_limit limit number of trees used for boosted tree
+   *   predictor, when it equals 0, this means we are using all the trees
+   * \return number of values written to out_preds
+   */
+  virtual size_t PredictRows(const ExternalRows& rows, bool output_margin,
+                             bst_float* out_preds, unsigned ntree_limit = 0) const = 0;
+  /*!
+   * \brief online prediction of a single row read in place from a caller's
+   *  buffer. Once warmed up it neither allocates nor enters a parallel region,
+   *  as long as the objective transforms single rows in place.
+   * \param row the row, row.Size() is 1
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param out_preds buffer of at least one value per output group
+   * \param ntree_limit limit number of trees used for boosted tree
+   *   predictor, when it equals 0, this means we are using all the trees
+   * \return number of values written to out_preds
+   */
+  virtual size_t PredictRow(const ExternalRows& row, bool output_margin,
+                            bst_float* out_preds, unsigned ntree_limit = 0) const = 0;
+  /*!
+   * \brief thresholded prediction of a model with a single output: decide
+   *  for each row whether its margin exceeds cutoff, evaluating trees only
+   *  until the decision is certain. The decisions equal those made on the
+   *  margins of PredictRows.
+   * \param rows the rows to decide
+   * \param cutoff the margin cutoff, e.g. log(p / (1 - p)) for a probability
+   *   threshold p of binary:logistic
+   * \param out_decision buffer of rows.Size() values, 1 if the margin exceeds cutoff
+   * \param out_ntree buffer of rows.Size() values, the number of trees evaluated
+   * \param ntree_limit limit number of trees used for boosted tree
+   *   predictor, when it equals 0, this means we are using all the trees
+   */
+  virtual void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                               uint8_t* out_decision, unsigned* out_ntree,
+                               unsigned ntree_limit = 0) const = 0;
+
   /*!
    * \brief Set additional attribute to the Booster.
    *  The property will be saved along the booster.
@@ -158,6 +200,18 @@ class Learner : public rabit::Serializable {
   std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                      bool with_stats,
                                      std::string format) const;
+  /*!
+   * \brief generate self-contained C++ source of the model: a function
+   *  extern "C" int function_name(void* handle, const float* data,
+   *  uint64_t nrow, uint64_t ncol, float missing, int option_mask,
+   *  unsigned ntree_limit, uint64_t* out_len, float* out_result)
+   *  taking the arguments of XGBoosterPredictFromDense, where option_mask
+   *  is 0 or 1 (output margin) and handle is unused. It returns -1 on an
+   *  unsupported option_mask, or 0 after writing the predictions.
+   * \param function_name name of the generated function
+   * \return the source
+   */
+  std::string CompileModel(const std::string& function_name) const;
   /*!
    * \brief online prediction function, predict score for one instance at a time
    *  NOTE: use the batch prediction interface if possible, batch prediction is usually
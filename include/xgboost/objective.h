@@ -8,6 +8,7 @@
 #define XGBOOST_OBJECTIVE_H_
 
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <vector>
 #include <utility>
 #include <string>
@@ -66,6 +67,38 @@ class ObjFunction {
   virtual void EvalTransform(HostDeviceVector<bst_float> *io_preds) {
     this->PredTransform(io_preds);
   }
+  /*!
+   * \brief transform the prediction values of a single row in place, this is
+   *  called by single row prediction. Objectives override it to transform
+   *  without allocating or entering a parallel region; the default goes
+   *  through PredTransform and does both.
+   * \param io_preds prediction values of the row, one per output group
+   * \param size number of output groups
+   * \return number of transformed values
+   */
+  virtual size_t PredTransformRow(bst_float* io_preds, size_t size) {
+    HostDeviceVector<bst_float> preds(std::vector<bst_float>(io_preds, io_preds + size));
+    this->PredTransform(&preds);
+    const std::vector<bst_float>& h_preds = preds.ConstHostVector();
+    std::copy(h_preds.begin(), h_preds.end(), io_preds);
+    return h_preds.size();
+  }
+  /*!
+   * \brief whether PredTransformRow is overridden, so that a block of rows can
+   *  be transformed row by row in place instead of through PredTransform
+   */
+  virtual bool HasPredTransformRow() const {
+    return false;
+  }
+  /*!
+   * \brief C++ source of PredTransformRow for compiled models: the braced
+   *  body of size_t PredTransformRow(float* io_preds, size_t size), doing the
+   *  same float operations with <cmath> only.
+   * \return the body, empty when the transform cannot be compiled
+   */
+  virtual std::string PredTransformRowSource() const {
+    return "";
+  }
   /*!
    * \brief transform probability value back to margin
    * this is used to transform user-set base_score back to margin
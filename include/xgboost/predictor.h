@@ -70,6 +70,23 @@ class Predictor {
                             const gbm::GBTreeModel& model, int tree_begin,
                             unsigned ntree_limit = 0) = 0;
 
+  /**
+   * \brief Predict rows read in place from a caller's buffer, with the base
+   *  margin of the model. Does not use the prediction cache.
+   *
+   * \param           rows        The rows.
+   * \param [out]     out_preds   rows.Size() * num_output_group values.
+   * \param           model       The model to predict from.
+   * \param           ntree_limit (Optional) The ntree limit. 0 means do not
+   * limit trees.
+   */
+
+  virtual void PredictRows(const ExternalRows& rows, bst_float* out_preds,
+                           const gbm::GBTreeModel& model,
+                           unsigned ntree_limit = 0) {
+    LOG(FATAL) << "Prediction from external rows is not supported by this predictor";
+  }
+
   /**
    * \fn  virtual void Predictor::UpdatePredictionCache( const gbm::GBTreeModel
    * &model, std::vector<std::unique_ptr<TreeUpdater> >* updaters, int
@@ -113,6 +130,45 @@ class Predictor {
                                unsigned ntree_limit = 0,
                                unsigned root_index = 0) = 0;
 
+  /**
+   * \brief Predict a single row read in place from a caller's buffer, the
+   *  same as PredictInstance but writing to out_preds directly. Once warmed
+   *  up this neither allocates nor enters a parallel region.
+   *
+   * \param           row         The row, row.Size() is 1.
+   * \param [out]     out_preds   num_output_group values.
+   * \param           model       The model to predict from.
+   * \param           ntree_limit (Optional) The ntree limit. 0 means do not
+   * limit trees.
+   */
+
+  virtual void PredictRow(const ExternalRows& row, bst_float* out_preds,
+                          const gbm::GBTreeModel& model,
+                          unsigned ntree_limit = 0) {
+    LOG(FATAL) << "Single row prediction is not supported by this predictor";
+  }
+
+  /**
+   * \brief Decide for each row whether its margin exceeds cutoff, evaluating
+   *  trees only until the leaves of the remaining ones can no longer change
+   *  the decision. Decisions equal those of the full margins.
+   *
+   * \param           rows         The rows to decide.
+   * \param           cutoff       The margin cutoff.
+   * \param [out]     out_decision rows.Size() values, 1 if the margin exceeds cutoff.
+   * \param [out]     out_ntree    rows.Size() values, the number of trees evaluated.
+   * \param           model        The model to predict from, with a single output group.
+   * \param           ntree_limit  (Optional) The ntree limit. 0 means do not
+   * limit trees.
+   */
+
+  virtual void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                               uint8_t* out_decision, unsigned* out_ntree,
+                               const gbm::GBTreeModel& model,
+                               unsigned ntree_limit = 0) {
+    LOG(FATAL) << "Early exit decisions are not supported by this predictor";
+  }
+
   /**
    * \fn  virtual void Predictor::PredictLeaf(DMatrix* dmat,
    * std::vector<bst_float>* out_preds, const gbm::GBTreeModel& model, unsigned
@@ -22,7 +22,20 @@
 
 namespace xgboost {
 
-struct PathElement;  // forward declaration
+/*!
+ * \brief data TreeShap keeps about the decision path.
+ *  pweight is included for convenience and is not tied with the other attributes,
+ *  the pweight of the i'th path element is the permuation weight of paths with i-1 ones in them
+ */
+struct PathElement {
+  int feature_index;
+  bst_float zero_fraction;
+  bst_float one_fraction;
+  bst_float pweight;
+  PathElement() = default;
+  PathElement(int i, bst_float z, bst_float o, bst_float w) :
+    feature_index(i), zero_fraction(z), one_fraction(o), pweight(w) {}
+};
 
 /*! \brief meta parameters of the tree */
 struct TreeParam : public dmlc::Parameter<TreeParam> {
@@ -41,12 +54,14 @@ struct TreeParam : public dmlc::Parameter<TreeParam> {
    * used to store more than one dimensional information in tree
    */
   int size_leaf_vector;
+  /*! \brief number of bitset words used by categorical splits */
+  int num_category_words;
   /*! \brief reserved part, make sure alignment works for 64bit */
-  int reserved[31];
+  int reserved[30];
   /*! \brief constructor */
   TreeParam() {
     // assert compact alignment
-    static_assert(sizeof(TreeParam) == (31 + 6) * sizeof(int),
+    static_assert(sizeof(TreeParam) == (30 + 7) * sizeof(int),
                   "TreeParam: 64 bit align");
     std::memset(this, 0, sizeof(TreeParam));
     num_nodes = num_roots = 1;
@@ -67,7 +82,8 @@ struct TreeParam : public dmlc::Parameter<TreeParam> {
     return num_roots == b.num_roots && num_nodes == b.num_nodes &&
            num_deleted == b.num_deleted && max_depth == b.max_depth &&
            num_feature == b.num_feature &&
-           size_leaf_vector == b.size_leaf_vector;
+           size_leaf_vector == b.size_leaf_vector &&
+           num_category_words == b.num_category_words;
   }
 };
 
@@ -236,6 +252,7 @@ class RegTree {
     this->DeleteNode(nodes_[rid].LeftChild());
     this->DeleteNode(nodes_[rid].RightChild());
     nodes_[rid].SetLeaf(value);
+    this->ClearCategories(rid);
   }
   /*!
    * \brief collapse a non leaf node to a leaf node, delete its children
@@ -306,6 +323,26 @@ class RegTree {
       if (nodes_[i].IsDeleted()) deleted_nodes_.push_back(i);
     }
     CHECK_EQ(static_cast<int>(deleted_nodes_.size()), param.num_deleted);
+    // categorical splits, only present when the tree has any
+    split_categories_.resize(param.num_category_words);
+    category_segments_.clear();
+    if (param.num_category_words != 0) {
+      category_segments_.resize(param.num_nodes);
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(category_segments_),
+                        sizeof(CategorySegment) * category_segments_.size()),
+               sizeof(CategorySegment) * category_segments_.size());
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(split_categories_),
+                        sizeof(uint32_t) * split_categories_.size()),
+               sizeof(uint32_t) * split_categories_.size());
+    }
+    // leaf vectors, only present in vector trees
+    leaf_vector_.resize(static_cast<size_t>(param.num_nodes) *
+                        param.size_leaf_vector);
+    if (param.size_leaf_vector != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(leaf_vector_),
+                        sizeof(bst_float) * leaf_vector_.size()),
+               sizeof(bst_float) * leaf_vector_.size());
+    }
   }
   /*!
    * \brief save model to stream
@@ -318,11 +355,29 @@ class RegTree {
     CHECK_NE(param.num_nodes, 0);
     fo->Write(dmlc::BeginPtr(nodes_), sizeof(Node) * nodes_.size());
     fo->Write(dmlc::BeginPtr(stats_), sizeof(RTreeNodeStat) * nodes_.size());
+    if (param.num_category_words != 0) {
+      CHECK_EQ(param.num_category_words,
+               static_cast<int>(split_categories_.size()));
+      CHECK_EQ(param.num_nodes, static_cast<int>(category_segments_.size()));
+      fo->Write(dmlc::BeginPtr(category_segments_),
+                sizeof(CategorySegment) * category_segments_.size());
+      fo->Write(dmlc::BeginPtr(split_categories_),
+                sizeof(uint32_t) * split_categories_.size());
+    }
+    if (param.size_leaf_vector != 0) {
+      CHECK_EQ(static_cast<size_t>(param.num_nodes) * param.size_leaf_vector,
+               leaf_vector_.size());
+      fo->Write(dmlc::BeginPtr(leaf_vector_),
+                sizeof(bst_float) * leaf_vector_.size());
+    }
   }
 
   bool operator==(const RegTree& b) const {
     return nodes_ == b.nodes_ && stats_ == b.stats_ &&
-           deleted_nodes_ == b.deleted_nodes_ && param == b.param;
+           deleted_nodes_ == b.deleted_nodes_ && param == b.param &&
+           category_segments_ == b.category_segments_ &&
+           split_categories_ == b.split_categories_ &&
+           leaf_vector_ == b.leaf_vector_;
   }
 
   /**
@@ -361,6 +416,90 @@ class RegTree {
     this->Stat(nid).sum_hess = sum_hess;
   }
 
+  /**
+   * \brief Expands a leaf node with a categorical split. Rows whose category
+   *  is in left_categories go left, all other categories go right.
+   *
+   * \param nid               The node index to expand.
+   * \param split_index       Feature index of the split.
+   * \param left_categories   Category ids sent to the left child.
+   * \param default_left      True to default left for missing values.
+   * \param base_weight       The base weight, before learning rate.
+   * \param left_leaf_weight  The left leaf weight for prediction, modified by learning rate.
+   * \param right_leaf_weight The right leaf weight for prediction, modified by learning rate.
+   * \param loss_change       The loss change.
+   * \param sum_hess          The sum hess.
+   */
+  void ExpandCategoricalNode(int nid, unsigned split_index,
+                             const std::vector<uint32_t>& left_categories,
+                             bool default_left, bst_float base_weight,
+                             bst_float left_leaf_weight,
+                             bst_float right_leaf_weight,
+                             bst_float loss_change, float sum_hess) {
+    CHECK(!left_categories.empty());
+    uint32_t max_cat = *std::max_element(left_categories.begin(),
+                                         left_categories.end());
+    // split_cond keeps the number of left categories, for information only
+    this->ExpandNode(nid, split_index,
+                     static_cast<bst_float>(left_categories.size()),
+                     default_left, base_weight, left_leaf_weight,
+                     right_leaf_weight, loss_change, sum_hess);
+    if (category_segments_.size() != nodes_.size()) {
+      category_segments_.resize(nodes_.size());
+    }
+    CategorySegment& seg = category_segments_[nid];
+    seg.beg = static_cast<uint32_t>(split_categories_.size());
+    seg.size = max_cat / 32 + 1;
+    split_categories_.resize(split_categories_.size() + seg.size, 0U);
+    for (uint32_t cat : left_categories) {
+      split_categories_[seg.beg + cat / 32] |= 1U << (cat % 32);
+    }
+    param.num_category_words = static_cast<int>(split_categories_.size());
+  }
+  /*! \brief whether node nid splits on a set of categories */
+  inline bool IsCategorical(int nid) const {
+    return category_segments_.size() != 0 && category_segments_[nid].size != 0;
+  }
+  /*!
+   * \brief whether category value fvalue goes left at categorical node nid.
+   *  Fractional values are truncated; negative or out-of-range ids never match.
+   */
+  inline bool InCategories(int nid, bst_float fvalue) const {
+    const CategorySegment& seg = category_segments_[nid];
+    if (!(fvalue >= 0.0f)) return false;
+    const auto cat = static_cast<uint32_t>(fvalue);
+    if (cat / 32 >= seg.size) return false;
+    return (split_categories_[seg.beg + cat / 32] >> (cat % 32)) & 1U;
+  }
+  /*! \brief category ids sent left at categorical node nid */
+  std::vector<uint32_t> NodeCategories(int nid) const {
+    std::vector<uint32_t> cats;
+    if (!this->IsCategorical(nid)) return cats;
+    const CategorySegment& seg = category_segments_[nid];
+    for (uint32_t w = 0; w < seg.size; ++w) {
+      const uint32_t word = split_categories_[seg.beg + w];
+      for (uint32_t b = 0; b < 32; ++b) {
+        if ((word >> b) & 1U) cats.push_back(w * 32 + b);
+      }
+    }
+    return cats;
+  }
+  /*!
+   * \brief leaf vector of node nid in a vector tree: param.size_leaf_vector
+   *  outputs, with the learning rate applied. Every node holds one, so that
+   *  a node pruned back into a leaf keeps its outputs.
+   */
+  const bst_float* LeafVector(int nid) const {
+    return dmlc::BeginPtr(leaf_vector_) +
+           static_cast<size_t>(nid) * param.size_leaf_vector;
+  }
+  /*! \brief set the leaf vector of node nid from param.size_leaf_vector values */
+  void SetLeafVector(int nid, const bst_float* value) {
+    const auto size = static_cast<size_t>(param.size_leaf_vector);
+    CHECK_NE(size, 0U) << "SetLeafVector: not a vector tree";
+    leaf_vector_.resize(nodes_.size() * size, 0.0f);
+    std::copy(value, value + size, leaf_vector_.begin() + nid * size);
+  }
   /*!
    * \brief get current depth
    * \param nid node id
@@ -419,6 +558,18 @@ class RegTree {
      * \param inst The sparse instance to drop.
      */
     void Drop(const SparsePage::Inst& inst);
+    /*!
+     * \brief fill the vector with row i of rows
+     * \param rows The rows in a caller's buffer.
+     * \param i The row to fill.
+     */
+    void Fill(const ExternalRows& rows, size_t i);
+    /*!
+     * \brief drop the trace after fill, must be called after fill.
+     * \param rows The rows in a caller's buffer.
+     * \param i The row to drop.
+     */
+    void Drop(const ExternalRows& rows, size_t i);
     /*!
      * \brief returns the size of the feature vector
      * \return the size of the feature vector
@@ -466,6 +617,22 @@ class RegTree {
   void CalculateContributions(const RegTree::FVec& feat, unsigned root_id,
                               bst_float* out_contribs, int condition = 0,
                               unsigned condition_feature = 0) const;
+  /*!
+   * \brief CalculateContributions on a caller's buffer of unique paths, which
+   *  can be reused for every row and tree
+   * \param unique_path_data at least ShapPathSize(MaxDepth(root_id)) elements
+   */
+  void CalculateContributions(const RegTree::FVec& feat, unsigned root_id,
+                              bst_float* out_contribs, int condition,
+                              unsigned condition_feature,
+                              PathElement* unique_path_data) const;
+  /*!
+   * \brief number of path elements TreeShap uses on a tree of depth max_depth
+   */
+  static size_t ShapPathSize(int max_depth) {
+    const auto maxd = static_cast<size_t>(max_depth + 2);
+    return (maxd * (maxd + 1)) / 2;
+  }
   /*!
    * \brief Recursive function that computes the feature attributions for a single tree.
    * \param feat dense feature vector, if the feature is missing the field is set to NaN
@@ -511,6 +678,17 @@ class RegTree {
   std::string DumpModel(const FeatureMap& fmap,
                         bool with_stats,
                         std::string format) const;
+  /*!
+   * \brief generate C++ source of the tree from its first root, unrolled into
+   *  branches: a function void name(const float* fvalue, float* psum) adding
+   *  the leaf reached by fvalue, where missing features are NaN, to psum.
+   *  Categorical splits call InCategories(fvalue, begin, end) on a sorted
+   *  array of category ids, which the surrounding source defines.
+   * \param name name of the generated function
+   * \param group output group of a scalar tree, ignored by vector trees
+   * \return the source
+   */
+  std::string CompileModel(const std::string& name, int group) const;
   /*!
    * \brief calculate the mean value for each node, required for feature contributions
    */
@@ -524,6 +702,20 @@ class RegTree {
   // stats of nodes
   std::vector<RTreeNodeStat> stats_;
   std::vector<bst_float> node_mean_values_;
+  /*! \brief range of bitset words in split_categories_ used by a node */
+  struct CategorySegment {
+    uint32_t beg;
+    uint32_t size;
+    bool operator==(const CategorySegment& b) const {
+      return beg == b.beg && size == b.size;
+    }
+  };
+  // per node category ranges, empty if the tree has no categorical split
+  std::vector<CategorySegment> category_segments_;
+  // bitsets of all categorical splits
+  std::vector<uint32_t> split_categories_;
+  // leaf vectors of all nodes, empty unless param.size_leaf_vector != 0
+  std::vector<bst_float> leaf_vector_;
   // allocate a new node,
   // !!!!!! NOTE: may cause BUG here, nodes.resize
   int AllocNode() {
@@ -531,6 +723,7 @@ class RegTree {
       int nid = deleted_nodes_.back();
       deleted_nodes_.pop_back();
       nodes_[nid].Reuse();
+      this->ClearCategories(nid);
       --param.num_deleted;
       return nid;
     }
@@ -539,8 +732,21 @@ class RegTree {
         << "number of nodes in the tree exceed 2^31";
     nodes_.resize(param.num_nodes);
     stats_.resize(param.num_nodes);
+    if (category_segments_.size() != 0) {
+      category_segments_.resize(param.num_nodes, CategorySegment{0, 0});
+    }
+    if (param.size_leaf_vector != 0) {
+      leaf_vector_.resize(static_cast<size_t>(param.num_nodes) *
+                          param.size_leaf_vector, 0.0f);
+    }
     return nd;
   }
+  // drop the category set of a node, the bitset words stay unused
+  void ClearCategories(int nid) {
+    if (category_segments_.size() != 0) {
+      category_segments_[nid] = CategorySegment{0, 0};
+    }
+  }
   // delete a tree node, keep the parent field to allow trace back
   void DeleteNode(int nid) {
     CHECK_GE(nid, param.num_roots);
@@ -571,6 +777,18 @@ inline void RegTree::FVec::Drop(const SparsePage::Inst& inst) {
   }
 }
 
+inline void RegTree::FVec::Fill(const ExternalRows& rows, size_t i) {
+  rows.ForEach(i, [this](bst_uint index, bst_float fvalue) {
+    if (index < data_.size()) data_[index].fvalue = fvalue;
+  });
+}
+
+inline void RegTree::FVec::Drop(const ExternalRows& rows, size_t i) {
+  rows.ForEach(i, [this](bst_uint index, bst_float fvalue) {
+    if (index < data_.size()) data_[index].flag = -1;
+  });
+}
+
 inline size_t RegTree::FVec::Size() const {
   return data_.size();
 }
@@ -598,6 +816,9 @@ inline int RegTree::GetNext(int pid, bst_float fvalue, bool is_unknown) const {
   bst_float split_value = (*this)[pid].SplitCond();
   if (is_unknown) {
     return (*this)[pid].DefaultChild();
+  } else if (this->IsCategorical(pid)) {
+    return this->InCategories(pid, fvalue) ? (*this)[pid].LeftChild()
+                                           : (*this)[pid].RightChild();
   } else {
     if (fvalue < split_value) {
       return (*this)[pid].LeftChild();
@@ -479,14 +479,14 @@ class DMatrix(object):
         handle = ctypes.c_void_p()
         missing = missing if missing is not None else np.nan
         if nthread is None:
-            _check_call(_LIB.XGDMatrixCreateFromMat(
+            _check_call(_LIB.XGDMatrixCreateFromDense(
                 data.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
                 c_bst_ulong(mat.shape[0]),
                 c_bst_ulong(mat.shape[1]),
                 ctypes.c_float(missing),
                 ctypes.byref(handle)))
         else:
-            _check_call(_LIB.XGDMatrixCreateFromMat_omp(
+            _check_call(_LIB.XGDMatrixCreateFromDense_omp(
                 data.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
                 c_bst_ulong(mat.shape[0]),
                 c_bst_ulong(mat.shape[1]),
@@ -645,7 +645,7 @@ class DMatrix(object):
                                               c_array(ctypes.c_uint, data),
                                               c_bst_ulong(len(data))))
 
-    def save_binary(self, fname, silent=True):
+    def save_binary(self, fname, silent=True, page_aligned=False):
         """Save DMatrix to an XGBoost buffer.  Saved binary can be later loaded
         by providing the path to :py:func:`xgboost.DMatrix` as input.
 
@@ -655,10 +655,15 @@ class DMatrix(object):
             Name of the output buffer file.
         silent : bool (optional; default: True)
             If set, the output is suppressed.
+        page_aligned : bool (optional; default: False)
+            If set, the buffer is written in a page aligned layout that is
+            memory mapped when loaded and read in place, so its pages are
+            only read when used and are shared between processes.
         """
-        _check_call(_LIB.XGDMatrixSaveBinary(self.handle,
-                                             c_str(fname),
-                                             ctypes.c_int(silent)))
+        save = _LIB.XGDMatrixSavePageAlignedBinary if page_aligned else _LIB.XGDMatrixSaveBinary
+        _check_call(save(self.handle,
+                         c_str(fname),
+                         ctypes.c_int(silent)))
 
     def set_label(self, label):
         """Set label of dmatrix
@@ -9,18 +9,21 @@
 #include <rabit/rabit.h>
 #include <rabit/c_api.h>
 
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 #include <algorithm>
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
 
 #include "./c_api_error.h"
 #include "../data/reconfigurable_matrix.h"
 #include "../data/reconfigurable_source.h"
 #include "../data/simple_csr_source.h"
 #include "../data/diff_dmatrix.h"
+#include "../data/dense_dmatrix.h"
 #include "../common/math.h"
 #include "../common/io.h"
 #include "../common/group_data.h"
@@ -57,7 +60,13 @@ class Booster {
     }
   }
 
+  // concurrent predictions may all call this; once the booster is
+  // configured and initialized it only reads an atomic flag
   inline void LazyInit() {
+    if (ready_.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(init_mutex_);
     if (!configured_) {
       LoadSavedParamFromAttr();
       learner_->Configure(cfg_);
@@ -67,6 +76,7 @@ class Booster {
       learner_->InitModel();
       initialized_ = true;
     }
+    ready_.store(true, std::memory_order_release);
   }
 
   inline void LoadSavedParamFromAttr() {
@@ -99,6 +109,9 @@ class Booster {
  private:
   bool configured_;
   bool initialized_;
+  // configured_ and initialized_ both set by LazyInit
+  std::atomic<bool> ready_ {false};
+  std::mutex init_mutex_;
   std::unique_ptr<Learner> learner_;
   std::vector<std::pair<std::string, std::string> > cfg_;
 };
@@ -420,6 +433,28 @@ XGB_DLL int XGDMatrixCreateFromMat(const bst_float* data,
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromDense(const bst_float* data,
+                                     xgboost::bst_ulong nrow,
+                                     xgboost::bst_ulong ncol,
+                                     bst_float missing,
+                                     DMatrixHandle* out) {
+  API_BEGIN();
+  *out = new std::shared_ptr<DMatrix>(new data::DenseDMatrix(data, nrow, ncol, missing));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateFromDense_omp(const bst_float* data,  // NOLINT
+                                         xgboost::bst_ulong nrow,
+                                         xgboost::bst_ulong ncol,
+                                         bst_float missing,
+                                         DMatrixHandle* out,
+                                         int nthread) {
+  API_BEGIN();
+  *out = new std::shared_ptr<DMatrix>(
+      new data::DenseDMatrix(data, nrow, ncol, missing, nthread));
+  API_END();
+}
+
 void PrefixSum(size_t *x, size_t N) {
   size_t *suma;
 #pragma omp parallel
@@ -796,6 +831,15 @@ XGB_DLL int XGDMatrixSaveBinary(DMatrixHandle handle,
   API_END();
 }
 
+XGB_DLL int XGDMatrixSavePageAlignedBinary(DMatrixHandle handle,
+                                           const char* fname,
+                                           int silent) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  static_cast<std::shared_ptr<DMatrix>*>(handle)->get()->SaveToPageAlignedFile(fname);
+  API_END();
+}
+
 XGB_DLL int XGDMatrixSetFloatInfo(DMatrixHandle handle,
                           const char* field,
                           const bst_float* info,
@@ -1007,6 +1051,112 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterPredictFromDense(BoosterHandle handle,
+                                      const bst_float* data,
+                                      xgboost::bst_ulong nrow,
+                                      xgboost::bst_ulong ncol,
+                                      bst_float missing,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      xgboost::bst_ulong *len,
+                                      bst_float *out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_EQ(option_mask & ~1, 0)
+      << "only the output margin option is supported for dense input";
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  *len = static_cast<xgboost::bst_ulong>(bst->learner()->PredictRows(
+      ExternalRows::Dense(data, nrow, ncol, missing),
+      (option_mask & 1) != 0, out_result, ntree_limit));
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictFromCSR(BoosterHandle handle,
+                                    const size_t* indptr,
+                                    const unsigned* indices,
+                                    const bst_float* data,
+                                    size_t nindptr,
+                                    size_t nelem,
+                                    size_t num_col,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    xgboost::bst_ulong *len,
+                                    bst_float *out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_EQ(option_mask & ~1, 0)
+      << "only the output margin option is supported for CSR input";
+  CHECK_GE(nindptr, 1U);
+  CHECK_EQ(indptr[nindptr - 1], nelem);
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  *len = static_cast<xgboost::bst_ulong>(bst->learner()->PredictRows(
+      ExternalRows::CSR(indptr, indices, data, nindptr - 1, num_col),
+      (option_mask & 1) != 0, out_result, ntree_limit));
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictDecisionFromDense(BoosterHandle handle,
+                                              const bst_float* data,
+                                              xgboost::bst_ulong nrow,
+                                              xgboost::bst_ulong ncol,
+                                              bst_float missing,
+                                              bst_float cutoff,
+                                              unsigned ntree_limit,
+                                              unsigned char *out_decision,
+                                              unsigned *out_ntree) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  bst->learner()->PredictDecision(ExternalRows::Dense(data, nrow, ncol, missing),
+                                  cutoff, out_decision, out_ntree, ntree_limit);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictRowFromDense(BoosterHandle handle,
+                                         const bst_float* row,
+                                         xgboost::bst_ulong ncol,
+                                         bst_float missing,
+                                         int option_mask,
+                                         unsigned ntree_limit,
+                                         xgboost::bst_ulong *len,
+                                         bst_float *out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_EQ(option_mask & ~1, 0)
+      << "only the output margin option is supported for single rows";
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  *len = static_cast<xgboost::bst_ulong>(bst->learner()->PredictRow(
+      ExternalRows::Dense(row, 1, ncol, missing),
+      (option_mask & 1) != 0, out_result, ntree_limit));
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictRowFromCSR(BoosterHandle handle,
+                                       const unsigned* indices,
+                                       const bst_float* data,
+                                       size_t nelem,
+                                       size_t num_col,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       xgboost::bst_ulong *len,
+                                       bst_float *out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_EQ(option_mask & ~1, 0)
+      << "only the output margin option is supported for single rows";
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  const size_t indptr[] = {0, nelem};
+  *len = static_cast<xgboost::bst_ulong>(bst->learner()->PredictRow(
+      ExternalRows::CSR(indptr, indices, data, 1, num_col),
+      (option_mask & 1) != 0, out_result, ntree_limit));
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadModel(BoosterHandle handle, const char* fname) {
   API_BEGIN();
   CHECK_HANDLE();
@@ -28,7 +28,8 @@ namespace xgboost {
 enum CLITask {
   kTrain = 0,
   kDumpModel = 1,
-  kPredict = 2
+  kPredict = 2,
+  kCompileModel = 3
 };
 
 struct CLIParam : public dmlc::Parameter<CLIParam> {
@@ -66,6 +67,10 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
   std::string name_fmap;
   /*! \brief name of dump file */
   std::string name_dump;
+  /*! \brief name of the generated source file */
+  std::string name_compile;
+  /*! \brief name of the prediction function in the generated source */
+  std::string compile_function;
   /*! \brief the paths of validation data sets */
   std::vector<std::string> eval_data_paths;
   /*! \brief the names of the evaluation data used in output log */
@@ -80,6 +85,7 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .add_enum("train", kTrain)
         .add_enum("dump", kDumpModel)
         .add_enum("pred", kPredict)
+        .add_enum("compile", kCompileModel)
         .describe("Task to be performed by the CLI program.");
     DMLC_DECLARE_FIELD(eval_train).set_default(false)
         .describe("Whether evaluate on training data during training.");
@@ -116,6 +122,10 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .describe("Name of the feature map file.");
     DMLC_DECLARE_FIELD(name_dump).set_default("dump.txt")
         .describe("Name of the output dump text file.");
+    DMLC_DECLARE_FIELD(name_compile).set_default("model.cc")
+        .describe("Name of the output C++ source of task=compile.");
+    DMLC_DECLARE_FIELD(compile_function).set_default("XGBoosterPredictFromDense")
+        .describe("Name of the prediction function in the output C++ source.");
     // alias
     DMLC_DECLARE_ALIAS(train_path, data);
     DMLC_DECLARE_ALIAS(test_path, test:data);
@@ -334,6 +344,22 @@ void CLIPredict(const CLIParam& param) {
   os.set_stream(nullptr);
 }
 
+void CLICompileModel(const CLIParam& param) {
+  CHECK_NE(param.model_in, "NULL")
+      << "Must specify model_in for compile";
+  std::unique_ptr<Learner> learner(Learner::Create({}));
+  std::unique_ptr<dmlc::Stream> fi(
+      dmlc::Stream::Create(param.model_in.c_str(), "r"));
+  learner->Load(fi.get());
+  learner->Configure(param.cfg);
+
+  const std::string source = learner->CompileModel(param.compile_function);
+  LOG(CONSOLE) << "writing model source to " << param.name_compile;
+  std::unique_ptr<dmlc::Stream> fo(
+      dmlc::Stream::Create(param.name_compile.c_str(), "w"));
+  fo->Write(source.c_str(), source.length());
+}
+
 int CLIRunTask(int argc, char *argv[]) {
   if (argc < 2) {
     printf("Usage: <config>\n");
@@ -362,6 +388,7 @@ int CLIRunTask(int argc, char *argv[]) {
     case kTrain: CLITrain(param); break;
     case kDumpModel: CLIDumpModel(param); break;
     case kPredict: CLIPredict(param); break;
+    case kCompileModel: CLICompileModel(param); break;
   }
   rabit::Finalize();
   return 0;
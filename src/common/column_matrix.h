@@ -68,10 +68,12 @@ class ColumnMatrix {
     return static_cast<bst_uint>(type_.size());
   }
 
-  // construct column matrix from GHistIndexMatrix
+  // construct column matrix from GHistIndexMatrix, one column per feature
+  // or, if gmat is bundled, per feature bundle
   inline void Init(const GHistIndexMatrix& gmat,
                    double  sparse_threshold) {
-    const int32_t nfeature = static_cast<int32_t>(gmat.cut.row_ptr.size() - 1);
+    const std::vector<uint32_t>& col_ptr = gmat.ColumnPtr();
+    const int32_t nfeature = static_cast<int32_t>(col_ptr.size() - 1);
     const size_t nrow = gmat.row_ptr.size() - 1;
 
     // identify type of each column
@@ -81,7 +83,7 @@ class ColumnMatrix {
 
     uint32_t max_val = std::numeric_limits<uint32_t>::max();
     for (bst_uint fid = 0; fid < nfeature; ++fid) {
-      CHECK_LE(gmat.cut.row_ptr[fid + 1] - gmat.cut.row_ptr[fid], max_val);
+      CHECK_LE(col_ptr[fid + 1] - col_ptr[fid], max_val);
     }
 
     gmat.GetFeatureCounts(&feature_counts_[0]);
@@ -120,7 +122,7 @@ class ColumnMatrix {
     // store least bin id for each feature
     index_base_.resize(nfeature);
     for (bst_uint fid = 0; fid < nfeature; ++fid) {
-      index_base_[fid] = gmat.cut.row_ptr[fid];
+      index_base_[fid] = col_ptr[fid];
     }
 
     // pre-fill index_ for dense columns
@@ -147,7 +149,7 @@ class ColumnMatrix {
       size_t fid = 0;
       for (size_t i = ibegin; i < iend; ++i) {
         const uint32_t bin_id = gmat.index[i];
-        while (bin_id >= gmat.cut.row_ptr[fid + 1]) {
+        while (bin_id >= col_ptr[fid + 1]) {
           ++fid;
         }
         if (type_[fid] == kDenseColumn) {
@@ -9,7 +9,9 @@
 #include <xgboost/base.h>
 #include <xgboost/logging.h>
 
+#include <cmath>
 #include <exception>
+#include <iomanip>
 #include <limits>
 #include <type_traits>
 #include <vector>
@@ -72,6 +74,21 @@ inline std::string ToString(const T& data) {
   return os.str();
 }
 
+// C++ float literal reading back as exactly value, for generated source
+inline std::string ToFloatLiteral(bst_float value) {
+  if (std::isinf(value)) {
+    return value > 0 ? "std::numeric_limits<float>::infinity()"
+                     : "-std::numeric_limits<float>::infinity()";
+  }
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<bst_float>::max_digits10) << value;
+  std::string literal = os.str();
+  if (literal.find_first_of(".e") == std::string::npos) {
+    literal += ".0";
+  }
+  return literal + "f";
+}
+
 /*
  * Range iterator
  */
@@ -4,6 +4,9 @@
  */
 #include <rabit/rabit.h>
 #include <dmlc/omp.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <numeric>
 #include <vector>
 
@@ -12,6 +15,7 @@
 #include "./hist_util.h"
 #include "./quantile.h"
 #include "./../tree/updater_quantile_hist.h"
+#include "./../data/mapped_dmatrix.h"
 
 #if defined(XGBOOST_MM_PREFETCH_PRESENT)
   #include <xmmintrin.h>
@@ -42,6 +46,81 @@ size_t HistCutMatrix::SearchGroupIndFromBaseRow(
   return group_ind;
 }
 
+namespace {
+/*! \brief the rows of a SparsePage, read like ExternalRows */
+class SparsePageRows {
+ public:
+  explicit SparsePageRows(const SparsePage& page) : page_(page) {}
+  inline size_t Size() const { return page_.Size(); }
+  inline size_t RowSize(size_t i) const { return page_[i].size(); }
+  template <typename Fn>
+  inline void ForEach(size_t i, Fn fn) const {
+    for (auto const& entry : page_[i]) {
+      fn(entry.index, entry.fvalue);
+    }
+  }
+
+ private:
+  const SparsePage& page_;
+};
+
+// push the entries of rows, whose first row is base_rowid, into the sketches;
+// blocks of rows are gathered per column by each thread before pushing
+template <typename Rows>
+void SketchRows(const Rows& rows, size_t base_rowid, const MetaInfo& info,
+                size_t nthread, std::vector<HistCutMatrix::WXQSketch>* p_sketchs) {
+  std::vector<HistCutMatrix::WXQSketch>& sketchs = *p_sketchs;
+  unsigned const ncol = static_cast<unsigned>(info.num_col_);
+  const size_t size = rows.Size();
+  const size_t block_size = 512;
+  const size_t block_size_iter = block_size * nthread;
+  const size_t n_blocks = size / block_size_iter + !!(size % block_size_iter);
+
+  std::vector<std::vector<std::pair<float, float>>> buff(nthread);
+  for (size_t tid = 0; tid < nthread; ++tid) {
+    buff[tid].resize(block_size * ncol);
+  }
+
+  std::vector<size_t> sizes(nthread * ncol, 0);
+
+  for (size_t iblock = 0; iblock < n_blocks; ++iblock) {
+    #pragma omp parallel num_threads(nthread)
+    {
+      int tid = omp_get_thread_num();
+
+      const size_t ibegin = iblock * block_size_iter + tid * block_size;
+      const size_t iend = std::min(ibegin + block_size, size);
+
+      auto* p_sizes = sizes.data() + ncol * tid;
+      auto* p_buff = buff[tid].data();
+
+      for (size_t i = ibegin; i < iend; ++i) {
+        size_t const ridx = base_rowid + i;
+        bst_float w = info.GetWeight(ridx);
+        rows.ForEach(i, [&](bst_uint idx, bst_float fvalue) {
+          p_buff[idx * block_size + p_sizes[idx]] = { fvalue, w };
+          p_sizes[idx]++;
+        });
+      }
+      #pragma omp barrier
+      #pragma omp for schedule(static)
+      for (int32_t icol = 0; icol < static_cast<int32_t>(ncol); ++icol) {
+        for (size_t tid = 0; tid < nthread; ++tid) {
+          auto* p_sizes = sizes.data() + ncol * tid;
+          auto* p_buff = buff[tid].data() + icol * block_size;
+
+          for (size_t i = 0; i < p_sizes[icol]; ++i) {
+            sketchs[icol].Push(p_buff[i].first,  p_buff[i].second);
+          }
+
+          p_sizes[icol] = 0;
+        }
+      }
+    }
+  }
+}
+}  // anonymous namespace
+
 void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
   monitor_.Start("Init");
   const MetaInfo& info = p_fmat->Info();
@@ -68,6 +147,9 @@ void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
   // Use group index for weights?
   bool const use_group_ind = num_groups != 0 && weights.size() != info.num_row_;
 
+  // dense and mapped matrices are read in place instead of through CSR pages
+  ExternalRows rows;
+  const bool in_place = data::InPlaceRows(p_fmat, &rows);
   if (use_group_ind) {
     for (const auto &batch : p_fmat->GetRowBatches()) {
       size_t group_ind = this->SearchGroupIndFromBaseRow(group_ptr, batch.base_rowid);
@@ -99,67 +181,21 @@ void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
         }
       }
     }
+  } else if (in_place) {
+    SketchRows(rows, 0, info, nthread, &sketchs);
   } else {
     for (const auto &batch : p_fmat->GetRowBatches()) {
-      const size_t size = batch.Size();
-      const size_t block_size = 512;
-      const size_t block_size_iter = block_size * nthread;
-      const size_t n_blocks = size / block_size_iter + !!(size % block_size_iter);
-
-      std::vector<std::vector<std::pair<float, float>>> buff(nthread);
-      for (size_t tid = 0; tid < nthread; ++tid) {
-        buff[tid].resize(block_size * ncol);
-      }
-
-      std::vector<size_t> sizes(nthread * ncol, 0);
-
-      for (size_t iblock = 0; iblock < n_blocks; ++iblock) {
-        #pragma omp parallel num_threads(nthread)
-        {
-          int tid = omp_get_thread_num();
-
-          const size_t ibegin = iblock * block_size_iter + tid * block_size;
-          const size_t iend = std::min(ibegin + block_size, size);
-
-          auto* p_sizes = sizes.data() + ncol * tid;
-          auto* p_buff = buff[tid].data();
-
-          for (size_t i = ibegin; i < iend; ++i) {
-            size_t const ridx = batch.base_rowid + i;
-            bst_float w = info.GetWeight(ridx);
-            SparsePage::Inst const inst = batch[i];
-
-            for (auto const& entry : inst) {
-              const size_t idx = entry.index;
-              p_buff[idx * block_size + p_sizes[idx]] = { entry.fvalue, w };
-              p_sizes[idx]++;
-            }
-          }
-          #pragma omp barrier
-          #pragma omp for schedule(static)
-          for (int32_t icol = 0; icol < static_cast<int32_t>(ncol); ++icol) {
-            for (size_t tid = 0; tid < nthread; ++tid) {
-              auto* p_sizes = sizes.data() + ncol * tid;
-              auto* p_buff = buff[tid].data() + icol * block_size;
-
-              for (size_t i = 0; i < p_sizes[icol]; ++i) {
-                sketchs[icol].Push(p_buff[i].first,  p_buff[i].second);
-              }
-
-              p_sizes[icol] = 0;
-            }
-          }
-        }
-      }
+      SketchRows(SparsePageRows(batch), batch.base_rowid, info, nthread, &sketchs);
     }
   }
 
-  Init(&sketchs, max_num_bins);
+  Init(&sketchs, max_num_bins, info.feature_types_);
   monitor_.Stop("Init");
 }
 
 void HistCutMatrix::Init
-(std::vector<WXQSketch>* in_sketchs, uint32_t max_num_bins) {
+(std::vector<WXQSketch>* in_sketchs, uint32_t max_num_bins,
+ std::vector<FeatureType> const& feature_types) {
   std::vector<WXQSketch>& sketchs = *in_sketchs;
   constexpr int kFactor = 8;
   // gather the histogram data
@@ -183,6 +219,27 @@ void HistCutMatrix::Init
     a.SetPrune(summary_array[fid], max_num_bins);
     const bst_float mval = a.data[0].value;
     this->min_val[fid] = mval - (fabs(mval) + 1e-5);
+    if (fid < feature_types.size() &&
+        feature_types[fid] == FeatureType::kCategorical) {
+      /* one bin per category id, bin k holds [k, k + 1) */
+      if (a.size != 0) {
+        CHECK_GE(mval, 0.0f) << "categorical feature " << fid
+                             << " has negative category id";
+      }
+      const bst_float max_val = a.size > 0 ? a.data[a.size - 1].value : 0.0f;
+      CHECK_LE(max_val, static_cast<bst_float>(kMaxCategory))
+          << "categorical feature " << fid << " has category id " << max_val
+          << ", above the limit of " << kMaxCategory << "; every id up to the "
+          << "largest one gets a histogram bin, so ids must be encoded densely "
+          << "as 0, 1, 2, ...";
+      const auto max_cat = static_cast<uint32_t>(max_val);
+      for (uint32_t k = 0; k <= max_cat; ++k) {
+        cut.push_back(static_cast<bst_float>(k + 1));
+      }
+      CHECK_LE(cut.size(), std::numeric_limits<uint32_t>::max());
+      row_ptr.push_back(static_cast<uint32_t>(cut.size()));
+      continue;
+    }
     if (a.size > 1 && a.size <= 16) {
       /* specialized code categorial / ordinal data -- use midpoints */
       for (size_t i = 1; i < a.size; ++i) {
@@ -235,6 +292,14 @@ void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins) {
   hit_count.resize(nbins, 0);
   hit_count_tloc_.resize(nthread * nbins, 0);
 
+  // dense and mapped matrices are read in place instead of through CSR pages
+  ExternalRows rows;
+  if (data::InPlaceRows(p_fmat, &rows)) {
+    row_ptr.resize(rows.Size() + 1);
+    row_ptr[0] = 0;
+    this->PushRows(rows, 0);
+    return;
+  }
 
   size_t new_size = 1;
   for (const auto &batch : p_fmat->GetRowBatches()) {
@@ -245,79 +310,287 @@ void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins) {
   row_ptr[0] = 0;
 
   size_t rbegin = 0;
-  size_t prev_sum = 0;
-
   for (const auto &batch : p_fmat->GetRowBatches()) {
-    MemStackAllocator<size_t, 128> partial_sums(nthread);
-    size_t* p_part = partial_sums.Get();
+    this->PushRows(SparsePageRows(batch), rbegin);
+    rbegin += batch.Size();
+  }
+}
 
-    size_t block_size =  batch.Size() / nthread;
+template <typename Rows>
+void GHistIndexMatrix::PushRows(const Rows& rows, size_t rbegin) {
+  const int32_t nthread = omp_get_max_threads();
+  const uint32_t nbins = cut.row_ptr.back();
+  MemStackAllocator<size_t, 128> partial_sums(nthread);
+  size_t* p_part = partial_sums.Get();
 
-    #pragma omp parallel num_threads(nthread)
-    {
-      #pragma omp for
-      for (int32_t tid = 0; tid < nthread; ++tid) {
-        size_t ibegin = block_size * tid;
-        size_t iend = (tid == (nthread-1) ? batch.Size() : (block_size * (tid+1)));
-
-        size_t sum = 0;
-        for (size_t i = ibegin; i < iend; ++i) {
-          sum += batch[i].size();
-          row_ptr[rbegin + 1 + i] = sum;
-        }
+  size_t block_size =  rows.Size() / nthread;
+
+  #pragma omp parallel num_threads(nthread)
+  {
+    #pragma omp for
+    for (int32_t tid = 0; tid < nthread; ++tid) {
+      size_t ibegin = block_size * tid;
+      size_t iend = (tid == (nthread-1) ? rows.Size() : (block_size * (tid+1)));
+
+      size_t sum = 0;
+      for (size_t i = ibegin; i < iend; ++i) {
+        sum += rows.RowSize(i);
+        row_ptr[rbegin + 1 + i] = sum;
       }
+    }
 
-      #pragma omp single
-      {
-        p_part[0] = prev_sum;
-        for (int32_t i = 1; i < nthread; ++i) {
-          p_part[i] = p_part[i - 1] + row_ptr[rbegin + i*block_size];
-        }
+    #pragma omp single
+    {
+      p_part[0] = row_ptr[rbegin];
+      for (int32_t i = 1; i < nthread; ++i) {
+        p_part[i] = p_part[i - 1] + row_ptr[rbegin + i*block_size];
       }
+    }
 
-      #pragma omp for
-      for (int32_t tid = 0; tid < nthread; ++tid) {
-        size_t ibegin = block_size * tid;
-        size_t iend = (tid == (nthread-1) ? batch.Size() : (block_size * (tid+1)));
+    #pragma omp for
+    for (int32_t tid = 0; tid < nthread; ++tid) {
+      size_t ibegin = block_size * tid;
+      size_t iend = (tid == (nthread-1) ? rows.Size() : (block_size * (tid+1)));
 
-        for (size_t i = ibegin; i < iend; ++i) {
-          row_ptr[rbegin + 1 + i] += p_part[tid];
-        }
+      for (size_t i = ibegin; i < iend; ++i) {
+        row_ptr[rbegin + 1 + i] += p_part[tid];
       }
     }
+  }
 
-    index.resize(row_ptr[rbegin + batch.Size()]);
+  index.resize(row_ptr[rbegin + rows.Size()]);
+
+  CHECK_GT(cut.cut.size(), 0U);
+
+  auto bsize = static_cast<omp_ulong>(rows.Size());
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
+    const int tid = omp_get_thread_num();
+    size_t ibegin = row_ptr[rbegin + i];
+    size_t iend = row_ptr[rbegin + i + 1];
+
+    size_t j = ibegin;
+    rows.ForEach(i, [&](bst_uint fid, bst_float fvalue) {
+      uint32_t idx = cut.GetBinIdx(Entry(fid, fvalue));
+
+      index[j++] = idx;
+      ++hit_count_tloc_[tid * nbins + idx];
+    });
+    CHECK_EQ(j, iend);
+    std::sort(index.begin() + ibegin, index.begin() + iend);
+  }
 
-    CHECK_GT(cut.cut.size(), 0U);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
+    for (size_t tid = 0; tid < nthread; ++tid) {
+      hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
+      hit_count_tloc_[tid * nbins + idx] = 0; // reset for next batch
+    }
+  }
+}
 
-    auto bsize = static_cast<omp_ulong>(batch.Size());
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
-      const int tid = omp_get_thread_num();
-      size_t ibegin = row_ptr[rbegin + i];
-      size_t iend = row_ptr[rbegin + i + 1];
-      SparsePage::Inst inst = batch[i];
+constexpr uint32_t GHistIndexMatrix::kNoBin;
 
-      CHECK_EQ(ibegin + inst.size(), iend);
-      for (bst_uint j = 0; j < inst.size(); ++j) {
-        uint32_t idx = cut.GetBinIdx(inst[j]);
+void GHistIndexMatrix::BundleFeatures(const tree::TrainParam& param) {
+  const size_t nrow = row_ptr.size() - 1;
+  const auto nfeature = static_cast<bst_uint>(cut.row_ptr.size() - 1);
+  const uint32_t nbins = cut.row_ptr.back();
 
-        index[ibegin + j] = idx;
-        ++hit_count_tloc_[tid * nbins + idx];
+  // the default of a feature is missing if some rows miss it, else its most
+  // frequent bin; nnz counts the rows off the default
+  default_bin.assign(nfeature, kNoBin);
+  std::vector<size_t> feature_nnz(nfeature);
+  std::vector<bst_uint> bin_feature(nbins);
+  for (bst_uint fid = 0; fid < nfeature; ++fid) {
+    size_t total = 0;
+    uint32_t top = kNoBin;
+    for (uint32_t i = cut.row_ptr[fid]; i < cut.row_ptr[fid + 1]; ++i) {
+      bin_feature[i] = fid;
+      total += hit_count[i];
+      if (top == kNoBin || hit_count[i] > hit_count[top]) {
+        top = i;
       }
-      std::sort(index.begin() + ibegin, index.begin() + iend);
     }
+    if (top != kNoBin && total == nrow) {
+      default_bin[fid] = top;
+      feature_nnz[fid] = nrow - hit_count[top];
+    } else {
+      feature_nnz[fid] = total;
+    }
+  }
 
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
-      for (size_t tid = 0; tid < nthread; ++tid) {
-        hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
-        hit_count_tloc_[tid * nbins + idx] = 0; // reset for next batch
+  // rows off the default of each feature
+  std::vector<size_t> col_ptr(nfeature + 1, 0);
+  std::partial_sum(feature_nnz.begin(), feature_nnz.end(), col_ptr.begin() + 1);
+  std::vector<size_t> col_rows(col_ptr.back());
+  {
+    std::vector<size_t> cursor(col_ptr.begin(), col_ptr.end() - 1);
+    for (size_t rid = 0; rid < nrow; ++rid) {
+      for (size_t j = row_ptr[rid]; j < row_ptr[rid + 1]; ++j) {
+        const bst_uint fid = bin_feature[index[j]];
+        if (index[j] != default_bin[fid]) {
+          col_rows[cursor[fid]++] = rid;
+        }
       }
     }
+  }
 
-    prev_sum = row_ptr[rbegin + batch.Size()];
-    rbegin += batch.Size();
+  // greedy bundling, features with the most rows off their default first: a
+  // feature joins the first bundle it conflicts with in at most the remaining
+  // budget of max_conflict_rate * nrow rows
+  std::vector<bst_uint> features(nfeature);
+  std::iota(features.begin(), features.end(), 0);
+  std::stable_sort(features.begin(), features.end(), [&](bst_uint a, bst_uint b) {
+    return feature_nnz[a] > feature_nnz[b];
+  });
+  const auto max_conflict_cnt = static_cast<size_t>(param.max_conflict_rate * nrow);
+  // a bundle is closed once even the sparsest feature would not fit
+  size_t min_nnz = nrow;
+  for (size_t nnz : feature_nnz) {
+    if (nnz > 0) {
+      min_nnz = std::min(min_nnz, nnz);
+    }
+  }
+  std::vector<std::vector<bst_uint>> bundles;
+  // rows off the default in each bundle, only kept while another feature fits
+  std::vector<std::vector<bool>> bundle_rows;
+  std::vector<size_t> bundle_nnz;
+  std::vector<size_t> bundle_conflict_cnt;
+  for (bst_uint fid : features) {
+    const size_t* rbegin = dmlc::BeginPtr(col_rows) + col_ptr[fid];
+    const size_t* rend = dmlc::BeginPtr(col_rows) + col_ptr[fid + 1];
+    size_t bid = bundles.size();
+    unsigned nsearch = 0;
+    for (size_t b = 0; b < bundles.size(); ++b) {
+      if (bundle_nnz[b] + feature_nnz[fid] > nrow + max_conflict_cnt) {
+        continue;
+      }
+      if (param.max_search_group > 0 && nsearch++ == param.max_search_group) {
+        break;
+      }
+      const size_t rest_cnt = max_conflict_cnt - bundle_conflict_cnt[b];
+      size_t cnt = 0;
+      for (const size_t* p = rbegin; p != rend && cnt <= rest_cnt; ++p) {
+        cnt += bundle_rows[b][*p];
+      }
+      if (cnt <= rest_cnt) {
+        bid = b;
+        bundle_conflict_cnt[b] += cnt;
+        bundle_nnz[b] += feature_nnz[fid] - cnt;
+        break;
+      }
+    }
+    if (bid == bundles.size()) {
+      bundles.emplace_back();
+      bundle_rows.emplace_back();
+      bundle_nnz.push_back(feature_nnz[fid]);
+      bundle_conflict_cnt.push_back(0);
+    }
+    bundles[bid].push_back(fid);
+    if (bundle_nnz[bid] + min_nnz > nrow + max_conflict_cnt) {
+      std::vector<bool>().swap(bundle_rows[bid]);
+    } else {
+      bundle_rows[bid].resize(nrow, false);
+      for (const size_t* p = rbegin; p != rend; ++p) {
+        bundle_rows[bid][*p] = true;
+      }
+    }
+  }
+  if (bundles.size() == nfeature) {
+    default_bin.clear();
+    return;
+  }
+
+  // lay out the bins of each bundle: the bins of its features one after the
+  // other, without their default bins. A feature on its own keeps every bin.
+  bundle_ptr.assign(1, 0);
+  feature_bundle.resize(nfeature);
+  bundled_bin.assign(nbins, kNoBin);
+  cut_bin.clear();
+  for (uint32_t bid = 0; bid < bundles.size(); ++bid) {
+    for (bst_uint fid : bundles[bid]) {
+      feature_bundle[fid] = bid;
+      if (bundles[bid].size() == 1) {
+        default_bin[fid] = kNoBin;
+      }
+      for (uint32_t i = cut.row_ptr[fid]; i < cut.row_ptr[fid + 1]; ++i) {
+        if (i != default_bin[fid]) {
+          bundled_bin[i] = static_cast<uint32_t>(cut_bin.size());
+          cut_bin.push_back(i);
+        }
+      }
+    }
+    bundle_ptr.push_back(static_cast<uint32_t>(cut_bin.size()));
+  }
+
+  // translate the rows in place; of the features of a bundle off their
+  // default in the same row, only the first one added to the bundle is kept
+  const auto nrow_omp = static_cast<omp_ulong>(nrow);
+  std::vector<size_t> new_row_ptr(nrow + 1, 0);
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow_omp; ++i) {  // NOLINT(*)
+    uint32_t* begin = dmlc::BeginPtr(index) + row_ptr[i];
+    uint32_t* end = begin;
+    for (size_t j = row_ptr[i]; j < row_ptr[i + 1]; ++j) {
+      if (bundled_bin[index[j]] != kNoBin) {
+        *end++ = bundled_bin[index[j]];
+      }
+    }
+    std::sort(begin, end);
+    end = std::unique(begin, end, [&](uint32_t a, uint32_t b) {
+      return feature_bundle[bin_feature[cut_bin[a]]] ==
+             feature_bundle[bin_feature[cut_bin[b]]];
+    });
+    new_row_ptr[i + 1] = end - begin;
+  }
+  std::partial_sum(new_row_ptr.begin(), new_row_ptr.end(), new_row_ptr.begin());
+  std::vector<uint32_t> new_index(new_row_ptr.back());
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow_omp; ++i) {  // NOLINT(*)
+    std::copy_n(dmlc::BeginPtr(index) + row_ptr[i], new_row_ptr[i + 1] - new_row_ptr[i],
+                dmlc::BeginPtr(new_index) + new_row_ptr[i]);
+  }
+  size_t nconflict = 0;
+  for (size_t cnt : bundle_conflict_cnt) {
+    nconflict += cnt;
+  }
+  LOG(INFO) << "Feature bundling: " << nfeature << " features in " << bundles.size()
+            << " bundles, " << nbins << " bins in " << cut_bin.size() << ", "
+            << index.size() << " entries in " << new_index.size()
+            << ", " << nconflict << " conflicting rows";
+  row_ptr.swap(new_row_ptr);
+  index.swap(new_index);
+  hit_count.assign(cut_bin.size(), 0);
+  for (uint32_t bin : index) {
+    ++hit_count[bin];
+  }
+}
+
+void GHistIndexMatrix::UnbundleHist(bst_uint fid, const tree::GradStats* hist,
+                                    const tree::GradStats* total, int ngroup,
+                                    tree::GradStats* out) const {
+  const uint32_t ibegin = cut.row_ptr[fid];
+  const uint32_t iend = cut.row_ptr[fid + 1];
+  const uint32_t dflt = default_bin[fid];
+  for (uint32_t i = ibegin; i < iend; ++i) {
+    if (i != dflt) {
+      const tree::GradStats* bin = hist + static_cast<size_t>(bundled_bin[i]) * ngroup;
+      std::copy(bin, bin + ngroup, out + static_cast<size_t>(i) * ngroup);
+    }
+  }
+  if (dflt == kNoBin) {
+    return;
+  }
+  // rows without an entry of fid, also those of the other features of its
+  // bundle, lie in the default bin
+  for (int k = 0; k < ngroup; ++k) {
+    tree::GradStats rest;
+    for (uint32_t i = ibegin; i < iend; ++i) {
+      if (i != dflt) {
+        rest.Add(out[static_cast<size_t>(i) * ngroup + k]);
+      }
+    }
+    out[static_cast<size_t>(dflt) * ngroup + k].SetSubstract(total[k], rest);
   }
 }
 
@@ -432,7 +705,7 @@ FastFeatureGrouping(const GHistIndexMatrix& gmat,
                     const ColumnMatrix& colmat,
                     const tree::TrainParam& param) {
   const size_t nrow = gmat.row_ptr.size() - 1;
-  const size_t nfeature = gmat.cut.row_ptr.size() - 1;
+  const size_t nfeature = gmat.ColumnPtr().size() - 1;
 
   std::vector<unsigned> feature_list(nfeature);
   std::iota(feature_list.begin(), feature_list.end(), 0);
@@ -488,7 +761,7 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
   cut_ = &gmat.cut;
 
   const size_t nrow = gmat.row_ptr.size() - 1;
-  const uint32_t nbins = gmat.cut.row_ptr.back();
+  const uint32_t nbins = gmat.NumBins();
 
   /* step 1: form feature groups */
   auto groups = FastFeatureGrouping(gmat, colmat, param);
@@ -498,8 +771,8 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
   std::vector<uint32_t> bin2block(nbins);  // lookup table [bin id] => [block id]
   for (uint32_t group_id = 0; group_id < nblock; ++group_id) {
     for (auto& fid : groups[group_id]) {
-      const uint32_t bin_begin = gmat.cut.row_ptr[fid];
-      const uint32_t bin_end = gmat.cut.row_ptr[fid + 1];
+      const uint32_t bin_begin = gmat.ColumnPtr()[fid];
+      const uint32_t bin_end = gmat.ColumnPtr()[fid + 1];
       for (uint32_t bin_id = bin_begin; bin_id < bin_end; ++bin_id) {
         bin2block[bin_id] = group_id;
       }
@@ -546,10 +819,21 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
   }
 }
 
+// gradient of row rid, counted multiplicity[rid] times
+inline GradientPair RowGradient(const std::vector<GradientPair>& gpair,
+                                const uint8_t* multiplicity, size_t rid) {
+  if (multiplicity == nullptr) {
+    return gpair[rid];
+  }
+  const float k = multiplicity[rid];
+  return GradientPair(gpair[rid].GetGrad() * k, gpair[rid].GetHess() * k);
+}
+
 void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
                              const RowSetCollection::Elem row_indices,
                              const GHistIndexMatrix& gmat,
-                             GHistRow hist) {
+                             GHistRow hist,
+                             const uint8_t* multiplicity) {
   const size_t nthread = static_cast<size_t>(this->nthread_);
   data_.resize(nbins_ * nthread_);
 
@@ -596,12 +880,15 @@ void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
         PREFETCH_READ_T0(pgh + 2*rid[i + prefetch_offset]);
       }
 
+      const size_t idx_gh = 2*rid[i];
+      const float k = multiplicity == nullptr ? 1.0f : multiplicity[rid[i]];
+      const float grad = pgh[idx_gh] * k;
+      const float hess = pgh[idx_gh+1] * k;
       for (size_t j = icol_start; j < icol_end; ++j) {
         const uint32_t idx_bin = 2*index[j];
-        const size_t idx_gh = 2*rid[i];
 
-        data_local_hist[idx_bin] += pgh[idx_gh];
-        data_local_hist[idx_bin+1] += pgh[idx_gh+1];
+        data_local_hist[idx_bin] += grad;
+        data_local_hist[idx_bin+1] += hess;
       }
     }
   }
@@ -637,10 +924,57 @@ void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
   }
 }
 
+void GHistBuilder::BuildHistColumnWise(const std::vector<GradientPair>& gpair,
+                                       const RowSetCollection::Elem row_indices,
+                                       const ColumnMatrix& column_matrix,
+                                       GHistRow hist,
+                                       const uint8_t* multiplicity) {
+  const auto nfeature = static_cast<bst_omp_uint>(column_matrix.GetNumFeature());
+  const size_t* rid = row_indices.begin;
+  const size_t nrows = row_indices.Size();
+  const auto nthread = static_cast<bst_omp_uint>(this->nthread_);
+  tree::GradStats* p_hist = hist.data();
+
+  // features own disjoint bin ranges, threads never write to the same bin
+#pragma omp parallel for num_threads(nthread) schedule(dynamic)
+  for (bst_omp_uint fid = 0; fid < nfeature; ++fid) {
+    const Column column = column_matrix.GetColumn(fid);
+    tree::GradStats* p_fhist = p_hist + column.GetBaseIdx();
+    const uint32_t nbins = (fid + 1 < nfeature ?
+                            column_matrix.GetColumn(fid + 1).GetBaseIdx() :
+                            static_cast<uint32_t>(hist.size())) - column.GetBaseIdx();
+    std::fill(p_fhist, p_fhist + nbins, tree::GradStats());
+
+    if (column.GetType() == kDenseColumn) {
+      for (size_t i = 0; i < nrows; ++i) {
+        const size_t row = rid[i];
+        if (!column.IsMissing(row)) {
+          p_fhist[column.GetFeatureBinIdx(row)].Add(RowGradient(gpair, multiplicity, row));
+        }
+      }
+    } else {
+      // both the node's rows and the column's rows are sorted, skip ahead in
+      // the column with a binary search
+      const size_t* col_begin = column.GetRowData();
+      const size_t* col_end = col_begin + column.Size();
+      const size_t* p = col_begin;
+      for (size_t i = 0; i < nrows && p != col_end; ++i) {
+        p = std::lower_bound(p, col_end, rid[i]);
+        if (p != col_end && *p == rid[i]) {
+          p_fhist[column.GetFeatureBinIdx(p - col_begin)].Add(
+              RowGradient(gpair, multiplicity, rid[i]));
+          ++p;
+        }
+      }
+    }
+  }
+}
+
 void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
                                   const RowSetCollection::Elem row_indices,
                                   const GHistIndexBlockMatrix& gmatb,
-                                  GHistRow hist) {
+                                  GHistRow hist,
+                                  const uint8_t* multiplicity) {
   constexpr int kUnroll = 8;  // loop unrolling factor
   const size_t nblock = gmatb.GetNumBlock();
   const size_t nrows = row_indices.end - row_indices.begin;
@@ -665,7 +999,7 @@ void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
         rid[k] = row_indices.begin[i + k];
         ibegin[k] = gmat.row_ptr[rid[k]];
         iend[k] = gmat.row_ptr[rid[k] + 1];
-        stat[k] = gpair[rid[k]];
+        stat[k] = RowGradient(gpair, multiplicity, rid[k]);
       }
       for (int k = 0; k < kUnroll; ++k) {
         for (size_t j = ibegin[k]; j < iend[k]; ++j) {
@@ -678,7 +1012,7 @@ void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
       const size_t rid = row_indices.begin[i];
       const size_t ibegin = gmat.row_ptr[rid];
       const size_t iend = gmat.row_ptr[rid + 1];
-      const GradientPair stat = gpair[rid];
+      const GradientPair stat = RowGradient(gpair, multiplicity, rid);
       for (size_t j = ibegin; j < iend; ++j) {
         const uint32_t bin = gmat.index[j];
         p_hist[bin].Add(stat);
@@ -719,5 +1053,116 @@ void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow pa
   }
 }
 
+void GHistAllreducer::Init(uint32_t nbins, int precision) {
+  nbins_ = nbins;
+  precision_ = precision;
+}
+
+void GHistAllreducer::Allreduce(const std::vector<GHistRow>& hists) {
+  if (hists.empty()) {
+    return;
+  }
+  switch (precision_) {
+    case tree::TrainParam::kSyncFloat:
+      this->AllreduceFloat(hists);
+      break;
+    case tree::TrainParam::kSyncInt:
+      this->AllreduceInt(hists);
+      break;
+    default: {
+      // rows of consecutive nodes are usually adjacent, reduce each run at once
+      size_t i = 0;
+      while (i < hists.size()) {
+        size_t j = i + 1;
+        while (j < hists.size() &&
+               hists[j].data() == hists[j - 1].data() + nbins_) {
+          ++j;
+        }
+        histred_.Allreduce(hists[i].data(), nbins_ * (j - i));
+        i = j;
+      }
+    }
+  }
+}
+
+void GHistAllreducer::LoadValues(const std::vector<GHistRow>& hists) {
+  const size_t nbins = nbins_;
+  values_.resize(hists.size() * nbins * 2);
+  for (size_t k = 0; k < hists.size(); ++k) {
+    GHistRow hist = hists[k];
+    double* out = dmlc::BeginPtr(values_) + k * nbins * 2;
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nbins; ++i) {  // NOLINT(*)
+      out[i * 2] = hist[i].sum_grad;
+      out[i * 2 + 1] = hist[i].sum_hess;
+    }
+  }
+}
+
+void GHistAllreducer::AllreduceFloat(const std::vector<GHistRow>& hists) {
+  this->LoadValues(hists);
+  const auto n = static_cast<omp_ulong>(values_.size());
+  const omp_ulong nvalues = nbins_ * 2;
+  float_buffer_.resize(values_.size());
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+    float_buffer_[i] = static_cast<float>(values_[i]);
+  }
+  rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(float_buffer_), float_buffer_.size());
+  for (size_t k = 0; k < hists.size(); ++k) {
+    GHistRow hist = hists[k];
+    const float* in = dmlc::BeginPtr(float_buffer_) + k * nvalues;
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nbins_; ++i) {  // NOLINT(*)
+      hist[i].sum_grad = in[i * 2];
+      hist[i].sum_hess = in[i * 2 + 1];
+    }
+  }
+}
+
+void GHistAllreducer::AllreduceInt(const std::vector<GHistRow>& hists) {
+  this->LoadValues(hists);
+  const size_t nnode = hists.size();
+  const omp_ulong nvalues = nbins_ * 2;
+  // a common scale per node and per grad/hess, so that the sum over all
+  // workers still fits into int32
+  std::vector<double> max_abs(nnode * 2, 0.0);
+  for (size_t k = 0; k < nnode; ++k) {
+    const double* v = dmlc::BeginPtr(values_) + k * nvalues;
+    for (omp_ulong i = 0; i < nvalues; ++i) {
+      max_abs[k * 2 + i % 2] = std::max(max_abs[k * 2 + i % 2], std::fabs(v[i]));
+    }
+  }
+  rabit::Allreduce<rabit::op::Max>(dmlc::BeginPtr(max_abs), max_abs.size());
+  const double range = static_cast<double>(std::numeric_limits<int32_t>::max() - 1) /
+                       rabit::GetWorldSize();
+  std::vector<double> scale(nnode * 2);
+  for (size_t i = 0; i < scale.size(); ++i) {
+    scale[i] = max_abs[i] > 0.0 ? range / max_abs[i] : 1.0;
+  }
+
+  int_buffer_.resize(values_.size());
+  for (size_t k = 0; k < nnode; ++k) {
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nvalues; ++i) {  // NOLINT(*)
+      const omp_ulong j = k * nvalues + i;
+      const double s = scale[k * 2 + i % 2];
+      int_buffer_[j] = static_cast<int32_t>(std::round(values_[j] * s));
+    }
+  }
+  rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(int_buffer_), int_buffer_.size());
+  for (size_t k = 0; k < nnode; ++k) {
+    GHistRow hist = hists[k];
+    const int32_t* in = dmlc::BeginPtr(int_buffer_) + k * nvalues;
+    const double grad_scale = scale[k * 2];
+    const double hess_scale = scale[k * 2 + 1];
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nbins_; ++i) {  // NOLINT(*)
+      hist[i].sum_grad = in[i * 2] / grad_scale;
+      hist[i].sum_hess = in[i * 2 + 1] / hess_scale;
+    }
+  }
+}
+
 }  // namespace common
 }  // namespace xgboost
@@ -108,7 +108,16 @@ struct HistCutMatrix {
   // using approximate quantile sketch approach
   void Init(DMatrix* p_fmat, uint32_t max_num_bins);
 
-  void Init(std::vector<WXQSketch>* sketchs, uint32_t max_num_bins);
+  /*! \brief largest category id accepted for a categorical feature */
+  static constexpr uint32_t kMaxCategory = 1 << 16;
+
+  /*!
+   * \brief create cuts from sketches. A categorical feature gets one bin per
+   *  category id in [0, max category], so that bin k holds category k. Ids
+   *  above kMaxCategory are rejected, they must be encoded densely.
+   */
+  void Init(std::vector<WXQSketch>* sketchs, uint32_t max_num_bins,
+            std::vector<FeatureType> const& feature_types = {});
 
   HistCutMatrix();
   size_t NumBins() const { return row_ptr.back(); }
@@ -145,19 +154,68 @@ struct GHistIndexMatrix {
   std::vector<size_t> hit_count;
   /*! \brief The corresponding cuts */
   HistCutMatrix cut;
+  /*!
+   * \brief bin range of every feature bundle in index; empty unless
+   *  BundleFeatures merged features, in which case index, hit_count and the
+   *  histograms are over the bins of the bundles instead of those of cut
+   */
+  std::vector<uint32_t> bundle_ptr;
+  /*! \brief bundle of each feature */
+  std::vector<uint32_t> feature_bundle;
+  /*! \brief bin in index of each bin of cut, kNoBin for dropped default bins */
+  std::vector<uint32_t> bundled_bin;
+  /*! \brief bin of cut of each bin in index */
+  std::vector<uint32_t> cut_bin;
+  /*!
+   * \brief bin of cut that rows without an entry of a feature lie in, kNoBin
+   *  if those rows miss the feature
+   */
+  std::vector<uint32_t> default_bin;
+  static constexpr uint32_t kNoBin = std::numeric_limits<uint32_t>::max();
   // Create a global histogram matrix, given cut
   void Init(DMatrix* p_fmat, int max_num_bins);
+  // Exclusive feature bundling: greedily merge features that rarely leave
+  // their default in the same row into bundles, up to param.max_conflict_rate
+  // conflicting rows per bundle, and store one entry per row and bundle with
+  // the non-default bins of its features laid out one after the other
+  void BundleFeatures(const tree::TrainParam& param);
+  inline bool IsBundled() const {
+    return !bundle_ptr.empty();
+  }
+  // bin range of every column of index, the features or the feature bundles
+  inline const std::vector<uint32_t>& ColumnPtr() const {
+    return this->IsBundled() ? bundle_ptr : cut.row_ptr;
+  }
+  // number of bins of index, i.e. the width of a histogram
+  inline uint32_t NumBins() const {
+    return this->ColumnPtr().back();
+  }
+  // column of index holding the bins of feature fid
+  inline bst_uint FeatureColumn(bst_uint fid) const {
+    return this->IsBundled() ? feature_bundle[fid] : fid;
+  }
+  /*!
+   * \brief histogram of feature fid over its bins of cut
+   * \param hist histogram over the bins of index, ngroup entries per bin
+   * \param total sums of the node, ngroup entries
+   * \param out histogram over the bins of cut, only the bins of fid are written
+   */
+  void UnbundleHist(bst_uint fid, const tree::GradStats* hist,
+                    const tree::GradStats* total, int ngroup,
+                    tree::GradStats* out) const;
   // get i-th row
   inline GHistIndexRow operator[](size_t i) const {
     return {&index[0] + row_ptr[i],
             static_cast<GHistIndexRow::index_type>(
                 row_ptr[i + 1] - row_ptr[i])};
   }
+  // number of entries of every column of index
   inline void GetFeatureCounts(size_t* counts) const {
-    auto nfeature = cut.row_ptr.size() - 1;
+    const std::vector<uint32_t>& col_ptr = this->ColumnPtr();
+    auto nfeature = col_ptr.size() - 1;
     for (unsigned fid = 0; fid < nfeature; ++fid) {
-      auto ibegin = cut.row_ptr[fid];
-      auto iend = cut.row_ptr[fid + 1];
+      auto ibegin = col_ptr[fid];
+      auto iend = col_ptr[fid + 1];
       for (auto i = ibegin; i < iend; ++i) {
         counts[fid] += hit_count[i];
       }
@@ -165,6 +223,11 @@ struct GHistIndexMatrix {
   }
 
  private:
+  // fill row_ptr, index and hit_count of rows [rbegin, rbegin + rows.Size())
+  // from rows read like ExternalRows
+  template <typename Rows>
+  void PushRows(const Rows& rows, size_t rbegin);
+
   std::vector<size_t> hit_count_tloc_;
 };
 
@@ -274,16 +337,27 @@ class GHistBuilder {
     thread_init_.resize(nthread_);
   }
 
-  // construct a histogram via histogram aggregation
+  // construct a histogram via histogram aggregation.
+  // multiplicity, if given, holds the number of times each row is counted
   void BuildHist(const std::vector<GradientPair>& gpair,
                  const RowSetCollection::Elem row_indices,
                  const GHistIndexMatrix& gmat,
-                 GHistRow hist);
+                 GHistRow hist,
+                 const uint8_t* multiplicity = nullptr);
+  // same, parallel over features: each thread owns a range of features and
+  // accumulates straight into hist, so no reduction is needed.
+  // row_indices must be sorted in ascending order.
+  void BuildHistColumnWise(const std::vector<GradientPair>& gpair,
+                           const RowSetCollection::Elem row_indices,
+                           const ColumnMatrix& column_matrix,
+                           GHistRow hist,
+                           const uint8_t* multiplicity = nullptr);
   // same, with feature grouping
   void BuildBlockHist(const std::vector<GradientPair>& gpair,
                       const RowSetCollection::Elem row_indices,
                       const GHistIndexBlockMatrix& gmatb,
-                      GHistRow hist);
+                      GHistRow hist,
+                      const uint8_t* multiplicity = nullptr);
   // construct a histogram via subtraction trick
   void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent);
 
@@ -300,6 +374,37 @@ class GHistBuilder {
   std::vector<tree::GradStats> data_;
 };
 
+/*!
+ * \brief sums histograms of several nodes across workers with one allreduce.
+ *  The histograms can be sent as float or as 32-bit integers scaled to the
+ *  largest magnitude of each node and of grad/hess, so that the rounding
+ *  error of every bin stays relative to the node it belongs to.
+ *  The rounding error is not fed back: a node's histogram is sent only once,
+ *  and the error of the sibling derived from it by subtraction is the sum of
+ *  the residuals of all workers, which would take another allreduce to know.
+ */
+class GHistAllreducer {
+ public:
+  // precision is one of tree::TrainParam::HistSyncPrecision
+  void Init(uint32_t nbins, int precision);
+  // sum the histograms across workers, in place
+  void Allreduce(const std::vector<GHistRow>& hists);
+
+ private:
+  void AllreduceFloat(const std::vector<GHistRow>& hists);
+  void AllreduceInt(const std::vector<GHistRow>& hists);
+  // copy the histograms into values_
+  void LoadValues(const std::vector<GHistRow>& hists);
+
+  uint32_t nbins_ {0};
+  int precision_ {0};
+  // histograms of all nodes, two values per bin
+  std::vector<double> values_;
+  std::vector<float> float_buffer_;
+  std::vector<int32_t> int_buffer_;
+  rabit::Reducer<tree::GradStats, tree::GradStats::Reduce> histred_;
+};
+
 
 }  // namespace common
 }  // namespace xgboost
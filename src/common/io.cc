@@ -0,0 +1,78 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file io.cc
+ * \brief memory mapped view of local files
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define XGBOOST_MMAP_ENABLED 1
+#endif  // defined(__unix__) || defined(__APPLE__)
+
+#include <dmlc/io.h>
+#include <xgboost/logging.h>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include "io.h"
+
+namespace xgboost {
+namespace common {
+
+MappedFile::MappedFile(const std::string& fname) {
+  const std::string kProtocol = "file://";
+  CHECK(fname.find("://") == std::string::npos || fname.compare(0, kProtocol.size(), kProtocol) == 0)
+      << "only local files can be memory mapped, got " << fname;
+  const std::string path = fname.compare(0, kProtocol.size(), kProtocol) == 0
+      ? fname.substr(kProtocol.size()) : fname;
+#if defined(XGBOOST_MMAP_ENABLED)
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "cannot open " << path << ": " << std::strerror(errno);
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "cannot stat " << path << ": " << std::strerror(errno);
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ != 0) {
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    CHECK(ptr != MAP_FAILED) << "cannot mmap " << path << ": " << std::strerror(errno);
+    data_ = static_cast<const char*>(ptr);
+    mapped_ = true;
+  }
+  close(fd);
+#else
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(path.c_str(), "r"));
+  const size_t kChunk = 1 << 20;
+  size_t nread;
+  do {
+    buffer_.resize(buffer_.size() + kChunk);
+    nread = fi->Read(&buffer_[buffer_.size() - kChunk], kChunk);
+    buffer_.resize(buffer_.size() - kChunk + nread);
+  } while (nread != 0);
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#endif  // defined(XGBOOST_MMAP_ENABLED)
+}
+
+MappedFile::~MappedFile() {
+#if defined(XGBOOST_MMAP_ENABLED)
+  if (mapped_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+#endif  // defined(XGBOOST_MMAP_ENABLED)
+}
+
+void MappedFile::AdviseSequential(size_t begin, size_t size) const {
+#if defined(XGBOOST_MMAP_ENABLED)
+  if (!mapped_ || size == 0) return;
+  // madvise wants a page aligned address
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t aligned = begin / page * page;
+  char* ptr = const_cast<char*>(data_) + aligned;
+  madvise(ptr, size + (begin - aligned), MADV_SEQUENTIAL);
+#endif  // defined(XGBOOST_MMAP_ENABLED)
+}
+
+}  // namespace common
+}  // namespace xgboost
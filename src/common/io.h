@@ -70,6 +70,32 @@ class PeekableInStream : public dmlc::Stream {
   /*! \brief internal buffer */
   std::string buffer_;
 };
+
+/*!
+ * \brief Read-only view of a whole local file. On POSIX systems the file is
+ *  memory mapped, so pages are only read when touched and are shared through
+ *  the page cache; elsewhere the content is read into memory.
+ */
+class MappedFile {
+ public:
+  /*! \param fname local file name, optionally prefixed by file:// */
+  explicit MappedFile(const std::string& fname);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+  /*! \return pointer to the first byte of the file */
+  const char* Data() const { return data_; }
+  /*! \return size of the file in bytes */
+  size_t Size() const { return size_; }
+  /*! \brief hint that the range [begin, begin + size) is read sequentially */
+  void AdviseSequential(size_t begin, size_t size) const;
+
+ private:
+  const char* data_{nullptr};
+  size_t size_{0};
+  bool mapped_{false};
+  std::string buffer_;
+};
 }  // namespace common
 }  // namespace xgboost
 #endif  // XGBOOST_COMMON_IO_H_
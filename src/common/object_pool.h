@@ -0,0 +1,86 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file object_pool.h
+ * \brief Lock-free pool of reusable objects, such as the scratch buffers of
+ *  one prediction call.
+ */
+#ifndef XGBOOST_COMMON_OBJECT_POOL_H_
+#define XGBOOST_COMMON_OBJECT_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief A fixed number of slots holding idle objects. Acquire takes an object
+ *  out of a slot, or allocates one when all slots are empty; releasing puts it
+ *  back into an empty slot, or frees it when all slots are taken. Slots are
+ *  only swapped atomically, so any number of threads may share the pool.
+ */
+template <typename T>
+class ObjectPool {
+ public:
+  static constexpr size_t kSlots = 64;
+
+  /*! \brief exclusive use of one pooled object, returned to the pool on destruction */
+  class Handle {
+   public:
+    Handle(Handle&& other) noexcept : pool_(other.pool_), obj_(other.obj_) {
+      other.obj_ = nullptr;
+    }
+    Handle(const Handle&) = delete;
+    Handle& operator=(const Handle&) = delete;
+    ~Handle() {
+      if (obj_ != nullptr) pool_->Release(obj_);
+    }
+    inline T* operator->() const { return obj_; }
+    inline T& operator*() const { return *obj_; }
+
+   private:
+    friend class ObjectPool;
+    Handle(ObjectPool* pool, T* obj) : pool_(pool), obj_(obj) {}
+    ObjectPool* pool_;
+    T* obj_;
+  };
+
+  ObjectPool() {
+    for (auto& slot : slots_) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+  ~ObjectPool() {
+    for (auto& slot : slots_) {
+      delete slot.load(std::memory_order_relaxed);
+    }
+  }
+  /*! \brief take an idle object, or a new default constructed one */
+  inline Handle Acquire() {
+    for (auto& slot : slots_) {
+      T* obj = slot.exchange(nullptr, std::memory_order_acquire);
+      if (obj != nullptr) return Handle(this, obj);
+    }
+    return Handle(this, new T());
+  }
+
+ private:
+  inline void Release(T* obj) {
+    for (auto& slot : slots_) {
+      T* expected = nullptr;
+      if (slot.compare_exchange_strong(expected, obj, std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+    }
+    delete obj;
+  }
+
+  std::atomic<T*> slots_[kSlots];
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_OBJECT_POOL_H_
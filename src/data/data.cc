@@ -9,6 +9,7 @@
 #include "./sparse_page_writer.h"
 #include "./simple_dmatrix.h"
 #include "./simple_csr_source.h"
+#include "./mapped_dmatrix.h"
 #include "../common/common.h"
 #include "../common/io.h"
 
@@ -31,6 +32,7 @@ void MetaInfo::Clear() {
   qids_.clear();
   weights_.HostVector().clear();
   base_margin_.HostVector().clear();
+  feature_types_.clear();
 }
 
 void MetaInfo::SaveBinary(dmlc::Stream *fo) const {
@@ -143,6 +145,16 @@ void MetaInfo::SetInfo(const char* key, const void* dptr, DataType dtype, size_t
     for (size_t i = 1; i < group_ptr_.size(); ++i) {
       group_ptr_[i] = group_ptr_[i - 1] + group_ptr_[i];
     }
+  } else if (!std::strcmp(key, "feature_type")) {
+    std::vector<uint32_t> types(num);
+    DISPATCH_CONST_PTR(dtype, dptr, cast_dptr,
+                       std::copy(cast_dptr, cast_dptr + num, types.begin()));
+    feature_types_.resize(num);
+    for (size_t i = 0; i < num; ++i) {
+      CHECK_LE(types[i], static_cast<uint32_t>(FeatureType::kCategorical))
+          << "feature_type must be 0 (numerical) or 1 (categorical)";
+      feature_types_[i] = static_cast<FeatureType>(types[i]);
+    }
   }
 }
 
@@ -198,7 +210,7 @@ DMatrix* DMatrix::Load(const std::string& uri,
   }
   // legacy handling of binary data loading
   if (file_format == "auto" && npart == 1) {
-    int magic;
+    int magic = 0;
     std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r", true));
     if (fi != nullptr) {
       common::PeekableInStream is(fi.get());
@@ -213,6 +225,22 @@ DMatrix* DMatrix::Load(const std::string& uri,
         }
         return dmat;
       }
+      if (magic == data::SimpleCSRSource::kMagicPageAligned) {
+        fi.reset();
+        DMatrix* dmat = new data::MappedDMatrix(fname);
+        if (cache_file.length() != 0) {
+          // external memory writes pages of its own, read the rows once
+          std::unique_ptr<DMatrix> mapped(dmat);
+          std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+          source->CopyFrom(mapped.get());
+          dmat = DMatrix::Create(std::move(source), cache_file);
+        }
+        if (!silent) {
+          LOG(CONSOLE) << dmat->Info().num_row_ << 'x' << dmat->Info().num_col_ << " matrix with "
+                       << dmat->Info().num_nonzero_ << " entries mapped from " << uri;
+        }
+        return dmat;
+      }
     }
   }
 
@@ -277,6 +305,13 @@ void DMatrix::SaveToLocalFile(const std::string& fname) {
   source.SaveBinary(fo.get());
 }
 
+void DMatrix::SaveToPageAlignedFile(const std::string& fname) {
+  data::SimpleCSRSource source;
+  source.CopyFrom(this);
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
+  source.SavePageAlignedBinary(fo.get());
+}
+
 DMatrix* DMatrix::Create(std::unique_ptr<DataSource>&& source,
                          const std::string& cache_prefix) {
   if (cache_prefix.length() == 0) {
@@ -0,0 +1,194 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file dense_dmatrix.cc
+ * \brief In-memory DMatrix of dense rows, stored without feature indices.
+ */
+#include "./dense_dmatrix.h"
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "../common/math.h"
+#include "./simple_dmatrix.h"
+
+namespace xgboost {
+namespace data {
+
+DenseDMatrix::DenseDMatrix(const bst_float* data, size_t nrow, size_t ncol,
+                           bst_float missing, int nthread)
+    : values_(nrow * ncol) {
+  const bool nan_missing = common::CheckNAN(missing);
+  const auto nsize = static_cast<omp_ulong>(nrow);
+  if (nthread <= 0) nthread = omp_get_max_threads();
+  // entries of every column, counted per thread in the same pass
+  std::vector<size_t> column_size_tloc(nthread * ncol, 0);
+  bool nan_present = false;
+#pragma omp parallel num_threads(nthread) reduction(||:nan_present)
+  {
+    size_t* column_size = dmlc::BeginPtr(column_size_tloc) + omp_get_thread_num() * ncol;
+#pragma omp for schedule(static)
+    for (omp_ulong i = 0; i < nsize; ++i) {
+      const bst_float* row = data + i * ncol;
+      bst_float* out = dmlc::BeginPtr(values_) + i * ncol;
+      for (size_t j = 0; j < ncol; ++j) {
+        if (common::CheckNAN(row[j])) {
+          nan_present = true;
+          out[j] = row[j];
+        } else if (!nan_missing && row[j] == missing) {
+          out[j] = std::numeric_limits<bst_float>::quiet_NaN();
+        } else {
+          out[j] = row[j];
+          ++column_size[j];
+        }
+      }
+    }
+  }
+  column_size_.assign(ncol, 0);
+  uint64_t nnz = 0;
+  for (int tid = 0; tid < nthread; ++tid) {
+    for (size_t j = 0; j < ncol; ++j) {
+      column_size_[j] += column_size_tloc[tid * ncol + j];
+    }
+  }
+  for (size_t j = 0; j < ncol; ++j) {
+    nnz += column_size_[j];
+  }
+  CHECK(nan_missing || !nan_present)
+      << "There are NAN in the matrix, however, you did not set missing=NAN";
+  info_.num_row_ = nrow;
+  info_.num_col_ = ncol;
+  info_.num_nonzero_ = nnz;
+}
+
+float DenseDMatrix::GetColDensity(size_t cidx) {
+  size_t nmiss = info_.num_row_ - column_size_[cidx];
+  return 1.0f - (static_cast<float>(nmiss)) / info_.num_row_;
+}
+
+size_t DenseDMatrix::RowsPerPage() const {
+  return std::max(kPageEntries / std::max(info_.num_col_, uint64_t(1)), size_t(1));
+}
+
+void DenseDMatrix::FillPage(size_t begin, size_t n, SparsePage* page) const {
+  const ExternalRows rows = this->Rows();
+  auto& offset_vec = page->offset.HostVector();
+  auto& data_vec = page->data.HostVector();
+  page->base_rowid = begin;
+  offset_vec.resize(n + 1);
+  offset_vec[0] = 0;
+  const auto nsize = static_cast<omp_ulong>(n);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nsize; ++i) {
+    offset_vec[i + 1] = rows.RowSize(begin + i);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    offset_vec[i + 1] += offset_vec[i];
+  }
+  data_vec.resize(offset_vec.back());
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nsize; ++i) {
+    Entry* out = dmlc::BeginPtr(data_vec) + offset_vec[i];
+    rows.ForEach(begin + i, [&out](bst_uint index, bst_float fvalue) {
+      *out++ = Entry(index, fvalue);
+    });
+  }
+}
+
+/*!
+ * \brief Row pages of a DenseDMatrix. The page is built when first read and
+ *  is owned by the iterator, so it is only valid while the iterator is.
+ */
+class DenseBatchIteratorImpl : public BatchIteratorImpl {
+ public:
+  DenseBatchIteratorImpl(const DenseDMatrix* dmat, size_t begin)
+      : dmat_(dmat), begin_(begin) {}
+  SparsePage& operator*() override {
+    return this->Page();
+  }
+  const SparsePage& operator*() const override {
+    return this->Page();
+  }
+  void operator++() override {
+    begin_ += dmat_->RowsPerPage();
+    filled_ = false;
+  }
+  bool AtEnd() const override { return begin_ >= dmat_->Info().num_row_; }
+  DenseBatchIteratorImpl* Clone() override {
+    return new DenseBatchIteratorImpl(dmat_, begin_);
+  }
+
+ private:
+  SparsePage& Page() const {
+    CHECK(!this->AtEnd());
+    if (!filled_) {
+      const size_t n = std::min(dmat_->RowsPerPage(),
+                                static_cast<size_t>(dmat_->Info().num_row_) - begin_);
+      dmat_->FillPage(begin_, n, &page_);
+      filled_ = true;
+    }
+    return page_;
+  }
+
+  const DenseDMatrix* dmat_;
+  size_t begin_;
+  mutable SparsePage page_;
+  mutable bool filled_{false};
+};
+
+BatchSet DenseDMatrix::GetRowBatches() {
+  auto begin_iter = BatchIterator(new DenseBatchIteratorImpl(this, 0));
+  return BatchSet(begin_iter);
+}
+
+BatchSet DenseDMatrix::GetColumnBatches() {
+  // column page doesn't exist, generate it straight from the block
+  if (!column_page_) {
+    const size_t nrow = info_.num_row_;
+    const size_t ncol = info_.num_col_;
+    column_page_.reset(new SparsePage());
+    auto& offset_vec = column_page_->offset.HostVector();
+    auto& data_vec = column_page_->data.HostVector();
+    offset_vec.resize(ncol + 1);
+    offset_vec[0] = 0;
+    const auto nsize = static_cast<omp_ulong>(ncol);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong j = 0; j < nsize; ++j) {
+      size_t column_size = 0;
+      for (size_t i = 0; i < nrow; ++i) {
+        column_size += !common::CheckNAN(values_[i * ncol + j]);
+      }
+      offset_vec[j + 1] = column_size;
+    }
+    for (size_t j = 0; j < ncol; ++j) {
+      offset_vec[j + 1] += offset_vec[j];
+    }
+    data_vec.resize(offset_vec.back());
+#pragma omp parallel for schedule(static)
+    for (omp_ulong j = 0; j < nsize; ++j) {
+      Entry* out = dmlc::BeginPtr(data_vec) + offset_vec[j];
+      for (size_t i = 0; i < nrow; ++i) {
+        const bst_float fvalue = values_[i * ncol + j];
+        if (!common::CheckNAN(fvalue)) {
+          *out++ = Entry(static_cast<bst_uint>(i), fvalue);
+        }
+      }
+    }
+  }
+  auto begin_iter =
+      BatchIterator(new SimpleBatchIteratorImpl(column_page_.get()));
+  return BatchSet(begin_iter);
+}
+
+BatchSet DenseDMatrix::GetSortedColumnBatches() {
+  // Sorted column page doesn't exist, generate it
+  if (!sorted_column_page_) {
+    sorted_column_page_.reset(new SparsePage(*this->GetColumnBatches().begin()));
+    sorted_column_page_->SortRows();
+  }
+  auto begin_iter =
+      BatchIterator(new SimpleBatchIteratorImpl(sorted_column_page_.get()));
+  return BatchSet(begin_iter);
+}
+}  // namespace data
+}  // namespace xgboost
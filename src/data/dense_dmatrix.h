@@ -0,0 +1,79 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file dense_dmatrix.h
+ * \brief In-memory DMatrix of dense rows, stored without feature indices.
+ */
+#ifndef XGBOOST_DATA_DENSE_DMATRIX_H_
+#define XGBOOST_DATA_DENSE_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+
+/*!
+ * \brief DMatrix holding a row-major block of num_row * num_col values, where
+ *  absent entries are NaN. It takes 4 bytes per cell instead of the 8 bytes of
+ *  an Entry, and no row offsets. Row batches are CSR pages built on demand
+ *  from the block, a bounded number of rows at a time; hot paths read the
+ *  block directly through Rows().
+ */
+class DenseDMatrix : public DMatrix {
+ public:
+  /*!
+   * \brief copy a dense row-major matrix
+   * \param data nrow * ncol values
+   * \param missing value of absent entries, NaN is always absent
+   * \param nthread threads used for the copy, <=0 uses all threads
+   */
+  DenseDMatrix(const bst_float* data, size_t nrow, size_t ncol, bst_float missing,
+               int nthread = 0);
+
+  MetaInfo& Info() override { return info_; }
+
+  const MetaInfo& Info() const override { return info_; }
+
+  float GetColDensity(size_t cidx) override;
+
+  bool SingleColBlock() const override { return true; }
+
+  BatchSet GetRowBatches() override;
+
+  BatchSet GetColumnBatches() override;
+
+  BatchSet GetSortedColumnBatches() override;
+
+  /*! \return the rows read in place, absent entries are NaN */
+  ExternalRows Rows() const {
+    return ExternalRows::Dense(values_.data(), info_.num_row_, info_.num_col_,
+                               std::numeric_limits<bst_float>::quiet_NaN());
+  }
+  /*! \return number of rows of each page of GetRowBatches */
+  size_t RowsPerPage() const;
+  /*!
+   * \brief build the CSR page of rows [begin, begin + n)
+   * \param begin first row of the page
+   * \param n number of rows
+   * \param page the output page
+   */
+  void FillPage(size_t begin, size_t n, SparsePage* page) const;
+
+  /*! \brief upper bound of the entries of one page of GetRowBatches */
+  static const size_t kPageEntries = size_t(1) << 22;
+
+ private:
+  MetaInfo info_;
+  std::vector<bst_float> values_;
+  // number of present entries of every column
+  std::vector<size_t> column_size_;
+  std::unique_ptr<SparsePage> column_page_;
+  std::unique_ptr<SparsePage> sorted_column_page_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_DENSE_DMATRIX_H_
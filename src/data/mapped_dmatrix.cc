@@ -0,0 +1,195 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file mapped_dmatrix.cc
+ * \brief DMatrix read in place from a memory mapped page aligned binary file.
+ */
+#include "./mapped_dmatrix.h"
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../common/group_data.h"
+#include "./dense_dmatrix.h"
+#include "./simple_csr_source.h"
+#include "./simple_dmatrix.h"
+
+namespace xgboost {
+namespace data {
+
+MappedDMatrix::MappedDMatrix(const std::string& fname)
+    : file_(new common::MappedFile(fname)) {
+  PageAlignedHeader header;
+  CHECK_GE(file_->Size(), sizeof(header)) << "invalid input file format";
+  std::memcpy(&header, file_->Data(), sizeof(header));
+  CHECK_EQ(header.magic, static_cast<int32_t>(SimpleCSRSource::kMagicPageAligned))
+      << "invalid format, magic number mismatch";
+  CHECK_LE(sizeof(header) + header.meta_bytes, file_->Size())
+      << "invalid format, file is truncated";
+  common::MemoryFixSizeBuffer ms(const_cast<char*>(file_->Data()) + sizeof(header),
+                                 header.meta_bytes);
+  info_.LoadBinary(&ms);
+
+  CHECK_EQ(header.offset_size, info_.num_row_ + 1) << "invalid format, row offsets";
+  CHECK_EQ(header.offset_begin % SimpleCSRSource::kPageAlign, 0U)
+      << "invalid format, misaligned row offsets";
+  CHECK_EQ(header.data_begin % SimpleCSRSource::kPageAlign, 0U)
+      << "invalid format, misaligned entries";
+  CHECK_LE(header.offset_begin + header.offset_size * sizeof(size_t), file_->Size())
+      << "invalid format, file is truncated";
+  CHECK_LE(header.data_begin + header.data_size * sizeof(Entry), file_->Size())
+      << "invalid format, file is truncated";
+  offset_ = reinterpret_cast<const size_t*>(file_->Data() + header.offset_begin);
+  entries_ = reinterpret_cast<const Entry*>(file_->Data() + header.data_begin);
+  CHECK_EQ(offset_[info_.num_row_], header.data_size) << "invalid format, row offsets";
+  file_->AdviseSequential(header.data_begin, header.data_size * sizeof(Entry));
+}
+
+float MappedDMatrix::GetColDensity(size_t cidx) {
+  // ColMaker asks for the densities from within a parallel region
+  std::call_once(column_size_flag_, [this]() { this->CountColumns(); });
+  size_t nmiss = info_.num_row_ - column_size_[cidx];
+  return 1.0f - (static_cast<float>(nmiss)) / info_.num_row_;
+}
+
+void MappedDMatrix::CountColumns() {
+  const size_t ncol = info_.num_col_;
+  const int nthread = omp_get_max_threads();
+  std::vector<size_t> column_size_tloc(nthread * ncol, 0);
+  const auto nentry = static_cast<omp_ulong>(offset_[info_.num_row_]);
+#pragma omp parallel num_threads(nthread)
+  {
+    size_t* column_size = dmlc::BeginPtr(column_size_tloc) + omp_get_thread_num() * ncol;
+#pragma omp for schedule(static)
+    for (omp_ulong i = 0; i < nentry; ++i) {
+      ++column_size[entries_[i].index];
+    }
+  }
+  column_size_.assign(ncol, 0);
+  for (int tid = 0; tid < nthread; ++tid) {
+    for (size_t j = 0; j < ncol; ++j) {
+      column_size_[j] += column_size_tloc[tid * ncol + j];
+    }
+  }
+}
+
+size_t MappedDMatrix::PageEnd(size_t begin) const {
+  const size_t* last = offset_ + info_.num_row_ + 1;
+  // the rows whose entries fit into the page, at least one
+  const size_t* it = std::upper_bound(offset_ + begin + 1, last,
+                                      offset_[begin] + kPageEntries);
+  return std::max(static_cast<size_t>(it - offset_) - 1, begin + 1);
+}
+
+void MappedDMatrix::FillPage(size_t begin, size_t end, SparsePage* page) const {
+  auto& offset_vec = page->offset.HostVector();
+  auto& data_vec = page->data.HostVector();
+  page->base_rowid = begin;
+  offset_vec.resize(end - begin + 1);
+  for (size_t i = begin; i <= end; ++i) {
+    offset_vec[i - begin] = offset_[i] - offset_[begin];
+  }
+  data_vec.assign(entries_ + offset_[begin], entries_ + offset_[end]);
+}
+
+/*!
+ * \brief Row pages of a MappedDMatrix. The page is copied when first read and
+ *  is owned by the iterator, so it is only valid while the iterator is.
+ */
+class MappedBatchIteratorImpl : public BatchIteratorImpl {
+ public:
+  MappedBatchIteratorImpl(const MappedDMatrix* dmat, size_t begin)
+      : dmat_(dmat), begin_(begin) {}
+  SparsePage& operator*() override {
+    return this->Page();
+  }
+  const SparsePage& operator*() const override {
+    return this->Page();
+  }
+  void operator++() override {
+    begin_ = dmat_->PageEnd(begin_);
+    filled_ = false;
+  }
+  bool AtEnd() const override { return begin_ >= dmat_->Info().num_row_; }
+  MappedBatchIteratorImpl* Clone() override {
+    return new MappedBatchIteratorImpl(dmat_, begin_);
+  }
+
+ private:
+  SparsePage& Page() const {
+    CHECK(!this->AtEnd());
+    if (!filled_) {
+      dmat_->FillPage(begin_, dmat_->PageEnd(begin_), &page_);
+      filled_ = true;
+    }
+    return page_;
+  }
+
+  const MappedDMatrix* dmat_;
+  size_t begin_;
+  mutable SparsePage page_;
+  mutable bool filled_{false};
+};
+
+BatchSet MappedDMatrix::GetRowBatches() {
+  auto begin_iter = BatchIterator(new MappedBatchIteratorImpl(this, 0));
+  return BatchSet(begin_iter);
+}
+
+BatchSet MappedDMatrix::GetColumnBatches() {
+  // column page doesn't exist, transpose the rows straight from the mapping
+  if (!column_page_) {
+    column_page_.reset(new SparsePage());
+    common::ParallelGroupBuilder<Entry> builder(&column_page_->offset.HostVector(),
+                                                &column_page_->data.HostVector());
+    const int nthread = omp_get_max_threads();
+    builder.InitBudget(info_.num_col_, nthread);
+    const auto nrow = static_cast<omp_ulong>(info_.num_row_);
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nrow; ++i) {
+      const int tid = omp_get_thread_num();
+      for (size_t j = offset_[i]; j < offset_[i + 1]; ++j) {
+        builder.AddBudget(entries_[j].index, tid);
+      }
+    }
+    builder.InitStorage();
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nrow; ++i) {
+      const int tid = omp_get_thread_num();
+      for (size_t j = offset_[i]; j < offset_[i + 1]; ++j) {
+        builder.Push(entries_[j].index,
+                     Entry(static_cast<bst_uint>(i), entries_[j].fvalue), tid);
+      }
+    }
+  }
+  auto begin_iter =
+      BatchIterator(new SimpleBatchIteratorImpl(column_page_.get()));
+  return BatchSet(begin_iter);
+}
+
+BatchSet MappedDMatrix::GetSortedColumnBatches() {
+  // Sorted column page doesn't exist, generate it
+  if (!sorted_column_page_) {
+    sorted_column_page_.reset(new SparsePage(*this->GetColumnBatches().begin()));
+    sorted_column_page_->SortRows();
+  }
+  auto begin_iter =
+      BatchIterator(new SimpleBatchIteratorImpl(sorted_column_page_.get()));
+  return BatchSet(begin_iter);
+}
+
+bool InPlaceRows(const DMatrix* p_fmat, ExternalRows* out) {
+  if (const auto* dense = dynamic_cast<const DenseDMatrix*>(p_fmat)) {
+    *out = dense->Rows();
+    return true;
+  }
+  if (const auto* mapped = dynamic_cast<const MappedDMatrix*>(p_fmat)) {
+    *out = mapped->Rows();
+    return true;
+  }
+  return false;
+}
+}  // namespace data
+}  // namespace xgboost
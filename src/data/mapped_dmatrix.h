@@ -0,0 +1,89 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file mapped_dmatrix.h
+ * \brief DMatrix read in place from a memory mapped page aligned binary file.
+ */
+#ifndef XGBOOST_DATA_MAPPED_DMATRIX_H_
+#define XGBOOST_DATA_MAPPED_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../common/io.h"
+
+namespace xgboost {
+namespace data {
+
+/*!
+ * \brief DMatrix over a file written by SimpleCSRSource::SavePageAlignedBinary.
+ *  The row offsets and entries are used where they lie in the mapping, so
+ *  loading only reads the header and the MetaInfo; the rest is paged in when
+ *  touched and shared with other processes through the page cache. Hot paths
+ *  read the rows in place through Rows(); row batches are CSR pages copied
+ *  from the mapping on demand, a bounded number of entries at a time.
+ */
+class MappedDMatrix : public DMatrix {
+ public:
+  /*! \param fname local file in the page aligned binary layout */
+  explicit MappedDMatrix(const std::string& fname);
+
+  MetaInfo& Info() override { return info_; }
+
+  const MetaInfo& Info() const override { return info_; }
+
+  float GetColDensity(size_t cidx) override;
+
+  bool SingleColBlock() const override { return true; }
+
+  BatchSet GetRowBatches() override;
+
+  BatchSet GetColumnBatches() override;
+
+  BatchSet GetSortedColumnBatches() override;
+
+  /*! \return the rows read in place from the mapping */
+  ExternalRows Rows() const {
+    return ExternalRows::Entries(offset_, entries_, info_.num_row_, info_.num_col_);
+  }
+  /*! \return end of the row page starting at row begin */
+  size_t PageEnd(size_t begin) const;
+  /*!
+   * \brief copy the CSR page of rows [begin, end) out of the mapping
+   * \param begin first row of the page
+   * \param end one past the last row
+   * \param page the output page
+   */
+  void FillPage(size_t begin, size_t end, SparsePage* page) const;
+
+  /*! \brief upper bound of the entries of one page of GetRowBatches, unless a row is longer */
+  static const size_t kPageEntries = size_t(1) << 22;
+
+ private:
+  // count the entries of every column into column_size_
+  void CountColumns();
+
+  std::unique_ptr<common::MappedFile> file_;
+  MetaInfo info_;
+  const size_t* offset_ {nullptr};
+  const Entry* entries_ {nullptr};
+  // number of entries of every column, counted once on first use
+  std::vector<size_t> column_size_;
+  std::once_flag column_size_flag_;
+  std::unique_ptr<SparsePage> column_page_;
+  std::unique_ptr<SparsePage> sorted_column_page_;
+};
+
+/*!
+ * \brief rows of a DMatrix that can be read in place instead of through
+ *  CSR pages, as those of DenseDMatrix and MappedDMatrix
+ * \return whether p_fmat has such rows
+ */
+bool InPlaceRows(const DMatrix* p_fmat, ExternalRows* out);
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_MAPPED_DMATRIX_H_
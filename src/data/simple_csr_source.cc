@@ -4,8 +4,13 @@
  */
 #include <dmlc/base.h>
 #include <xgboost/logging.h>
+#include <dmlc/omp.h>
+#include <algorithm>
+#include <cstring>
 #include <limits>
+#include <string>
 #include "./simple_csr_source.h"
+#include "../common/io.h"
 
 namespace xgboost {
 namespace data {
@@ -102,6 +107,38 @@ void SimpleCSRSource::SaveBinary(dmlc::Stream* fo) const {
   fo->Write(page_.data.HostVector());
 }
 
+namespace {
+inline uint64_t AlignUp(uint64_t pos, uint64_t align) {
+  return (pos + align - 1) / align * align;
+}
+}  // anonymous namespace
+
+void SimpleCSRSource::SavePageAlignedBinary(dmlc::Stream* fo) const {
+  std::string meta;
+  common::MemoryBufferStream ms(&meta);
+  info.SaveBinary(&ms);
+
+  const auto& offset = page_.offset.HostVector();
+  const auto& data = page_.data.HostVector();
+  PageAlignedHeader header;
+  header.magic = kMagicPageAligned;
+  header.reserved = 0;
+  header.meta_bytes = meta.size();
+  header.offset_begin = AlignUp(sizeof(header) + meta.size(), kPageAlign);
+  header.offset_size = offset.size();
+  header.data_begin = AlignUp(header.offset_begin + offset.size() * sizeof(size_t), kPageAlign);
+  header.data_size = data.size();
+
+  const std::string padding(kPageAlign, '\0');
+  fo->Write(&header, sizeof(header));
+  fo->Write(meta.data(), meta.size());
+  fo->Write(padding.data(), header.offset_begin - sizeof(header) - meta.size());
+  fo->Write(dmlc::BeginPtr(offset), offset.size() * sizeof(size_t));
+  fo->Write(padding.data(),
+            header.data_begin - header.offset_begin - offset.size() * sizeof(size_t));
+  fo->Write(dmlc::BeginPtr(data), data.size() * sizeof(Entry));
+}
+
 void SimpleCSRSource::BeforeFirst() {
   at_first_ = true;
 }
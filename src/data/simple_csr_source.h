@@ -10,12 +10,27 @@
 
 #include <xgboost/base.h>
 #include <xgboost/data.h>
+#include <string>
 #include <vector>
 #include <algorithm>
 
 
 namespace xgboost {
 namespace data {
+/*! \brief fixed size header of the page aligned binary layout */
+struct PageAlignedHeader {
+  int32_t magic;
+  int32_t reserved;
+  /*! \brief bytes of the MetaInfo following the header */
+  uint64_t meta_bytes;
+  /*! \brief file position and number of the row offsets */
+  uint64_t offset_begin;
+  uint64_t offset_size;
+  /*! \brief file position and number of the entries */
+  uint64_t data_begin;
+  uint64_t data_size;
+};
+
 /*!
  * \brief The simplest form of data holder, can be used to create DMatrix.
  *  This is an in-memory data structure that holds the data in row oriented format.
@@ -57,6 +72,13 @@ class SimpleCSRSource : public DataSource {
    * \param fo The output stream.
    */
   void SaveBinary(dmlc::Stream* fo) const;
+  /*!
+   * \brief Save data in the page aligned binary layout: a PageAlignedHeader,
+   *  the MetaInfo, then the offset and data arrays each starting at a
+   *  kPageAlign boundary. MappedDMatrix reads it in place.
+   * \param fo The output stream.
+   */
+  void SavePageAlignedBinary(dmlc::Stream* fo) const;
   // implement Next
   bool Next() override;
   // implement BeforeFirst
@@ -65,6 +87,10 @@ class SimpleCSRSource : public DataSource {
   const SparsePage &Value() const override;
   /*! \brief magic number used to identify SimpleCSRSource */
   static const int kMagic = 0xffffab01;
+  /*! \brief magic number of the page aligned binary layout */
+  static const int kMagicPageAligned = 0xffffab03;
+  /*! \brief alignment of the arrays in the page aligned binary layout */
+  static const size_t kPageAlign = 4096;
 
  private:
   /*! \brief internal variable, used to support iterator interface */
@@ -29,27 +29,6 @@ float SimpleDMatrix::GetColDensity(size_t cidx) {
   return 1.0f - (static_cast<float>(nmiss)) / this->Info().num_row_;
 }
 
-class SimpleBatchIteratorImpl : public BatchIteratorImpl {
- public:
-  explicit SimpleBatchIteratorImpl(SparsePage* page) : page_(page) {}
-  SparsePage& operator*() override {
-    CHECK(page_ != nullptr);
-    return *page_;
-  }
-  const SparsePage& operator*() const override {
-    CHECK(page_ != nullptr);
-    return *page_;
-  }
-  void operator++() override { page_ = nullptr; }
-  bool AtEnd() const override { return page_ == nullptr; }
-  SimpleBatchIteratorImpl* Clone() override {
-    return new SimpleBatchIteratorImpl(*this);
-  }
-
- private:
-  SparsePage* page_{nullptr};
-};
-
 BatchSet SimpleDMatrix::GetRowBatches() {
   auto cast = dynamic_cast<SimpleCSRSource*>(source_.get());
   auto begin_iter = BatchIterator(new SimpleBatchIteratorImpl(&(cast->page_)));
@@ -21,6 +21,28 @@
 namespace xgboost {
 namespace data {
 
+/*! \brief a single batch of a page owned by the DMatrix */
+class SimpleBatchIteratorImpl : public BatchIteratorImpl {
+ public:
+  explicit SimpleBatchIteratorImpl(SparsePage* page) : page_(page) {}
+  SparsePage& operator*() override {
+    CHECK(page_ != nullptr);
+    return *page_;
+  }
+  const SparsePage& operator*() const override {
+    CHECK(page_ != nullptr);
+    return *page_;
+  }
+  void operator++() override { page_ = nullptr; }
+  bool AtEnd() const override { return page_ == nullptr; }
+  SimpleBatchIteratorImpl* Clone() override {
+    return new SimpleBatchIteratorImpl(*this);
+  }
+
+ private:
+  SparsePage* page_{nullptr};
+};
+
 class SimpleDMatrix : public DMatrix {
  public:
   explicit SimpleDMatrix(std::unique_ptr<DataSource>&& source)
@@ -17,6 +17,7 @@
 #include <string>
 #include <limits>
 #include <algorithm>
+#include <unordered_map>
 #include "../common/common.h"
 #include "../common/host_device_vector.h"
 #include "../common/random.h"
@@ -34,6 +35,12 @@ enum TreeProcessType {
   kUpdate
 };
 
+// how trees are grown for several output groups
+enum MultiStrategy {
+  kOneOutputPerTree,
+  kMultiOutputTree
+};
+
 /*! \brief training parameters */
 struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
   /*!
@@ -46,6 +53,8 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
   /*! \brief type of boosting process to run */
   int process_type;
   std::string predictor;
+  /*! \brief whether one vector tree is grown for all output groups */
+  int multi_strategy;
   // declare parameters
   DMLC_DECLARE_PARAMETER(GBTreeTrainParam) {
     DMLC_DECLARE_FIELD(num_parallel_tree)
@@ -67,6 +76,12 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
     DMLC_DECLARE_FIELD(predictor)
       .set_default("cpu_predictor")
       .describe("Predictor algorithm type");
+    DMLC_DECLARE_FIELD(multi_strategy)
+        .set_default(kOneOutputPerTree)
+        .add_enum("one_output_per_tree", kOneOutputPerTree)
+        .add_enum("multi_output_tree", kMultiOutputTree)
+        .describe("Grow one tree per output group each round, or a single tree"\
+                  " with a vector of outputs in every leaf.");
   }
 };
 
@@ -141,6 +156,18 @@ class GBTree : public GradientBooster {
     for (const auto& up : updaters_) {
       up->Init(cfg);
     }
+    // a new model decides here whether its trees are vector trees
+    if (model_.trees.size() == 0 && model_.trees_to_update.size() == 0) {
+      model_.param.size_leaf_vector =
+          tparam_.multi_strategy == kMultiOutputTree &&
+          model_.param.num_output_group > 1 ? model_.param.num_output_group : 0;
+    }
+    if (model_.param.size_leaf_vector != 0) {
+      CHECK_EQ(model_.param.size_leaf_vector, model_.param.num_output_group)
+          << "leaf vectors must hold one value per output group";
+      CHECK_EQ(tparam_.predictor, "cpu_predictor")
+          << "multi_output_tree is only supported by cpu_predictor";
+    }
     // for the 'update' process_type, move trees into trees_to_update
     if (tparam_.process_type == kUpdate) {
       model_.InitTreesToUpdate();
@@ -175,7 +202,12 @@ class GBTree : public GradientBooster {
     std::vector<std::vector<std::unique_ptr<RegTree> > > new_trees;
     const int ngroup = model_.param.num_output_group;
     monitor_.Start("BoostNewTrees");
-    if (ngroup == 1) {
+    if (ngroup == 1 || model_.param.size_leaf_vector != 0) {
+      // a vector tree takes the ngroup gradients of each row at once
+      CHECK(ngroup == 1 || tparam_.updater_seq == "grow_quantile_histmaker")
+          << "multi_output_tree is only supported by tree_method=hist";
+      CHECK(ngroup == 1 || tparam_.process_type == kDefault)
+          << "multi_output_tree trees cannot be updated";
       std::vector<std::unique_ptr<RegTree> > ret;
       BoostNewTrees(in_gpair, p_fmat, 0, &ret);
       new_trees.push_back(std::move(ret));
@@ -211,6 +243,11 @@ class GBTree : public GradientBooster {
     predictor_->PredictBatch(p_fmat, out_preds, model_, 0, ntree_limit);
   }
 
+  void PredictRows(const ExternalRows& rows, bst_float* out_preds,
+                   unsigned ntree_limit) override {
+    predictor_->PredictRows(rows, out_preds, model_, ntree_limit);
+  }
+
   void PredictInstance(const SparsePage::Inst& inst,
                std::vector<bst_float>* out_preds,
                unsigned ntree_limit,
@@ -219,6 +256,17 @@ class GBTree : public GradientBooster {
                                ntree_limit, root_index);
   }
 
+  void PredictRow(const ExternalRows& row, bst_float* out_preds,
+                  unsigned ntree_limit) override {
+    predictor_->PredictRow(row, out_preds, model_, ntree_limit);
+  }
+
+  void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                       uint8_t* out_decision, unsigned* out_ntree,
+                       unsigned ntree_limit) override {
+    predictor_->PredictDecision(rows, cutoff, out_decision, out_ntree, model_, ntree_limit);
+  }
+
   void PredictLeaf(DMatrix* p_fmat,
                    std::vector<bst_float>* out_preds,
                    unsigned ntree_limit) override {
@@ -245,6 +293,10 @@ class GBTree : public GradientBooster {
     return model_.DumpModel(fmap, with_stats, format);
   }
 
+  std::string CompileModel() const override {
+    return model_.CompileModel();
+  }
+
  protected:
   // initialize updater before using them
   inline void InitUpdater() {
@@ -272,6 +324,7 @@ class GBTree : public GradientBooster {
         // create new tree
         std::unique_ptr<RegTree> ptr(new RegTree());
         ptr->param.InitAllowUnknown(this->cfg_);
+        ptr->param.size_leaf_vector = model_.param.size_leaf_vector;
         new_trees.push_back(ptr.get());
         ret->push_back(std::move(ptr));
       } else if (tparam_.process_type == kUpdate) {
@@ -293,9 +346,9 @@ class GBTree : public GradientBooster {
   virtual void
   CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) {
     int num_new_trees = 0;
-    for (int gid = 0; gid < model_.param.num_output_group; ++gid) {
+    for (size_t gid = 0; gid < new_trees.size(); ++gid) {
       num_new_trees += new_trees[gid].size();
-      model_.CommitModel(std::move(new_trees[gid]), gid);
+      model_.CommitModel(std::move(new_trees[gid]), static_cast<int>(gid));
     }
     predictor_->UpdatePredictionCache(model_, &updaters_, num_new_trees);
   }
@@ -320,11 +373,21 @@ class Dart : public GBTree {
  public:
   explicit Dart(bst_float base_margin) : GBTree(base_margin) {}
 
+  // matrices whose weighted sums of all trees are kept between rounds
+  void InitCache(const std::vector<std::shared_ptr<DMatrix> > &cache) {
+    for (const auto& d : cache) {
+      dart_cache_[d.get()].data = d;
+    }
+  }
+
   void Configure(const std::vector<std::pair<std::string, std::string> >& cfg) override {
     GBTree::Configure(cfg);
+    CHECK_EQ(model_.param.size_leaf_vector, 0)
+        << "multi_output_tree is not supported by dart";
     if (model_.trees.size() == 0) {
       dparam_.InitAllowUnknown(cfg);
     }
+    this->ResetCache();
   }
 
   void Load(dmlc::Stream* fi) override {
@@ -333,6 +396,7 @@ class Dart : public GBTree {
     if (model_.param.num_trees != 0) {
       fi->Read(&weight_drop_);
     }
+    this->ResetCache();
   }
 
   void Save(dmlc::Stream* fo) const override {
@@ -347,7 +411,33 @@ class Dart : public GBTree {
                     HostDeviceVector<bst_float>* out_preds,
                     unsigned ntree_limit) override {
     DropTrees(ntree_limit);
-    PredLoopInternal<Dart>(p_fmat, &out_preds->HostVector(), 0, ntree_limit, true);
+    auto it = dart_cache_.find(p_fmat);
+    if (ntree_limit == 0 && it != dart_cache_.end()) {
+      this->PredictFromCache(p_fmat, &it->second, &out_preds->HostVector());
+    } else {
+      PredLoopInternal<Dart>(p_fmat, &out_preds->HostVector(), 0, ntree_limit, true);
+    }
+  }
+
+  void PredictRows(const ExternalRows& rows, bst_float* out_preds,
+                   unsigned ntree_limit) override {
+    LOG(FATAL) << "Prediction from external rows is not supported by dart";
+  }
+
+  void PredictRow(const ExternalRows& row, bst_float* out_preds,
+                  unsigned ntree_limit) override {
+    LOG(FATAL) << "Single row prediction is not supported by dart";
+  }
+
+  void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                       uint8_t* out_decision, unsigned* out_ntree,
+                       unsigned ntree_limit) override {
+    LOG(FATAL) << "Early exit decisions are not supported by dart";
+  }
+
+  std::string CompileModel() const override {
+    LOG(FATAL) << "CompileModel is not supported by dart";
+    return "";
   }
 
   void PredictInstance(const SparsePage::Inst& inst,
@@ -364,11 +454,11 @@ class Dart : public GBTree {
     if (ntree_limit == 0 || ntree_limit > model_.trees.size()) {
       ntree_limit = static_cast<unsigned>(model_.trees.size());
     }
+    PredValue(inst, model_.param.num_output_group, root_index,
+              &thread_temp_[0], 0, ntree_limit, dmlc::BeginPtr(*out_preds));
     // loop over output groups
     for (int gid = 0; gid < model_.param.num_output_group; ++gid) {
-      (*out_preds)[gid]
-          = PredValue(inst, gid, root_index,
-                      &thread_temp_[0], 0, ntree_limit) + model_.base_margin;
+      (*out_preds)[gid] += model_.base_margin;
     }
   }
 
@@ -426,6 +516,8 @@ class Dart : public GBTree {
     CHECK_EQ(model_.param.size_leaf_vector, 0)
         << "size_leaf_vector is enforced to 0 so far";
     CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
+    // per thread sums of one row
+    std::vector<bst_float> psum_tloc(nthread * num_group);
     // start collecting the prediction
     auto* self = static_cast<Derived*>(this);
     for (const auto &batch : p_fmat->GetRowBatches()) {
@@ -436,6 +528,7 @@ class Dart : public GBTree {
       for (bst_omp_uint i = 0; i < nsize - rest; i += kUnroll) {
         const int tid = omp_get_thread_num();
         RegTree::FVec& feats = thread_temp_[tid];
+        bst_float* psum = dmlc::BeginPtr(psum_tloc) + tid * num_group;
         int64_t ridx[kUnroll];
         SparsePage::Inst inst[kUnroll];
         for (int k = 0; k < kUnroll; ++k) {
@@ -445,28 +538,153 @@ class Dart : public GBTree {
           inst[k] = batch[i + k];
         }
         for (int k = 0; k < kUnroll; ++k) {
+          self->PredValue(inst[k], num_group, info.GetRoot(ridx[k]),
+                          &feats, tree_begin, tree_end, psum);
           for (int gid = 0; gid < num_group; ++gid) {
-            const size_t offset = ridx[k] * num_group + gid;
-            preds[offset] +=
-                self->PredValue(inst[k], gid, info.GetRoot(ridx[k]),
-                                &feats, tree_begin, tree_end);
+            preds[ridx[k] * num_group + gid] += psum[gid];
           }
         }
       }
       for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
         RegTree::FVec& feats = thread_temp_[0];
+        bst_float* psum = dmlc::BeginPtr(psum_tloc);
         const auto ridx = static_cast<int64_t>(batch.base_rowid + i);
         const SparsePage::Inst inst = batch[i];
+        self->PredValue(inst, num_group, info.GetRoot(ridx),
+                        &feats, tree_begin, tree_end, psum);
         for (int gid = 0; gid < num_group; ++gid) {
-          const size_t offset = ridx * num_group + gid;
-          preds[offset] +=
-              self->PredValue(inst, gid, info.GetRoot(ridx),
-                              &feats, tree_begin, tree_end);
+          preds[ridx * num_group + gid] += psum[gid];
         }
       }
     }
   }
 
+  /*!
+   * \brief the sum of all trees of a cached matrix, each scaled by its weight
+   *  at the time it was last added.
+   *
+   *  The sum is updated by the changes of the weights rather than recomputed,
+   *  so it cannot add the trees in the order of PredLoopInternal. It is kept
+   *  in double, and the predictions agree with PredLoopInternal up to the
+   *  rounding of its float sum, not bit for bit.
+   */
+  struct DartCacheEntry {
+    std::shared_ptr<DMatrix> data;
+    /*! \brief the sum of each row and output group */
+    std::vector<double> margin;
+    /*! \brief the weight of each tree in margin */
+    std::vector<bst_float> weights;
+    /*! \brief number of entries of changed_trees_ already added to margin */
+    size_t num_changes {0};
+  };
+
+  // predict from the cached sum: first bring it up to date by adding the
+  // trees committed since the last round and the changed weights of the
+  // trees dropped in it, then take out the trees dropped now. A round thus
+  // evaluates only new and dropped trees instead of all of them.
+  inline void PredictFromCache(DMatrix* p_fmat, DartCacheEntry* e,
+                               std::vector<bst_float>* out_preds) {
+    const int num_group = model_.param.num_output_group;
+    const MetaInfo& info = p_fmat->Info();
+    const size_t ntrees = model_.trees.size();
+    CHECK_EQ(weight_drop_.size(), ntrees);
+    const size_t n = info.num_row_ * num_group;
+    if (e->margin.size() != n || e->weights.size() > ntrees) {
+      e->margin.assign(n, 0.0);
+      e->weights.clear();
+    }
+    // (tree, change of its weight) to add to the sum
+    std::vector<std::pair<size_t, double>> update;
+    auto add_change = [&](size_t i) {
+      if (weight_drop_[i] != e->weights[i]) {
+        update.emplace_back(i, static_cast<double>(weight_drop_[i]) - e->weights[i]);
+        e->weights[i] = weight_drop_[i];
+      }
+    };
+    if (e->weights.empty()) {
+      // nothing added yet, start from all trees
+      e->weights.resize(ntrees, 0.0f);
+      for (size_t i = 0; i < ntrees; ++i) {
+        add_change(i);
+      }
+    } else {
+      // only the trees committed or re-weighted since the last call
+      e->weights.resize(ntrees, 0.0f);
+      for (size_t k = e->num_changes; k < changed_trees_.size(); ++k) {
+        add_change(changed_trees_[k]);
+      }
+    }
+    e->num_changes = changed_trees_.size();
+    this->TrimChanges();
+
+    const auto& base_margin = info.base_margin_.ConstHostVector();
+    out_preds->resize(n);
+    std::vector<bst_float>& preds = *out_preds;
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread);
+    // per thread sums of one row
+    std::vector<double> psum_tloc(nthread * num_group);
+    for (const auto &batch : p_fmat->GetRowBatches()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp_[tid];
+        double* psum = dmlc::BeginPtr(psum_tloc) + tid * num_group;
+        const size_t ridx = batch.base_rowid + i;
+        const unsigned root_index = info.GetRoot(ridx);
+        const SparsePage::Inst inst = batch[i];
+        feats.Fill(inst);
+        double* margin = dmlc::BeginPtr(e->margin) + ridx * num_group;
+        for (const auto& tree : update) {
+          margin[model_.tree_info[tree.first]] +=
+              tree.second * this->LeafValue(tree.first, feats, root_index);
+        }
+        std::copy(margin, margin + num_group, psum);
+        for (size_t tree : idx_drop_) {
+          psum[model_.tree_info[tree]] -=
+              weight_drop_[tree] * this->LeafValue(tree, feats, root_index);
+        }
+        feats.Drop(inst);
+        for (int gid = 0; gid < num_group; ++gid) {
+          const double base = base_margin.size() != 0 ? base_margin[ridx * num_group + gid]
+                                                      : model_.base_margin;
+          preds[ridx * num_group + gid] = static_cast<bst_float>(base + psum[gid]);
+        }
+      }
+    }
+  }
+
+  // output of tree i for feats
+  inline bst_float LeafValue(size_t i, const RegTree::FVec& feats,
+                             unsigned root_index) const {
+    const RegTree& tree = *model_.trees[i];
+    return tree[tree.GetLeafIndex(feats, root_index)].LeafValue();
+  }
+
+  // start the cached sums over, after the trees were replaced
+  inline void ResetCache() {
+    for (auto& kv : dart_cache_) {
+      kv.second.margin.clear();
+      kv.second.weights.clear();
+      kv.second.num_changes = 0;
+    }
+    changed_trees_.clear();
+  }
+
+  // forget the changes that every cached sum has already added
+  inline void TrimChanges() {
+    for (const auto& kv : dart_cache_) {
+      if (!kv.second.weights.empty() && kv.second.num_changes != changed_trees_.size()) {
+        return;
+      }
+    }
+    changed_trees_.clear();
+    for (auto& kv : dart_cache_) {
+      kv.second.num_changes = 0;
+    }
+  }
+
   // commit new trees all at once
   void
   CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) override {
@@ -475,31 +693,36 @@ class Dart : public GBTree {
       num_new_trees += new_trees[gid].size();
       model_.CommitModel(std::move(new_trees[gid]), gid);
     }
+    // the dropped trees are re-weighted and the new ones appended
+    changed_trees_.insert(changed_trees_.end(), idx_drop_.begin(), idx_drop_.end());
+    for (size_t i = weight_drop_.size(); i < model_.trees.size(); ++i) {
+      changed_trees_.push_back(i);
+    }
     size_t num_drop = NormalizeTrees(num_new_trees);
     LOG(INFO) << "drop " << num_drop << " trees, "
               << "weight = " << weight_drop_.back();
   }
 
-  // predict the leaf scores without dropped trees
-  inline bst_float PredValue(const SparsePage::Inst &inst,
-                             int bst_group,
-                             unsigned root_index,
-                             RegTree::FVec *p_feats,
-                             unsigned tree_begin,
-                             unsigned tree_end) {
-    bst_float psum = 0.0f;
+  // predict the leaf scores without dropped trees into psum, all output
+  // groups in one pass over the trees
+  inline void PredValue(const SparsePage::Inst &inst,
+                        int num_group,
+                        unsigned root_index,
+                        RegTree::FVec *p_feats,
+                        unsigned tree_begin,
+                        unsigned tree_end,
+                        bst_float* psum) {
+    std::fill(psum, psum + num_group, 0.0f);
     p_feats->Fill(inst);
     for (size_t i = tree_begin; i < tree_end; ++i) {
-      if (model_.tree_info[i] == bst_group) {
-        bool drop = (std::binary_search(idx_drop_.begin(), idx_drop_.end(), i));
-        if (!drop) {
-          int tid = model_.trees[i]->GetLeafIndex(*p_feats, root_index);
-          psum += weight_drop_[i] * (*model_.trees[i])[tid].LeafValue();
-        }
+      bool drop = (std::binary_search(idx_drop_.begin(), idx_drop_.end(), i));
+      if (!drop) {
+        int tid = model_.trees[i]->GetLeafIndex(*p_feats, root_index);
+        psum[model_.tree_info[i]] +=
+            weight_drop_[i] * (*model_.trees[i])[tid].LeafValue();
       }
     }
     p_feats->Drop(inst);
-    return psum;
   }
 
   // select which trees to drop
@@ -602,6 +825,10 @@ class Dart : public GBTree {
   std::vector<size_t> idx_drop_;
   // temporal storage for per thread
   std::vector<RegTree::FVec> thread_temp_;
+  // weighted sums of the trees for the cached matrices
+  std::unordered_map<DMatrix*, DartCacheEntry> dart_cache_;
+  // trees whose weight changed, in order, since the cached sums were trimmed
+  std::vector<size_t> changed_trees_;
 };
 
 // register the objective functions
@@ -619,7 +846,8 @@ XGBOOST_REGISTER_GBM(GBTree, "gbtree")
 XGBOOST_REGISTER_GBM(Dart, "dart")
 .describe("Tree booster, dart.")
 .set_body([](const std::vector<std::shared_ptr<DMatrix> >& cached_mats, bst_float base_margin) {
-    GBTree* p = new Dart(base_margin);
+    auto* p = new Dart(base_margin);
+    p->InitCache(cached_mats);
     return p;
   });
 }  // namespace gbm
@@ -6,11 +6,16 @@
 #include <dmlc/io.h>
 #include <xgboost/tree_model.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <sstream>
 #include <utility>
 #include <string>
 #include <vector>
 
+#include "../common/common.h"
+
 namespace xgboost {
 namespace gbm {
 /*! \brief model parameters */
@@ -31,7 +36,10 @@ struct GBTreeModelParam : public dmlc::Parameter<GBTreeModelParam> {
    *    suppose we have n instance and k group, output will be k * n
    */
   int num_output_group;
-  /*! \brief size of leaf vector needed in tree */
+  /*!
+   * \brief size of leaf vector needed in tree, num_output_group when one
+   *  vector tree is grown for all output groups
+   */
   int size_leaf_vector;
   /*! \brief reserved parameters */
   int reserved[32];
@@ -59,10 +67,18 @@ struct GBTreeModelParam : public dmlc::Parameter<GBTreeModelParam> {
         .set_default(0)
         .describe("Reserved option for vector tree.");
   }
+  /*!
+   * \brief number of trees that make up one round of outputs, the unit of
+   *  ntree_limit: one per output group, or a single vector tree
+   */
+  inline int TreesPerRound() const {
+    return size_leaf_vector != 0 ? 1 : num_output_group;
+  }
 };
 
 struct GBTreeModel {
-  explicit GBTreeModel(bst_float base_margin) : base_margin(base_margin) {}
+  explicit GBTreeModel(bst_float base_margin)
+      : base_margin(base_margin), version(NextVersion()) {}
   void Configure(const std::vector<std::pair<std::string, std::string> >& cfg) {
     // initialize model parameters if not yet been initialized.
     if (trees.size() == 0) {
@@ -78,6 +94,7 @@ struct GBTreeModel {
       trees.clear();
       param.num_trees = 0;
       tree_info.clear();
+      version = NextVersion();
     }
   }
 
@@ -97,6 +114,7 @@ struct GBTreeModel {
           fi->Read(dmlc::BeginPtr(tree_info), sizeof(int) * param.num_trees),
           sizeof(int) * param.num_trees);
     }
+    version = NextVersion();
   }
 
   void Save(dmlc::Stream* fo) const {
@@ -118,6 +136,43 @@ struct GBTreeModel {
     }
     return dump;
   }
+  /*!
+   * \brief generate C++ source of the trees: the constants kNumFeature,
+   *  kNumGroup, kTreesPerRound, kNumTrees and kBaseMargin, one function per
+   *  tree, and void PredictMargin(const float* fvalue, unsigned ntree,
+   *  float* psum) adding the leaves of the first ntree trees to psum.
+   */
+  std::string CompileModel() const {
+    int num_feature = std::max(param.num_feature, 1);
+    for (const auto& tree : trees) {
+      for (int nid = 0; nid < tree->param.num_nodes; ++nid) {
+        const RegTree::Node& node = (*tree)[nid];
+        if (!node.IsLeaf() && !node.IsDeleted()) {
+          num_feature = std::max(num_feature, static_cast<int>(node.SplitIndex()) + 1);
+        }
+      }
+    }
+    std::ostringstream fo;
+    fo << "const int kNumFeature = " << num_feature << ";\n"
+       << "const int kNumGroup = " << param.num_output_group << ";\n"
+       << "const unsigned kTreesPerRound = " << param.TreesPerRound() << ";\n"
+       << "const unsigned kNumTrees = " << trees.size() << ";\n"
+       << "const float kBaseMargin = " << common::ToFloatLiteral(base_margin) << ";\n\n"
+       << "inline bool InCategories(float fvalue, const uint32_t* begin, const uint32_t* end) {\n"
+       << "  if (!(fvalue >= 0.0f)) return false;\n"
+       << "  return std::binary_search(begin, end, static_cast<uint32_t>(fvalue));\n"
+       << "}\n\n";
+    for (size_t i = 0; i < trees.size(); ++i) {
+      fo << trees[i]->CompileModel("Tree" + common::ToString(i), tree_info[i]) << "\n";
+    }
+    fo << "void PredictMargin(const float* fvalue, unsigned ntree, float* psum) {\n";
+    for (size_t i = 0; i < trees.size(); ++i) {
+      fo << "  if (ntree == " << i << ") return;\n"
+         << "  Tree" << i << "(fvalue, psum);\n";
+    }
+    fo << "}\n";
+    return fo.str();
+  }
   void CommitModel(std::vector<std::unique_ptr<RegTree> >&& new_trees,
                    int bst_group) {
     for (auto & new_tree : new_trees) {
@@ -125,6 +180,12 @@ struct GBTreeModel {
       tree_info.push_back(bst_group);
     }
     param.num_trees += static_cast<int>(new_trees.size());
+    version = NextVersion();
+  }
+  /*! \brief a version number not used by any earlier state of any model */
+  static uint64_t NextVersion() {
+    static std::atomic<uint64_t> counter {0};
+    return ++counter;
   }
 
   // base margin
@@ -137,6 +198,11 @@ struct GBTreeModel {
   std::vector<std::unique_ptr<RegTree> > trees_to_update;
   /*! \brief some information indicator of the tree, reserved */
   std::vector<int> tree_info;
+  /*!
+   * \brief identifies the current trees; changes whenever trees are committed,
+   *  loaded or taken out for update, so derived layouts know when to rebuild
+   */
+  uint64_t version;
 };
 }  // namespace gbm
 }  // namespace xgboost
@@ -73,6 +73,60 @@ std::vector<std::string> Learner::DumpModel(const FeatureMap& fmap,
   return gbm_->DumpModel(fmap, with_stats, format);
 }
 
+std::string Learner::CompileModel(const std::string& function_name) const {
+  CHECK(obj_ != nullptr) << "CompileModel: the learner is not configured";
+  const std::string transform = obj_->PredTransformRowSource();
+  std::ostringstream fo;
+  fo << "// Generated by xgboost task=compile, do not edit. Compiled without\n"
+     << "// -ffast-math, it predicts the same floats as the CPU predictor.\n"
+     << "#include <algorithm>\n"
+     << "#include <cmath>\n"
+     << "#include <cstddef>\n"
+     << "#include <cstdint>\n"
+     << "#include <limits>\n\n"
+     << "namespace {\n\n"
+     << gbm_->CompileModel() << "\n"
+     << "const bool kHasTransform = " << (transform.empty() ? "false" : "true") << ";\n\n"
+     << "size_t PredTransformRow(float* io_preds, size_t size) "
+     << (transform.empty() ? "{\n  return size;\n}" : transform)
+     << "\n\n"
+     << "}  // namespace\n\n"
+     << "extern \"C\" int " << function_name << "(void* handle, const float* data,\n"
+     << "    uint64_t nrow, uint64_t ncol, float missing, int option_mask,\n"
+     << "    unsigned ntree_limit, uint64_t* out_len, float* out_result) {\n"
+     << "  static_cast<void>(handle);\n"
+     << "  if ((option_mask & ~1) != 0 || ((option_mask & 1) == 0 && !kHasTransform)) {\n"
+     << "    return -1;\n"
+     << "  }\n"
+     << "  unsigned ntree = ntree_limit * kTreesPerRound;\n"
+     << "  if (ntree == 0 || ntree > kNumTrees) {\n"
+     << "    ntree = kNumTrees;\n"
+     << "  }\n"
+     << "  const bool nan_missing = std::isnan(missing);\n"
+     << "  uint64_t len = 0;\n"
+     << "  for (uint64_t i = 0; i < nrow; ++i) {\n"
+     << "    const float* row = data + i * ncol;\n"
+     << "    float fvalue[kNumFeature];\n"
+     << "    for (int j = 0; j < kNumFeature; ++j) {\n"
+     << "      const float v = static_cast<uint64_t>(j) < ncol\n"
+     << "          ? row[j] : std::numeric_limits<float>::quiet_NaN();\n"
+     << "      fvalue[j] = !nan_missing && v == missing\n"
+     << "          ? std::numeric_limits<float>::quiet_NaN() : v;\n"
+     << "    }\n"
+     << "    float psum[kNumGroup] = {0.0f};\n"
+     << "    PredictMargin(fvalue, ntree, psum);\n"
+     << "    float* out = out_result + len;\n"
+     << "    for (int gid = 0; gid < kNumGroup; ++gid) {\n"
+     << "      out[gid] = kBaseMargin + psum[gid];\n"
+     << "    }\n"
+     << "    len += (option_mask & 1) != 0 ? kNumGroup : PredTransformRow(out, kNumGroup);\n"
+     << "  }\n"
+     << "  *out_len = len;\n"
+     << "  return 0;\n"
+     << "}\n";
+  return fo.str();
+}
+
 /*! \brief training parameter for regression */
 struct LearnerModelParam : public dmlc::Parameter<LearnerModelParam> {
   /* \brief global bias */
@@ -592,6 +646,63 @@ class LearnerImpl : public Learner {
     }
   }
 
+  size_t PredictRows(const ExternalRows& rows, bool output_margin,
+                     bst_float* out_preds, unsigned ntree_limit) const override {
+    CHECK(gbm_ != nullptr)
+        << "Predict must happen after Load or InitModel";
+    gbm_->PredictRows(rows, out_preds, ntree_limit);
+    const size_t n = rows.Size() * std::max(mparam_.num_class, 1);
+    if (output_margin) {
+      return n;
+    }
+    if (!obj_->HasPredTransformRow()) {
+      // the objective only transforms a HostDeviceVector, which may also shrink it
+      HostDeviceVector<bst_float> preds(std::vector<bst_float>(out_preds, out_preds + n));
+      obj_->PredTransform(&preds);
+      const std::vector<bst_float>& h_preds = preds.ConstHostVector();
+      std::copy(h_preds.begin(), h_preds.end(), out_preds);
+      return h_preds.size();
+    }
+    const auto nrow = static_cast<bst_omp_uint>(rows.Size());
+    if (nrow == 0) {
+      return 0;
+    }
+    const size_t ngroup = std::max(mparam_.num_class, 1);
+    // every row is transformed to the same width, seen on the first one
+    const size_t width = obj_->PredTransformRow(out_preds, ngroup);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 1; i < nrow; ++i) {
+      obj_->PredTransformRow(out_preds + i * ngroup, ngroup);
+    }
+    // rows that shrank are packed to the front
+    if (width != ngroup) {
+      for (size_t i = 1; i < nrow; ++i) {
+        std::copy(out_preds + i * ngroup, out_preds + i * ngroup + width,
+                  out_preds + i * width);
+      }
+    }
+    return nrow * width;
+  }
+
+  size_t PredictRow(const ExternalRows& row, bool output_margin,
+                    bst_float* out_preds, unsigned ntree_limit) const override {
+    CHECK(gbm_ != nullptr)
+        << "Predict must happen after Load or InitModel";
+    gbm_->PredictRow(row, out_preds, ntree_limit);
+    const size_t n = std::max(mparam_.num_class, 1);
+    return output_margin ? n : obj_->PredTransformRow(out_preds, n);
+  }
+
+  void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                       uint8_t* out_decision, unsigned* out_ntree,
+                       unsigned ntree_limit) const override {
+    CHECK(gbm_ != nullptr)
+        << "Predict must happen after Load or InitModel";
+    CHECK_LE(mparam_.num_class, 1)
+        << "Early exit decisions need a model with a single output";
+    gbm_->PredictDecision(rows, cutoff, out_decision, out_ntree, ntree_limit);
+  }
+
   const std::map<std::string, std::string>& GetConfigurationArguments() const override {
     return cfg_;
   }
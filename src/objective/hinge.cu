@@ -10,6 +10,7 @@
 #include "../common/common.h"
 #include "../common/span.h"
 #include "../common/host_device_vector.h"
+#include "./pred_transform.h"
 
 namespace xgboost {
 namespace obj {
@@ -82,11 +83,18 @@ class HingeObj : public ObjFunction {
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     common::Transform<>::Init(
         [] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
-          _preds[_idx] = _preds[_idx] > 0.0 ? 1.0 : 0.0;
+          _preds[_idx] = SignTransform::Apply(_preds[_idx]);
         },
         common::Range{0, static_cast<int64_t>(io_preds->Size()), 1}, devices_)
         .Eval(io_preds);
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    return ElementwiseRowTransform<SignTransform>::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return ElementwiseRowTransform<SignTransform>::Source();
+  }
 
   const char* DefaultEvalMetric() const override {
     return "error";
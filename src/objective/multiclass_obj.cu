@@ -15,6 +15,7 @@
 #include <utility>
 #include "../common/math.h"
 #include "../common/transform.h"
+#include "./pred_transform.h"
 
 namespace xgboost {
 namespace obj {
@@ -117,6 +118,15 @@ class SoftmaxMultiClassObj : public ObjFunction {
   void EvalTransform(HostDeviceVector<bst_float>* io_preds) override {
     this->Transform(io_preds, true);
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    CHECK_EQ(size, static_cast<size_t>(param_.num_class));
+    return output_prob_ ? SoftmaxTransform::Apply(io_preds, size)
+                        : ArgMaxTransform::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return output_prob_ ? SoftmaxTransform::Source() : ArgMaxTransform::Source();
+  }
   const char* DefaultEvalMetric() const override {
     return "merror";
   }
@@ -124,36 +134,35 @@ class SoftmaxMultiClassObj : public ObjFunction {
   inline void Transform(HostDeviceVector<bst_float> *io_preds, bool prob) {
     const int nclass = param_.num_class;
     const auto ndata = static_cast<int64_t>(io_preds->Size() / nclass);
-    max_preds_.Resize(ndata);
 
     if (prob) {
       common::Transform<>::Init(
           [=] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
             common::Span<bst_float> point =
                 _preds.subspan(_idx * nclass, nclass);
-            common::Softmax(point.begin(), point.end());
+            SoftmaxTransform::Apply(point.data(), point.size());
           },
           common::Range{0, ndata}, GPUDistribution::Granular(devices_, nclass))
         .Eval(io_preds);
     } else {
+      // local to the call, predictions may transform concurrently
+      HostDeviceVector<bst_float> max_preds(ndata);
       io_preds->Shard(GPUDistribution::Granular(devices_, nclass));
-      max_preds_.Shard(GPUDistribution::Block(devices_));
+      max_preds.Shard(GPUDistribution::Block(devices_));
       common::Transform<>::Init(
           [=] XGBOOST_DEVICE(size_t _idx,
-                             common::Span<const bst_float> _preds,
+                             common::Span<bst_float> _preds,
                              common::Span<bst_float> _max_preds) {
-            common::Span<const bst_float> point =
+            // in place, the transformed rows are replaced by max_preds
+            common::Span<bst_float> point =
                 _preds.subspan(_idx * nclass, nclass);
-            _max_preds[_idx] =
-                common::FindMaxIndex(point.cbegin(),
-                                     point.cend()) - point.cbegin();
+            ArgMaxTransform::Apply(point.data(), point.size());
+            _max_preds[_idx] = point[0];
           },
           common::Range{0, ndata}, devices_, false)
-        .Eval(io_preds, &max_preds_);
-    }
-    if (!prob) {
-      io_preds->Resize(max_preds_.Size());
-      io_preds->Copy(max_preds_);
+        .Eval(io_preds, &max_preds);
+      io_preds->Resize(max_preds.Size());
+      io_preds->Copy(max_preds);
     }
   }
 
@@ -163,8 +172,6 @@ class SoftmaxMultiClassObj : public ObjFunction {
   // parameter
   SoftmaxMultiClassParam param_;
   GPUSet devices_;
-  // Cache for max_preds
-  HostDeviceVector<bst_float> max_preds_;
   HostDeviceVector<int> label_correct_;
 };
 
@@ -0,0 +1,99 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file pred_transform.h
+ * \brief Prediction transforms of the objectives. Each is defined once and
+ *  gives both the function and its C++ source for task=compile, so compiled
+ *  models run the same float operations as the objective.
+ */
+#ifndef XGBOOST_OBJECTIVE_PRED_TRANSFORM_H_
+#define XGBOOST_OBJECTIVE_PRED_TRANSFORM_H_
+
+#include <xgboost/base.h>
+#include <cmath>
+#include <string>
+
+/*!
+ * \brief define struct Name, whose Apply(x) evaluates the expression on one
+ *  prediction x and whose Source() is the expression. The expression may only
+ *  use <cmath>.
+ */
+#define XGBOOST_ELEMENTWISE_TRANSFORM(Name, ...)                        \
+  struct Name {                                                         \
+    XGBOOST_DEVICE static float Apply(float x) { return __VA_ARGS__; }  \
+    static const char* Source() { return #__VA_ARGS__; }                \
+  }
+
+/*!
+ * \brief define struct Name, whose Apply(io_preds, size) runs the braced body
+ *  on the predictions of one row in place and returns the number of outputs,
+ *  and whose Source() is the body. The body may only use <cmath>.
+ */
+#define XGBOOST_ROW_TRANSFORM(Name, ...)                                        \
+  struct Name {                                                                 \
+    XGBOOST_DEVICE static size_t Apply(float* io_preds, size_t size) __VA_ARGS__ \
+    static const char* Source() { return #__VA_ARGS__; }                        \
+  }
+
+namespace xgboost {
+namespace obj {
+
+XGBOOST_ELEMENTWISE_TRANSFORM(IdentityTransform, x);
+// same as common::Sigmoid
+XGBOOST_ELEMENTWISE_TRANSFORM(SigmoidTransform, 1.0f / (1.0f + expf(-x)));
+XGBOOST_ELEMENTWISE_TRANSFORM(ExpTransform, expf(x));
+XGBOOST_ELEMENTWISE_TRANSFORM(SignTransform, x > 0.0f ? 1.0f : 0.0f);
+
+// same as common::Softmax
+XGBOOST_ROW_TRANSFORM(SoftmaxTransform, {
+  float wmax = io_preds[0];
+  for (size_t i = 1; i < size; ++i) {
+    wmax = fmaxf(io_preds[i], wmax);
+  }
+  double wsum = 0.0f;
+  for (size_t i = 0; i < size; ++i) {
+    io_preds[i] = expf(io_preds[i] - wmax);
+    wsum += io_preds[i];
+  }
+  for (size_t i = 0; i < size; ++i) {
+    io_preds[i] /= static_cast<float>(wsum);
+  }
+  return size;
+});
+
+// index of the first maximum, as common::FindMaxIndex
+XGBOOST_ROW_TRANSFORM(ArgMaxTransform, {
+  size_t imax = 0;
+  for (size_t i = 1; i < size; ++i) {
+    if (io_preds[i] > io_preds[imax]) imax = i;
+  }
+  io_preds[0] = static_cast<float>(imax);
+  return 1;
+});
+
+XGBOOST_ROW_TRANSFORM(IdentityRowTransform, {
+  return size;
+});
+
+/*! \brief row transform applying the elementwise Transform to every output */
+template <typename Transform>
+struct ElementwiseRowTransform {
+  static size_t Apply(float* io_preds, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      io_preds[i] = Transform::Apply(io_preds[i]);
+    }
+    return size;
+  }
+  static std::string Source() {
+    return std::string("{\n"
+                       "  for (size_t i = 0; i < size; ++i) {\n"
+                       "    const float x = io_preds[i];\n"
+                       "    io_preds[i] = ") + Transform::Source() + ";\n"
+           "  }\n"
+           "  return size;\n"
+           "}\n";
+  }
+};
+
+}  // namespace obj
+}  // namespace xgboost
+#endif  // XGBOOST_OBJECTIVE_PRED_TRANSFORM_H_
@@ -12,6 +12,7 @@
 #include <utility>
 #include "../common/math.h"
 #include "../common/random.h"
+#include "./pred_transform.h"
 
 namespace xgboost {
 namespace obj {
@@ -129,6 +130,13 @@ class LambdaRankObj : public ObjFunction {
   const char* DefaultEvalMetric() const override {
     return "map";
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    return IdentityRowTransform::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return IdentityRowTransform::Source();
+  }
 
  protected:
   /*! \brief helper information in a list */
@@ -8,6 +8,7 @@
 #include <xgboost/logging.h>
 #include <algorithm>
 #include "../common/math.h"
+#include "./pred_transform.h"
 
 namespace xgboost {
 namespace obj {
@@ -15,9 +16,12 @@ namespace obj {
 // common regressions
 // linear regression
 struct LinearSquareLoss {
+  using PredTransformOp = IdentityTransform;
   // duplication is necessary, as __device__ specifier
   // cannot be made conditional on template parameter
-  XGBOOST_DEVICE static bst_float PredTransform(bst_float x) { return x; }
+  XGBOOST_DEVICE static bst_float PredTransform(bst_float x) {
+    return PredTransformOp::Apply(x);
+  }
   XGBOOST_DEVICE static bool CheckLabel(bst_float x) { return true; }
   XGBOOST_DEVICE static bst_float FirstOrderGradient(bst_float predt, bst_float label) {
     return predt - label;
@@ -38,9 +42,12 @@ struct LinearSquareLoss {
 
 // logistic loss for probability regression task
 struct LogisticRegression {
+  using PredTransformOp = SigmoidTransform;
   // duplication is necessary, as __device__ specifier
   // cannot be made conditional on template parameter
-  XGBOOST_DEVICE static bst_float PredTransform(bst_float x) { return common::Sigmoid(x); }
+  XGBOOST_DEVICE static bst_float PredTransform(bst_float x) {
+    return PredTransformOp::Apply(x);
+  }
   XGBOOST_DEVICE static bool CheckLabel(bst_float x) { return x >= 0.0f && x <= 1.0f; }
   XGBOOST_DEVICE static bst_float FirstOrderGradient(bst_float predt, bst_float label) {
     return predt - label;
@@ -76,9 +83,12 @@ struct LogisticClassification : public LogisticRegression {
 
 // logistic loss, but predict un-transformed margin
 struct LogisticRaw : public LogisticRegression {
+  using PredTransformOp = IdentityTransform;
   // duplication is necessary, as __device__ specifier
   // cannot be made conditional on template parameter
-  XGBOOST_DEVICE static bst_float PredTransform(bst_float x) { return x; }
+  XGBOOST_DEVICE static bst_float PredTransform(bst_float x) {
+    return PredTransformOp::Apply(x);
+  }
   XGBOOST_DEVICE static bst_float FirstOrderGradient(bst_float predt, bst_float label) {
     predt = common::Sigmoid(predt);
     return predt - label;
@@ -115,6 +115,13 @@ class RegLossObj : public ObjFunction {
         }, common::Range{0, static_cast<int64_t>(io_preds->Size())},
         devices_).Eval(io_preds);
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    return ElementwiseRowTransform<typename Loss::PredTransformOp>::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return ElementwiseRowTransform<typename Loss::PredTransformOp>::Source();
+  }
 
   float ProbToMargin(float base_score) const override {
     return Loss::ProbToMargin(base_score);
@@ -247,11 +254,18 @@ class PoissonRegression : public ObjFunction {
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     common::Transform<>::Init(
         [] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
-          _preds[_idx] = expf(_preds[_idx]);
+          _preds[_idx] = ExpTransform::Apply(_preds[_idx]);
         },
         common::Range{0, static_cast<int64_t>(io_preds->Size())}, devices_)
         .Eval(io_preds);
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    return ElementwiseRowTransform<ExpTransform>::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return ElementwiseRowTransform<ExpTransform>::Source();
+  }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
   }
@@ -344,9 +358,16 @@ class CoxRegression : public ObjFunction {
     const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
 #pragma omp parallel for schedule(static)
     for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
-      preds[j] = std::exp(preds[j]);
+      preds[j] = ExpTransform::Apply(preds[j]);
     }
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    return ElementwiseRowTransform<ExpTransform>::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return ElementwiseRowTransform<ExpTransform>::Source();
+  }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
   }
@@ -427,11 +448,18 @@ class GammaRegression : public ObjFunction {
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     common::Transform<>::Init(
         [] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
-          _preds[_idx] = expf(_preds[_idx]);
+          _preds[_idx] = ExpTransform::Apply(_preds[_idx]);
         },
         common::Range{0, static_cast<int64_t>(io_preds->Size())}, devices_)
         .Eval(io_preds);
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    return ElementwiseRowTransform<ExpTransform>::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return ElementwiseRowTransform<ExpTransform>::Source();
+  }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
   }
@@ -528,11 +556,18 @@ class TweedieRegression : public ObjFunction {
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     common::Transform<>::Init(
         [] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
-          _preds[_idx] = expf(_preds[_idx]);
+          _preds[_idx] = ExpTransform::Apply(_preds[_idx]);
         },
         common::Range{0, static_cast<int64_t>(io_preds->Size())}, devices_)
         .Eval(io_preds);
   }
+  bool HasPredTransformRow() const override { return true; }
+  size_t PredTransformRow(bst_float* io_preds, size_t size) override {
+    return ElementwiseRowTransform<ExpTransform>::Apply(io_preds, size);
+  }
+  std::string PredTransformRowSource() const override {
+    return ElementwiseRowTransform<ExpTransform>::Source();
+  }
 
   bst_float ProbToMargin(bst_float base_score) const override {
     return std::log(base_score);
@@ -4,90 +4,328 @@
 #include <xgboost/predictor.h>
 #include <xgboost/tree_model.h>
 #include <xgboost/tree_updater.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include "dmlc/logging.h"
 #include "../common/host_device_vector.h"
+#include "../common/object_pool.h"
+#include "../data/mapped_dmatrix.h"
+#include "flat_forest.h"
 
 namespace xgboost {
 namespace predictor {
 
 DMLC_REGISTRY_FILE_TAG(cpu_predictor);
 
+/*! \brief prediction parameters of the CPU predictor */
+struct CPUPredictionParam : public dmlc::Parameter<CPUPredictionParam> {
+  /*! \brief whether batch prediction compares bin indices instead of values */
+  bool quantized_prediction;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(CPUPredictionParam) {
+    DMLC_DECLARE_FIELD(quantized_prediction).set_default(false).describe(
+        "Map each row to the bins of the split thresholds used by the model "
+        "once, then traverse the trees over the bins in batch prediction.");
+  }
+};
+DMLC_REGISTER_PARAMETER(CPUPredictionParam);
+
+/*!
+ * \brief Buffers of one prediction call. They are taken from a pool for the
+ *  duration of the call, so concurrent calls never share them.
+ */
+struct PredictionScratch {
+  /*! \brief feature vectors, all entries missing between uses */
+  std::vector<RegTree::FVec> feats;
+  /*! \brief partial sums of the output groups */
+  std::vector<bst_float> psum;
+  /*! \brief unique paths of TreeShap */
+  std::vector<PathElement> shap_path;
+  /*! \brief feature contributions of blocks of rows */
+  std::vector<bst_float> contribs;
+  /*! \brief n feature vectors of num_feature entries */
+  inline RegTree::FVec* Feats(size_t n, int num_feature) {
+    if (!feats.empty() && feats[0].Size() != static_cast<size_t>(num_feature)) {
+      feats.clear();
+    }
+    const size_t prev_size = feats.size();
+    if (prev_size < n) {
+      feats.resize(n, RegTree::FVec());
+      for (size_t i = prev_size; i < n; ++i) {
+        feats[i].Init(num_feature);
+      }
+    }
+    return dmlc::BeginPtr(feats);
+  }
+  /*! \brief n partial sums */
+  inline bst_float* PSum(size_t n) {
+    if (psum.size() < n) {
+      psum.resize(n);
+    }
+    return dmlc::BeginPtr(psum);
+  }
+  /*! \brief n path elements */
+  inline PathElement* ShapPath(size_t n) {
+    if (shap_path.size() < n) {
+      shap_path.resize(n);
+    }
+    return dmlc::BeginPtr(shap_path);
+  }
+  /*! \brief n contributions */
+  inline bst_float* Contribs(size_t n) {
+    if (contribs.size() < n) {
+      contribs.resize(n);
+    }
+    return dmlc::BeginPtr(contribs);
+  }
+};
+
+/*!
+ * \brief Prediction on CPU. All predict methods may be called concurrently:
+ *  each call takes its buffers from a pool and a snapshot of the flattened
+ *  trees, and nothing else of the predictor is written while predicting.
+ *  Init and UpdatePredictionCache must not overlap with other calls.
+ */
 class CPUPredictor : public Predictor {
  protected:
-  static bst_float PredValue(const  SparsePage::Inst& inst,
-                             const std::vector<std::unique_ptr<RegTree>>& trees,
-                             const std::vector<int>& tree_info, int bst_group,
-                             unsigned root_index, RegTree::FVec* p_feats,
-                             unsigned tree_begin, unsigned tree_end) {
-    bst_float psum = 0.0f;
-    p_feats->Fill(inst);
-    for (size_t i = tree_begin; i < tree_end; ++i) {
-      if (tree_info[i] == bst_group) {
-        int tid = trees[i]->GetLeafIndex(*p_feats, root_index);
-        psum += (*trees[i])[tid].LeafValue();
+  // predict one row on the calling thread, one value per output group; a
+  // vector tree contributes to every group. fill(feats) and drop(feats) load
+  // the row into the feature vector and clear it again
+  template <typename FillFn, typename DropFn>
+  inline void PredictOne(const gbm::GBTreeModel& model, unsigned ntree_limit,
+                         unsigned root_index, FillFn fill, DropFn drop,
+                         bst_float* out_preds) {
+    auto scratch = scratch_pool_.Acquire();
+    RegTree::FVec* feats = scratch->Feats(1, model.param.num_feature);
+    ntree_limit *= model.param.TreesPerRound();
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+    const std::shared_ptr<const FlatForest> forest = GetForest(model);
+    const int num_group = model.param.num_output_group;
+    std::fill(out_preds, out_preds + num_group, 0.0f);
+    fill(feats);
+    forest->PredValue(*feats, root_index, 0, ntree_limit, num_group, out_preds);
+    drop(feats);
+    for (int gid = 0; gid < num_group; ++gid) {
+      out_preds[gid] += model.base_margin;
+    }
+  }
+
+  // the layout of the current trees of model, flattened on first use after a
+  // change; callers keep the snapshot for the whole call, so publishing a
+  // rebuilt layout never invalidates a running prediction
+  inline std::shared_ptr<const FlatForest> GetForest(const gbm::GBTreeModel& model) {
+    std::shared_ptr<const FlatForest> forest = std::atomic_load(&forest_);
+    if (forest == nullptr || !forest->IsCurrent(model)) {
+      auto fresh = std::make_shared<FlatForest>();
+      fresh->Init(model);
+      if (param_.quantized_prediction) {
+        fresh->InitQuantized();
       }
+      forest = fresh;
+      std::atomic_store(&forest_, forest);
     }
-    p_feats->Drop(inst);
-    return psum;
+    return forest;
   }
 
-  // init thread buffers
-  inline void InitThreadTemp(int nthread, int num_feature) {
-    int prev_thread_temp_size = thread_temp.size();
-    if (prev_thread_temp_size < nthread) {
-      thread_temp.resize(nthread, RegTree::FVec());
-      for (int i = prev_thread_temp_size; i < nthread; ++i) {
-        thread_temp[i].Init(num_feature);
+  // the node mean values of all trees of model, filled once per model version
+  // for all concurrent calls
+  inline void FillNodeMeanValues(const gbm::GBTreeModel& model) {
+    if (mean_values_version_.load(std::memory_order_acquire) == model.version) return;
+    std::lock_guard<std::mutex> guard(mean_values_mutex_);
+    if (mean_values_version_.load(std::memory_order_relaxed) == model.version) return;
+    const auto ntrees = static_cast<bst_omp_uint>(model.trees.size());
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < ntrees; ++i) {
+      model.trees[i]->FillNodeMeanValues();
+    }
+    mean_values_version_.store(model.version, std::memory_order_release);
+  }
+
+  // path elements per thread for TreeShap on trees [0, ntree_limit)
+  static size_t ShapPathSize(const FlatForest& forest, unsigned ntree_limit) {
+    int max_depth = 0;
+    for (unsigned j = 0; j < ntree_limit; ++j) {
+      max_depth = std::max(max_depth, forest.TreeDepth(j));
+    }
+    return RegTree::ShapPathSize(max_depth);
+  }
+  // add the contributions of trees [0, ntree_limit) for rows feats[0, n) to
+  // contribs, num_output_group * (num_feature + 1) values per row, each tree
+  // into the columns of its group. Each tree runs over the whole block while
+  // it is in cache, and still adds to every row in tree order.
+  inline void PredictContributionBlock(const gbm::GBTreeModel& model,
+                                       unsigned ntree_limit,
+                                       const RegTree::FVec* feats,
+                                       const unsigned* root_ids, size_t n,
+                                       bool approximate, int condition,
+                                       unsigned condition_feature,
+                                       PathElement* unique_path,
+                                       bst_float* contribs) const {
+    const size_t ncolumns = model.param.num_feature + 1;
+    const size_t row_stride = model.param.num_output_group * ncolumns;
+    for (unsigned j = 0; j < ntree_limit; ++j) {
+      const RegTree& tree = *model.trees[j];
+      bst_float* p_contribs = contribs + model.tree_info[j] * ncolumns;
+      for (size_t k = 0; k < n; ++k, p_contribs += row_stride) {
+        if (!approximate) {
+          tree.CalculateContributions(feats[k], root_ids[k], p_contribs,
+                                      condition, condition_feature, unique_path);
+        } else {
+          tree.CalculateContributionsApprox(feats[k], root_ids[k], p_contribs);
+        }
       }
     }
   }
+  // add the base margin of rows [base_rowid, base_rowid + n) to the bias of
+  // their contributions
+  static void AddBaseMargin(const gbm::GBTreeModel& model, const MetaInfo& info,
+                            size_t base_rowid, size_t n, bst_float* contribs) {
+    const int ngroup = model.param.num_output_group;
+    const size_t ncolumns = model.param.num_feature + 1;
+    const std::vector<bst_float>& base_margin = info.base_margin_.ConstHostVector();
+    for (size_t k = 0; k < n; ++k) {
+      const size_t row_idx = base_rowid + k;
+      // loop over all classes
+      for (int gid = 0; gid < ngroup; ++gid) {
+        bst_float* p_contribs = contribs + (k * ngroup + gid) * ncolumns;
+        // add base margin to BIAS
+        if (base_margin.size() != 0) {
+          p_contribs[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
+        } else {
+          p_contribs[ncolumns - 1] += model.base_margin;
+        }
+      }
+    }
+  }
+
   inline void PredLoopSpecalize(DMatrix* p_fmat,
                                 std::vector<bst_float>* out_preds,
                                 const gbm::GBTreeModel& model, int num_group,
                                 unsigned tree_begin, unsigned tree_end) {
-    const MetaInfo& info = p_fmat->Info();
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.param.num_feature);
-    std::vector<bst_float>& preds = *out_preds;
-    CHECK_EQ(model.param.size_leaf_vector, 0)
-        << "size_leaf_vector is enforced to 0 so far";
-    CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
+    const std::shared_ptr<const FlatForest> p_forest = GetForest(model);
+    const FlatForest& forest = *p_forest;
+    auto scratch = scratch_pool_.Acquire();
+    if (forest.QuantizedBinBytes() == 1) {
+      this->PredLoopQuantized<uint8_t>(forest, p_fmat, out_preds, num_group,
+                                       tree_begin, tree_end, &*scratch);
+      return;
+    } else if (forest.QuantizedBinBytes() == 2) {
+      this->PredLoopQuantized<uint16_t>(forest, p_fmat, out_preds, num_group,
+                                        tree_begin, tree_end, &*scratch);
+      return;
+    }
+    const size_t block = forest.BlockOfRows(model.param.num_feature);
+    RegTree::FVec* feats_tloc = scratch->Feats(nthread * block, model.param.num_feature);
+    // dense and mapped matrices are read in place instead of through CSR pages
+    ExternalRows rows;
+    if (data::InPlaceRows(p_fmat, &rows)) {
+      CHECK_EQ(out_preds->size(), p_fmat->Info().num_row_ * num_group);
+      this->PredRowBlocks(p_fmat->Info(), 0, rows.Size(), out_preds, num_group, block,
+                          &*scratch,
+                          [&](int tid, size_t begin, size_t n,
+                              const unsigned* root_ids, bst_float* psum) {
+        RegTree::FVec* feats = feats_tloc + tid * block;
+        for (size_t k = 0; k < n; ++k) {
+          feats[k].Fill(rows, begin + k);
+        }
+        forest.PredictBlock(feats, root_ids, n, tree_begin, tree_end,
+                            num_group, psum);
+        for (size_t k = 0; k < n; ++k) {
+          feats[k].Drop(rows, begin + k);
+        }
+      });
+      return;
+    }
+    this->PredLoopBlocks(p_fmat, out_preds, num_group, block, &*scratch,
+                         [&](int tid, const SparsePage& batch, size_t begin, size_t n,
+                             const unsigned* root_ids, bst_float* psum) {
+      RegTree::FVec* feats = feats_tloc + tid * block;
+      for (size_t k = 0; k < n; ++k) {
+        feats[k].Fill(batch[begin + k]);
+      }
+      forest.PredictBlock(feats, root_ids, n, tree_begin, tree_end,
+                          num_group, psum);
+      for (size_t k = 0; k < n; ++k) {
+        feats[k].Drop(batch[begin + k]);
+      }
+    });
+  }
+
+  // batch prediction over the bins of the model's thresholds
+  template <typename BinT>
+  inline void PredLoopQuantized(const FlatForest& forest, DMatrix* p_fmat,
+                                std::vector<bst_float>* out_preds, int num_group,
+                                unsigned tree_begin, unsigned tree_end,
+                                PredictionScratch* scratch) {
+    const int nthread = omp_get_max_threads();
+    const size_t ncol = forest.NumBinColumns();
+    const size_t block = forest.BlockOfRows(static_cast<int>(ncol));
+    std::vector<BinT> bins_tloc(nthread * block * ncol);
+    this->PredLoopBlocks(p_fmat, out_preds, num_group, block, scratch,
+                         [&](int tid, const SparsePage& batch, size_t begin, size_t n,
+                             const unsigned* root_ids, bst_float* psum) {
+      BinT* bins = dmlc::BeginPtr(bins_tloc) + tid * block * ncol;
+      for (size_t k = 0; k < n; ++k) {
+        forest.FillBins(batch[begin + k], bins + k * ncol);
+      }
+      forest.PredictBlockQuantized(bins, root_ids, n, tree_begin, tree_end,
+                                   num_group, psum);
+    });
+  }
+
+  // rows are predicted in blocks, each tree is run over a whole block:
+  // predict_block(tid, batch, begin, n, root_ids, psum) adds the outputs of
+  // rows [begin, begin + n) of batch to the zeroed psum
+  template <typename BlockFn>
+  inline void PredLoopBlocks(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                             int num_group, size_t block, PredictionScratch* scratch,
+                             BlockFn predict_block) {
+    CHECK_EQ(out_preds->size(), p_fmat->Info().num_row_ * num_group);
     // start collecting the prediction
     for (const auto &batch : p_fmat->GetRowBatches()) {
-      // parallel over local batch
-      constexpr int kUnroll = 8;
-      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
-      const bst_omp_uint rest = nsize % kUnroll;
+      this->PredRowBlocks(p_fmat->Info(), batch.base_rowid, batch.Size(), out_preds,
+                          num_group, block, scratch,
+                          [&](int tid, size_t begin, size_t n,
+                              const unsigned* root_ids, bst_float* psum) {
+        predict_block(tid, batch, begin, n, root_ids, psum);
+      });
+    }
+  }
+
+  // predict rows [base_rowid, base_rowid + nsize) in blocks:
+  // predict_block(tid, begin, n, root_ids, psum) adds the outputs of rows
+  // [begin, begin + n), counted from base_rowid, to the zeroed psum
+  template <typename BlockFn>
+  inline void PredRowBlocks(const MetaInfo& info, size_t base_rowid, size_t nsize,
+                            std::vector<bst_float>* out_preds, int num_group,
+                            size_t block, PredictionScratch* scratch,
+                            BlockFn predict_block) {
+    const int nthread = omp_get_max_threads();
+    std::vector<bst_float>& preds = *out_preds;
+    // per thread sums of one block
+    bst_float* psum_tloc = scratch->PSum(nthread * block * num_group);
+    // parallel over local batch
+    const auto nblock = static_cast<bst_omp_uint>((nsize + block - 1) / block);
 #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize - rest; i += kUnroll) {
-        const int tid = omp_get_thread_num();
-        RegTree::FVec& feats = thread_temp[tid];
-        int64_t ridx[kUnroll];
-        SparsePage::Inst inst[kUnroll];
-        for (int k = 0; k < kUnroll; ++k) {
-          ridx[k] = static_cast<int64_t>(batch.base_rowid + i + k);
-        }
-        for (int k = 0; k < kUnroll; ++k) {
-          inst[k] = batch[i + k];
-        }
-        for (int k = 0; k < kUnroll; ++k) {
-          for (int gid = 0; gid < num_group; ++gid) {
-            const size_t offset = ridx[k] * num_group + gid;
-            preds[offset] += this->PredValue(
-                inst[k], model.trees, model.tree_info, gid,
-                info.GetRoot(ridx[k]), &feats, tree_begin, tree_end);
-          }
-        }
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      const int tid = omp_get_thread_num();
+      bst_float* psum = psum_tloc + tid * block * num_group;
+      const size_t begin = static_cast<size_t>(b) * block;
+      const size_t n = std::min(block, nsize - begin);
+      unsigned root_ids[FlatForest::kMaxBlockOfRows];
+      for (size_t k = 0; k < n; ++k) {
+        root_ids[k] = info.GetRoot(base_rowid + begin + k);
       }
-      for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
-        RegTree::FVec& feats = thread_temp[0];
-        const auto ridx = static_cast<int64_t>(batch.base_rowid + i);
-         auto inst = batch[i];
+      std::fill(psum, psum + n * num_group, 0.0f);
+      predict_block(tid, begin, n, root_ids, psum);
+      for (size_t k = 0; k < n; ++k) {
+        const size_t ridx = base_rowid + begin + k;
         for (int gid = 0; gid < num_group; ++gid) {
-          const size_t offset = ridx * num_group + gid;
-          preds[offset] +=
-              this->PredValue(inst, model.trees, model.tree_info, gid,
-                              info.GetRoot(ridx), &feats, tree_begin, tree_end);
+          preds[ridx * num_group + gid] += psum[k * num_group + gid];
         }
       }
     }
@@ -106,7 +344,7 @@ class CPUPredictor : public Predictor {
                         const gbm::GBTreeModel& model,
                         unsigned ntree_limit) {
     if (ntree_limit == 0 ||
-        ntree_limit * model.param.num_output_group >= model.trees.size()) {
+        ntree_limit * model.param.TreesPerRound() >= model.trees.size()) {
       auto it = cache_.find(dmat);
       if (it != cache_.end()) {
         const HostDeviceVector<bst_float>& y = it->second.predictions;
@@ -152,6 +390,17 @@ class CPUPredictor : public Predictor {
   }
 
  public:
+  void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
+            const std::vector<std::shared_ptr<DMatrix>>& cache) override {
+    Predictor::Init(cfg, cache);
+    const bool quantized = param_.quantized_prediction;
+    param_.InitAllowUnknown(cfg);
+    if (param_.quantized_prediction != quantized) {
+      // the layout is rebuilt with or without the bins on next use
+      std::atomic_store(&forest_, std::shared_ptr<const FlatForest>());
+    }
+  }
+
   void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
                     const gbm::GBTreeModel& model, int tree_begin,
                     unsigned ntree_limit = 0) override {
@@ -161,7 +410,7 @@ class CPUPredictor : public Predictor {
 
     this->InitOutPredictions(dmat->Info(), out_preds, model);
 
-    ntree_limit *= model.param.num_output_group;
+    ntree_limit *= model.param.TreesPerRound();
     if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
       ntree_limit = static_cast<unsigned>(model.trees.size());
     }
@@ -170,6 +419,46 @@ class CPUPredictor : public Predictor {
                            tree_begin, ntree_limit);
   }
 
+  void PredictRows(const ExternalRows& rows, bst_float* out_preds,
+                   const gbm::GBTreeModel& model, unsigned ntree_limit) override {
+    ntree_limit *= model.param.TreesPerRound();
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+    const std::shared_ptr<const FlatForest> p_forest = GetForest(model);
+    const FlatForest& forest = *p_forest;
+    const int num_group = model.param.num_output_group;
+    const int nthread = omp_get_max_threads();
+    const size_t block = forest.BlockOfRows(model.param.num_feature);
+    auto scratch = scratch_pool_.Acquire();
+    RegTree::FVec* feats_tloc = scratch->Feats(nthread * block, model.param.num_feature);
+    // per thread sums of one block
+    bst_float* psum_tloc = scratch->PSum(nthread * block * num_group);
+    const auto nsize = static_cast<bst_omp_uint>(rows.Size());
+    const auto nblock = static_cast<bst_omp_uint>((nsize + block - 1) / block);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      const int tid = omp_get_thread_num();
+      RegTree::FVec* feats = feats_tloc + tid * block;
+      bst_float* psum = psum_tloc + tid * block * num_group;
+      const size_t begin = static_cast<size_t>(b) * block;
+      const size_t n = std::min(block, static_cast<size_t>(nsize) - begin);
+      const unsigned root_ids[FlatForest::kMaxBlockOfRows] = {0};
+      for (size_t k = 0; k < n; ++k) {
+        feats[k].Fill(rows, begin + k);
+      }
+      std::fill(psum, psum + n * num_group, 0.0f);
+      forest.PredictBlock(feats, root_ids, n, 0, ntree_limit, num_group, psum);
+      for (size_t k = 0; k < n; ++k) {
+        feats[k].Drop(rows, begin + k);
+        for (int gid = 0; gid < num_group; ++gid) {
+          out_preds[(begin + k) * num_group + gid] =
+              model.base_margin + psum[k * num_group + gid];
+        }
+      }
+    }
+  }
+
   void UpdatePredictionCache(
       const gbm::GBTreeModel& model,
       std::vector<std::unique_ptr<TreeUpdater>>* updaters,
@@ -183,7 +472,8 @@ class CPUPredictor : public Predictor {
         InitOutPredictions(e.data->Info(), &(e.predictions), model);
         PredLoopInternal(e.data.get(), &(e.predictions.HostVector()), model, 0,
                          model.trees.size());
-      } else if (model.param.num_output_group == 1 && updaters->size() > 0 &&
+      } else if ((model.param.num_output_group == 1 ||
+                  model.param.size_leaf_vector != 0) && updaters->size() > 0 &&
                  num_new_trees == 1 &&
                  updaters->back()->UpdatePredictionCache(e.data.get(),
                                                          &(e.predictions))) {
@@ -199,34 +489,62 @@ class CPUPredictor : public Predictor {
                        std::vector<bst_float>* out_preds,
                        const gbm::GBTreeModel& model, unsigned ntree_limit,
                        unsigned root_index) override {
-    if (thread_temp.size() == 0) {
-      thread_temp.resize(1, RegTree::FVec());
-      thread_temp[0].Init(model.param.num_feature);
-    }
-    ntree_limit *= model.param.num_output_group;
+    out_preds->resize(model.param.num_output_group);
+    this->PredictOne(model, ntree_limit, root_index,
+                     [&](RegTree::FVec* feats) { feats->Fill(inst); },
+                     [&](RegTree::FVec* feats) { feats->Drop(inst); },
+                     dmlc::BeginPtr(*out_preds));
+  }
+
+  void PredictRow(const ExternalRows& row, bst_float* out_preds,
+                  const gbm::GBTreeModel& model, unsigned ntree_limit) override {
+    CHECK_EQ(row.Size(), 1U);
+    this->PredictOne(model, ntree_limit, 0,
+                     [&](RegTree::FVec* feats) { feats->Fill(row, 0); },
+                     [&](RegTree::FVec* feats) { feats->Drop(row, 0); },
+                     out_preds);
+  }
+
+  void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                       uint8_t* out_decision, unsigned* out_ntree,
+                       const gbm::GBTreeModel& model, unsigned ntree_limit) override {
+    CHECK_EQ(model.param.num_output_group, 1)
+        << "Early exit decisions need a model with a single output";
+    ntree_limit *= model.param.TreesPerRound();
     if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
       ntree_limit = static_cast<unsigned>(model.trees.size());
     }
-    out_preds->resize(model.param.num_output_group *
-                      (model.param.size_leaf_vector + 1));
-    // loop over output groups
-    for (int gid = 0; gid < model.param.num_output_group; ++gid) {
-      (*out_preds)[gid] =
-          PredValue(inst, model.trees, model.tree_info, gid, root_index,
-                    &thread_temp[0], 0, ntree_limit) +
-          model.base_margin;
+    const std::shared_ptr<const FlatForest> p_forest = GetForest(model);
+    const FlatForest& forest = *p_forest;
+    const int nthread = omp_get_max_threads();
+    auto scratch = scratch_pool_.Acquire();
+    RegTree::FVec* feats_tloc = scratch->Feats(nthread, model.param.num_feature);
+    const auto nsize = static_cast<bst_omp_uint>(rows.Size());
+    // rows stop after different numbers of trees, so they go one at a time
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      RegTree::FVec& feats = feats_tloc[omp_get_thread_num()];
+      feats.Fill(rows, i);
+      bool decision;
+      out_ntree[i] = static_cast<unsigned>(forest.PredDecision(
+          feats, 0, ntree_limit, model.base_margin, cutoff, &decision));
+      out_decision[i] = decision ? 1 : 0;
+      feats.Drop(rows, i);
     }
   }
   void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
                    const gbm::GBTreeModel& model, unsigned ntree_limit) override {
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.param.num_feature);
+    auto scratch = scratch_pool_.Acquire();
+    RegTree::FVec* feats_tloc = scratch->Feats(nthread, model.param.num_feature);
     const MetaInfo& info = p_fmat->Info();
     // number of valid trees
-    ntree_limit *= model.param.num_output_group;
+    ntree_limit *= model.param.TreesPerRound();
     if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
       ntree_limit = static_cast<unsigned>(model.trees.size());
     }
+    const std::shared_ptr<const FlatForest> p_forest = GetForest(model);
+    const FlatForest& forest = *p_forest;
     std::vector<bst_float>& preds = *out_preds;
     preds.resize(info.num_row_ * ntree_limit);
     // start collecting the prediction
@@ -237,10 +555,10 @@ class CPUPredictor : public Predictor {
       for (bst_omp_uint i = 0; i < nsize; ++i) {
         const int tid = omp_get_thread_num();
         auto ridx = static_cast<size_t>(batch.base_rowid + i);
-        RegTree::FVec& feats = thread_temp[tid];
+        RegTree::FVec& feats = feats_tloc[tid];
         feats.Fill(batch[i]);
         for (unsigned j = 0; j < ntree_limit; ++j) {
-          int tid = model.trees[j]->GetLeafIndex(feats, info.GetRoot(ridx));
+          int tid = forest.LeafIndex(j, info.GetRoot(ridx), feats);
           preds[ridx * ntree_limit + j] = static_cast<bst_float>(tid);
         }
         feats.Drop(batch[i]);
@@ -253,14 +571,22 @@ class CPUPredictor : public Predictor {
                            bool approximate,
                            int condition,
                            unsigned condition_feature) override {
-    const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread,  model.param.num_feature);
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "feature contributions are not supported for multi_output_tree";
+    const std::shared_ptr<const FlatForest> p_forest = GetForest(model);
+    const FlatForest& forest = *p_forest;
     const MetaInfo& info = p_fmat->Info();
     // number of valid trees
-    ntree_limit *= model.param.num_output_group;
+    ntree_limit *= model.param.TreesPerRound();
     if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
       ntree_limit = static_cast<unsigned>(model.trees.size());
     }
+    const int nthread = omp_get_max_threads();
+    const size_t block = forest.BlockOfRows(model.param.num_feature);
+    auto scratch = scratch_pool_.Acquire();
+    RegTree::FVec* feats_tloc = scratch->Feats(nthread * block, model.param.num_feature);
+    const size_t path_size = ShapPathSize(forest, ntree_limit);
+    PathElement* path_tloc = scratch->ShapPath(nthread * path_size);
     const int ngroup = model.param.num_output_group;
     size_t ncolumns = model.param.num_feature + 1;
     // allocate space for (number of features + bias) times the number of rows
@@ -269,46 +595,32 @@ class CPUPredictor : public Predictor {
     // make sure contributions is zeroed, we could be reusing a previously
     // allocated one
     std::fill(contribs.begin(), contribs.end(), 0);
-    // initialize tree node mean values
-    #pragma omp parallel for schedule(static)
-    for (bst_omp_uint i = 0; i < ntree_limit; ++i) {
-      model.trees[i]->FillNodeMeanValues();
-    }
-    const std::vector<bst_float>& base_margin = info.base_margin_.HostVector();
+    this->FillNodeMeanValues(model);
     // start collecting the contributions
     for (const auto &batch : p_fmat->GetRowBatches()) {
-      // parallel over local batch
+      // parallel over blocks of the local batch
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      const auto nblock = static_cast<bst_omp_uint>((nsize + block - 1) / block);
 #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize; ++i) {
-        auto row_idx = static_cast<size_t>(batch.base_rowid + i);
-        unsigned root_id = info.GetRoot(row_idx);
-        RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
-        // loop over all classes
-        for (int gid = 0; gid < ngroup; ++gid) {
-          bst_float* p_contribs =
-              &contribs[(row_idx * ngroup + gid) * ncolumns];
-          feats.Fill(batch[i]);
-          // calculate contributions
-          for (unsigned j = 0; j < ntree_limit; ++j) {
-            if (model.tree_info[j] != gid) {
-              continue;
-            }
-            if (!approximate) {
-              model.trees[j]->CalculateContributions(feats, root_id, p_contribs,
-                                                     condition, condition_feature);
-            } else {
-              model.trees[j]->CalculateContributionsApprox(feats, root_id, p_contribs);
-            }
-          }
-          feats.Drop(batch[i]);
-          // add base margin to BIAS
-          if (base_margin.size() != 0) {
-            p_contribs[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
-          } else {
-            p_contribs[ncolumns - 1] += model.base_margin;
-          }
+      for (bst_omp_uint b = 0; b < nblock; ++b) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec* feats = feats_tloc + tid * block;
+        const size_t begin = static_cast<size_t>(b) * block;
+        const size_t n = std::min(block, static_cast<size_t>(nsize) - begin);
+        unsigned root_ids[FlatForest::kMaxBlockOfRows];
+        for (size_t k = 0; k < n; ++k) {
+          root_ids[k] = info.GetRoot(batch.base_rowid + begin + k);
+          feats[k].Fill(batch[begin + k]);
+        }
+        bst_float* block_contribs = &contribs[(batch.base_rowid + begin) * ngroup * ncolumns];
+        this->PredictContributionBlock(model, ntree_limit, feats, root_ids, n,
+                                       approximate, condition, condition_feature,
+                                       path_tloc + tid * path_size, block_contribs);
+        for (size_t k = 0; k < n; ++k) {
+          feats[k].Drop(batch[begin + k]);
         }
+        this->AddBaseMargin(model, info, batch.base_rowid + begin, n,
+                            block_contribs);
       }
     }
   }
@@ -316,47 +628,155 @@ class CPUPredictor : public Predictor {
   void PredictInteractionContributions(DMatrix* p_fmat, std::vector<bst_float>* out_contribs,
                                        const gbm::GBTreeModel& model, unsigned ntree_limit,
                                        bool approximate) override {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "feature contributions are not supported for multi_output_tree";
+    const std::shared_ptr<const FlatForest> p_forest = GetForest(model);
+    const FlatForest& forest = *p_forest;
     const MetaInfo& info = p_fmat->Info();
+    ntree_limit *= model.param.TreesPerRound();
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
     const int ngroup = model.param.num_output_group;
-    size_t ncolumns = model.param.num_feature;
-    const unsigned row_chunk = ngroup * (ncolumns + 1) * (ncolumns + 1);
-    const unsigned mrow_chunk = (ncolumns + 1) * (ncolumns + 1);
-    const unsigned crow_chunk = ngroup * (ncolumns + 1);
+    const size_t ncolumns = model.param.num_feature + 1;
+    const size_t crow_chunk = ngroup * ncolumns;
+    const size_t mrow_chunk = ncolumns * ncolumns;
+    const size_t row_chunk = ngroup * mrow_chunk;
 
-    // allocate space for (number of features^2) times the number of rows and tmp off/on contribs
+    // Conditioning on a feature no tree splits on gives the same
+    // contributions whether it is on or off, so all its interactions are
+    // zero; the bias is never split on. Approximate contributions ignore the
+    // condition altogether.
+    std::vector<unsigned> conditioned;
+    if (!approximate) {
+      std::vector<bool> used(ncolumns, false);
+      for (unsigned j = 0; j < ntree_limit; ++j) {
+        const RegTree& tree = *model.trees[j];
+        for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+          if (!tree[nid].IsLeaf()) used[tree[nid].SplitIndex()] = true;
+        }
+      }
+      for (unsigned i = 0; i < ncolumns; ++i) {
+        if (used[i]) conditioned.push_back(i);
+      }
+    }
+
+    const int nthread = omp_get_max_threads();
+    const size_t block = forest.BlockOfRows(model.param.num_feature);
+    auto scratch = scratch_pool_.Acquire();
+    RegTree::FVec* feats_tloc = scratch->Feats(nthread * block, model.param.num_feature);
+    const size_t path_size = ShapPathSize(forest, ntree_limit);
+    PathElement* path_tloc = scratch->ShapPath(nthread * path_size);
+    // per thread contributions of one block, with the feature off and on
+    const size_t block_size = block * crow_chunk;
+    bst_float* contribs_tloc = scratch->Contribs(nthread * 2 * block_size);
+
+    // the (number of features + bias)^2 matrix of each row and group, written
+    // in place; off diagonal entries of features never conditioned on stay 0
     std::vector<bst_float>& contribs = *out_contribs;
-    contribs.resize(info.num_row_ * ngroup * (ncolumns + 1) * (ncolumns + 1));
-    std::vector<bst_float> contribs_off(info.num_row_ * ngroup * (ncolumns + 1));
-    std::vector<bst_float> contribs_on(info.num_row_ * ngroup * (ncolumns + 1));
-    std::vector<bst_float> contribs_diag(info.num_row_ * ngroup * (ncolumns + 1));
-
-    // Compute the difference in effects when conditioning on each of the features on and off
-    // see: Axiomatic characterizations of probabilistic and
-    //      cardinal-probabilistic interaction indices
-    PredictContribution(p_fmat, &contribs_diag, model, ntree_limit, approximate, 0, 0);
-    for (size_t i = 0; i < ncolumns + 1; ++i) {
-      PredictContribution(p_fmat, &contribs_off, model, ntree_limit, approximate, -1, i);
-      PredictContribution(p_fmat, &contribs_on, model, ntree_limit, approximate, 1, i);
-
-      for (size_t j = 0; j < info.num_row_; ++j) {
-        for (int l = 0; l < ngroup; ++l) {
-          const unsigned o_offset = j * row_chunk + l * mrow_chunk + i * (ncolumns + 1);
-          const unsigned c_offset = j * crow_chunk + l * (ncolumns + 1);
-          contribs[o_offset + i] = 0;
-          for (size_t k = 0; k < ncolumns + 1; ++k) {
-            // fill in the diagonal with additive effects, and off-diagonal with the interactions
-            if (k == i) {
-              contribs[o_offset + i] += contribs_diag[c_offset + k];
-            } else {
-              contribs[o_offset + k] = (contribs_on[c_offset + k] - contribs_off[c_offset + k])/2.0;
-              contribs[o_offset + i] -= contribs[o_offset + k];
+    contribs.resize(info.num_row_ * row_chunk);
+    std::fill(contribs.begin(), contribs.end(), 0);
+    this->FillNodeMeanValues(model);
+
+    for (const auto &batch : p_fmat->GetRowBatches()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      const auto nblock = static_cast<bst_omp_uint>((nsize + block - 1) / block);
+      // load block b into feats, return its number of rows
+      auto fill = [&](bst_omp_uint b, RegTree::FVec* feats, unsigned* root_ids) {
+        const size_t begin = static_cast<size_t>(b) * block;
+        const size_t n = std::min(block, static_cast<size_t>(nsize) - begin);
+        for (size_t k = 0; k < n; ++k) {
+          root_ids[k] = info.GetRoot(batch.base_rowid + begin + k);
+          feats[k].Fill(batch[begin + k]);
+        }
+        return n;
+      };
+      auto drop = [&](bst_omp_uint b, size_t n, RegTree::FVec* feats) {
+        for (size_t k = 0; k < n; ++k) {
+          feats[k].Drop(batch[static_cast<size_t>(b) * block + k]);
+        }
+      };
+
+      // the additive effects go to the diagonal first
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint b = 0; b < nblock; ++b) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec* feats = feats_tloc + tid * block;
+        bst_float* diag = contribs_tloc + tid * 2 * block_size;
+        unsigned root_ids[FlatForest::kMaxBlockOfRows];
+        const size_t n = fill(b, feats, root_ids);
+        const size_t base_rowid = batch.base_rowid + static_cast<size_t>(b) * block;
+        std::fill(diag, diag + n * crow_chunk, 0.0f);
+        this->PredictContributionBlock(model, ntree_limit, feats, root_ids, n,
+                                       approximate, 0, 0,
+                                       path_tloc + tid * path_size, diag);
+        drop(b, n, feats);
+        this->AddBaseMargin(model, info, base_rowid, n, diag);
+        for (size_t k = 0; k < n; ++k) {
+          for (int l = 0; l < ngroup; ++l) {
+            bst_float* matrix = &contribs[(base_rowid + k) * row_chunk + l * mrow_chunk];
+            for (size_t i = 0; i < ncolumns; ++i) {
+              matrix[i * ncolumns + i] = diag[k * crow_chunk + l * ncolumns + i];
             }
           }
         }
       }
+
+      // then one task per block and conditioned feature fills the row of
+      // that feature: the difference in effects when conditioning on the
+      // feature on and off, see: Axiomatic characterizations of
+      // probabilistic and cardinal-probabilistic interaction indices
+      const auto ntask = static_cast<bst_omp_uint>(nblock * conditioned.size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint t = 0; t < ntask; ++t) {
+        const int tid = omp_get_thread_num();
+        const bst_omp_uint b = t / conditioned.size();
+        const unsigned i = conditioned[t % conditioned.size()];
+        RegTree::FVec* feats = feats_tloc + tid * block;
+        bst_float* contribs_off = contribs_tloc + tid * 2 * block_size;
+        bst_float* contribs_on = contribs_off + block_size;
+        PathElement* unique_path = path_tloc + tid * path_size;
+        unsigned root_ids[FlatForest::kMaxBlockOfRows];
+        const size_t n = fill(b, feats, root_ids);
+        const size_t base_rowid = batch.base_rowid + static_cast<size_t>(b) * block;
+        std::fill(contribs_off, contribs_off + 2 * block_size, 0.0f);
+        this->PredictContributionBlock(model, ntree_limit, feats, root_ids, n,
+                                       approximate, -1, i, unique_path, contribs_off);
+        this->PredictContributionBlock(model, ntree_limit, feats, root_ids, n,
+                                       approximate, 1, i, unique_path, contribs_on);
+        drop(b, n, feats);
+        for (size_t k = 0; k < n; ++k) {
+          for (int l = 0; l < ngroup; ++l) {
+            bst_float* out = &contribs[(base_rowid + k) * row_chunk + l * mrow_chunk +
+                                       i * ncolumns];
+            const size_t c_offset = k * crow_chunk + l * ncolumns;
+            // fill in the diagonal with additive effects, and off-diagonal
+            // with the interactions
+            bst_float diag = 0;
+            for (size_t j = 0; j < ncolumns; ++j) {
+              if (j == i) {
+                diag += out[i];
+              } else {
+                out[j] = (contribs_on[c_offset + j] - contribs_off[c_offset + j]) / 2.0;
+                diag -= out[j];
+              }
+            }
+            out[i] = diag;
+          }
+        }
+      }
     }
   }
-  std::vector<RegTree::FVec> thread_temp;
+
+  // buffers of the calls in flight, and idle ones kept for later calls
+  common::ObjectPool<PredictionScratch> scratch_pool_;
+  // inference layout of the last model predicted from, swapped atomically
+  std::shared_ptr<const FlatForest> forest_;
+  // guards the lazy fill of the node mean values of the trees
+  std::mutex mean_values_mutex_;
+  // model version whose node mean values are filled
+  std::atomic<uint64_t> mean_values_version_ {0};
+  CPUPredictionParam param_;
 };
 
 XGBOOST_REGISTER_PREDICTOR(CPUPredictor, "cpu_predictor")
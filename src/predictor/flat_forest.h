@@ -0,0 +1,483 @@
+/*!
+ * Copyright 2019 by Contributors
+ * \file flat_forest.h
+ * \brief Contiguous inference layout of a tree ensemble for CPU prediction.
+ */
+#ifndef XGBOOST_PREDICTOR_FLAT_FOREST_H_
+#define XGBOOST_PREDICTOR_FLAT_FOREST_H_
+
+#include <xgboost/data.h>
+#include <xgboost/tree_model.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+/*!
+ * \brief All trees of a model in one node array, built once per model version.
+ *
+ *  Each tree is laid out breadth-first with its roots first, so the two
+ *  children of a split are adjacent and only the left one is stored. Nodes
+ *  carry nothing prediction does not read; leaves hold their value inline,
+ *  category bitsets and leaf vectors live in separate arrays.
+ */
+class FlatForest {
+ public:
+  /*! \brief a 12-byte node */
+  struct Node {
+    /*! \brief split feature; the high bits flag default left, leaf and categorical */
+    uint32_t sindex;
+    /*! \brief index of the left child, the right one follows it; node id in the RegTree for leaves */
+    uint32_t child;
+    union {
+      /*! \brief threshold of a numerical split */
+      bst_float split_cond;
+      /*! \brief output of a leaf in a scalar tree */
+      bst_float leaf_value;
+      /*! \brief offset of the category bitset, or of the leaf vector */
+      uint32_t ref;
+    };
+    inline bool IsLeaf() const { return (sindex & kLeafBit) != 0; }
+    inline bool IsCategorical() const { return (sindex & kCategoricalBit) != 0; }
+    inline bool DefaultLeft() const { return (sindex & kDefaultLeftBit) != 0; }
+    inline unsigned SplitIndex() const { return sindex & kIndexMask; }
+  };
+  static_assert(sizeof(Node) == 12, "FlatForest::Node must be 12 bytes");
+
+  static constexpr uint32_t kDefaultLeftBit = 1U << 31;
+  static constexpr uint32_t kLeafBit = 1U << 30;
+  static constexpr uint32_t kCategoricalBit = 1U << 29;
+  static constexpr uint32_t kIndexMask = kCategoricalBit - 1;
+  static constexpr size_t kMinBlockOfRows = 32;
+  static constexpr size_t kMaxBlockOfRows = 128;
+
+  /*! \brief whether the layout reflects the current trees of model */
+  inline bool IsCurrent(const gbm::GBTreeModel& model) const {
+    return version_ == model.version && tree_ptr_.size() == model.trees.size() + 1;
+  }
+  /*! \brief flatten all trees of model */
+  void Init(const gbm::GBTreeModel& model) {
+    size_leaf_vector_ = model.param.size_leaf_vector;
+    nodes_.clear();
+    categories_.clear();
+    leaf_vectors_.clear();
+    tree_ptr_.assign(1, 0);
+    tree_info_ = model.tree_info;
+    leaf_bounds_.clear();
+    tree_depth_.clear();
+    bin_bytes_ = 0;
+    qnodes_.clear();
+    std::vector<int> order;
+    std::vector<uint32_t> position;
+    std::vector<int> depth;
+    for (const auto& p_tree : model.trees) {
+      const RegTree& tree = *p_tree;
+      const auto base = static_cast<uint32_t>(nodes_.size());
+      // breadth-first order: the roots, then children pairwise
+      order.clear();
+      for (int nid = 0; nid < tree.param.num_roots; ++nid) {
+        order.push_back(nid);
+      }
+      for (size_t i = 0; i < order.size(); ++i) {
+        const RegTree::Node& node = tree[order[i]];
+        if (!node.IsLeaf()) {
+          order.push_back(node.LeftChild());
+          order.push_back(node.RightChild());
+        }
+      }
+      position.assign(tree.param.num_nodes, 0);
+      depth.assign(tree.param.num_nodes, 0);
+      int max_depth = 0;
+      for (size_t i = 0; i < order.size(); ++i) {
+        position[order[i]] = base + static_cast<uint32_t>(i);
+        const RegTree::Node& node = tree[order[i]];
+        if (!node.IsLeaf()) {
+          depth[node.LeftChild()] = depth[node.RightChild()] = depth[order[i]] + 1;
+          max_depth = std::max(max_depth, depth[order[i]] + 1);
+        }
+      }
+      tree_depth_.push_back(max_depth);
+      for (int nid : order) {
+        const RegTree::Node& node = tree[nid];
+        Node flat;
+        if (node.IsLeaf()) {
+          flat.sindex = kLeafBit;
+          flat.child = static_cast<uint32_t>(nid);
+          if (size_leaf_vector_ != 0) {
+            flat.ref = static_cast<uint32_t>(leaf_vectors_.size());
+            const bst_float* leaf = tree.LeafVector(nid);
+            leaf_vectors_.insert(leaf_vectors_.end(), leaf, leaf + size_leaf_vector_);
+          } else {
+            flat.leaf_value = node.LeafValue();
+          }
+        } else {
+          CHECK_LE(node.SplitIndex(), static_cast<uint32_t>(kIndexMask))
+              << "feature index too large for the flat prediction layout";
+          flat.sindex = node.SplitIndex();
+          if (node.DefaultLeft()) flat.sindex |= kDefaultLeftBit;
+          flat.child = position[node.LeftChild()];
+          if (tree.IsCategorical(nid)) {
+            flat.sindex |= kCategoricalBit;
+            flat.ref = static_cast<uint32_t>(categories_.size());
+            this->PushCategories(tree.NodeCategories(nid));
+          } else {
+            flat.split_cond = node.SplitCond();
+          }
+        }
+        nodes_.push_back(flat);
+      }
+      tree_ptr_.push_back(nodes_.size());
+      if (size_leaf_vector_ == 0) {
+        LeafBound bound {std::numeric_limits<double>::max(),
+                         std::numeric_limits<double>::lowest(), 0.0};
+        for (size_t i = tree_ptr_[tree_ptr_.size() - 2]; i < nodes_.size(); ++i) {
+          if (!nodes_[i].IsLeaf()) continue;
+          const double value = nodes_[i].leaf_value;
+          bound.min = std::min(bound.min, value);
+          bound.max = std::max(bound.max, value);
+          bound.abs = std::max(bound.abs, std::abs(value));
+        }
+        leaf_bounds_.push_back(bound);
+      }
+    }
+    // suffix sums, the bound of trees [i, j) is leaf_bounds_[i] - leaf_bounds_[j]
+    leaf_bounds_.push_back(LeafBound {0.0, 0.0, 0.0});
+    for (size_t i = leaf_bounds_.size() - 1; i-- > 0;) {
+      leaf_bounds_[i].min += leaf_bounds_[i + 1].min;
+      leaf_bounds_[i].max += leaf_bounds_[i + 1].max;
+      leaf_bounds_[i].abs += leaf_bounds_[i + 1].abs;
+    }
+    version_ = model.version;
+  }
+
+  /*! \brief the child of split node taken by feats */
+  inline const Node* GetNext(const Node& node, const RegTree::FVec& feats) const {
+    const unsigned fid = node.SplitIndex();
+    bool go_left;
+    if (feats.IsMissing(fid)) {
+      go_left = node.DefaultLeft();
+    } else if (node.IsCategorical()) {
+      go_left = this->InCategories(node, feats.Fvalue(fid));
+    } else {
+      go_left = feats.Fvalue(fid) < node.split_cond;
+    }
+    return nodes_.data() + node.child + (go_left ? 0 : 1);
+  }
+  /*! \brief the leaf of tree reached by feats from root root_id */
+  inline const Node& GetLeaf(size_t tree, unsigned root_id,
+                             const RegTree::FVec& feats) const {
+    const Node* node = nodes_.data() + tree_ptr_[tree] + root_id;
+    while (!node->IsLeaf()) {
+      node = this->GetNext(*node, feats);
+    }
+    return *node;
+  }
+  /*!
+   * \brief add the outputs of trees [tree_begin, tree_end) for feats to psum,
+   *  one value per output group
+   */
+  inline void PredValue(const RegTree::FVec& feats, unsigned root_id,
+                        size_t tree_begin, size_t tree_end, int num_group,
+                        bst_float* psum) const {
+    for (size_t i = tree_begin; i < tree_end; ++i) {
+      const Node& leaf = this->GetLeaf(i, root_id, feats);
+      if (size_leaf_vector_ != 0) {
+        const bst_float* value = leaf_vectors_.data() + leaf.ref;
+        for (int gid = 0; gid < num_group; ++gid) {
+          psum[gid] += value[gid];
+        }
+      } else {
+        psum[tree_info_[i]] += leaf.leaf_value;
+      }
+    }
+  }
+  /*!
+   * \brief decide whether base_margin plus the outputs of scalar trees
+   *  [0, tree_end) for feats exceeds cutoff, stopping as soon as the leaves
+   *  that remain cannot change the answer. The bounds of the remaining sum
+   *  are widened by the largest rounding error of adding it up in float, so
+   *  the decision is always that of the full prediction.
+   * \return the number of trees evaluated
+   */
+  inline size_t PredDecision(const RegTree::FVec& feats, unsigned root_id,
+                             size_t tree_end, bst_float base_margin,
+                             bst_float cutoff, bool* out_decision) const {
+    CHECK_EQ(size_leaf_vector_, 0) << "decisions need scalar trees";
+    const LeafBound& last = leaf_bounds_[tree_end];
+    bst_float psum = 0.0f;
+    for (size_t i = 0; i < tree_end; ++i) {
+      const LeafBound& rest = leaf_bounds_[i];
+      const double margin = static_cast<double>(base_margin) + psum;
+      // every addition left, and the final one of base_margin, rounds once
+      const double slack = static_cast<double>(tree_end - i + 1) *
+          std::numeric_limits<bst_float>::epsilon() *
+          (std::abs(static_cast<double>(base_margin)) + std::abs(psum) + rest.abs - last.abs);
+      if (margin + (rest.min - last.min) - slack > cutoff) {
+        *out_decision = true;
+        return i;
+      }
+      if (margin + (rest.max - last.max) + slack <= cutoff) {
+        *out_decision = false;
+        return i;
+      }
+      psum += this->GetLeaf(i, root_id, feats).leaf_value;
+    }
+    *out_decision = base_margin + psum > cutoff;
+    return tree_end;
+  }
+  /*!
+   * \brief rows predicted together by PredictBlock: enough to reuse each tree
+   *  across many rows while it is in cache, few enough that the feature
+   *  vectors of the block stay in cache as well
+   */
+  inline size_t BlockOfRows(int num_feature) const {
+    // a forest within L2 gains little from more than the smallest block
+    const size_t forest_bytes = nodes_.size() * sizeof(Node);
+    size_t block = forest_bytes <= (256U << 10) ? static_cast<size_t>(kMinBlockOfRows)
+                                                : static_cast<size_t>(kMaxBlockOfRows);
+    const size_t row_bytes = sizeof(bst_float) * std::max(num_feature, 1);
+    while (block > kMinBlockOfRows && block * row_bytes > (256U << 10)) {
+      block /= 2;
+    }
+    return block;
+  }
+  /*!
+   * \brief add the outputs of trees [tree_begin, tree_end) for rows feats[0, n)
+   *  to psum, num_group values per row. Each tree is run over the whole block,
+   *  every row descending one level per pass so the node loads of the rows
+   *  overlap.
+   */
+  inline void PredictBlock(const RegTree::FVec* feats, const unsigned* root_ids,
+                           size_t n, size_t tree_begin, size_t tree_end,
+                           int num_group, bst_float* psum) const {
+    this->PredictBlock(nodes_.data(), root_ids, n, tree_begin, tree_end,
+                       num_group, psum, [&](size_t k, const Node& node) {
+                         return this->GetNext(node, feats[k]);
+                       });
+  }
+
+  /*!
+   * \brief number the distinct thresholds of every feature for traversal over
+   *  bin indices, see FillBins. Must follow Init.
+   * \return bytes per bin, 0 if some feature has too many thresholds
+   */
+  int InitQuantized() {
+    // features used by splits, in order of their index
+    std::vector<unsigned> used;
+    for (const Node& node : nodes_) {
+      if (!node.IsLeaf()) used.push_back(node.SplitIndex());
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    column_.assign(used.empty() ? 0 : used.back() + 1, -1);
+    for (size_t c = 0; c < used.size(); ++c) {
+      column_[used[c]] = static_cast<int>(c);
+    }
+    std::vector<std::vector<bst_float>> thresholds(used.size());
+    category_limit_.assign(used.size(), 0);
+    for (const Node& node : nodes_) {
+      if (node.IsLeaf()) continue;
+      const int c = column_[node.SplitIndex()];
+      if (node.IsCategorical()) {
+        category_limit_[c] = std::max(category_limit_[c], categories_[node.ref] * 32);
+      } else {
+        thresholds[c].push_back(node.split_cond);
+      }
+    }
+    threshold_ptr_.assign(1, 0);
+    thresholds_.clear();
+    size_t max_bin = 0;
+    for (size_t c = 0; c < used.size(); ++c) {
+      std::vector<bst_float>& t = thresholds[c];
+      std::sort(t.begin(), t.end());
+      t.erase(std::unique(t.begin(), t.end()), t.end());
+      thresholds_.insert(thresholds_.end(), t.begin(), t.end());
+      threshold_ptr_.push_back(thresholds_.size());
+      max_bin = std::max(max_bin, std::max(t.size(),
+                                           static_cast<size_t>(category_limit_[c])));
+      if (!t.empty() && category_limit_[c] != 0) {
+        // a feature split both ways has no single kind of bin
+        max_bin = std::numeric_limits<size_t>::max();
+      }
+    }
+    // the largest value of each type marks a missing feature
+    if (max_bin < std::numeric_limits<uint8_t>::max()) {
+      bin_bytes_ = 1;
+    } else if (max_bin < std::numeric_limits<uint16_t>::max()) {
+      bin_bytes_ = 2;
+    } else {
+      bin_bytes_ = 0;
+      qnodes_.clear();
+      return bin_bytes_;
+    }
+    // same nodes, with compact feature indices and threshold numbers
+    qnodes_ = nodes_;
+    for (Node& node : qnodes_) {
+      if (node.IsLeaf()) continue;
+      const int c = column_[node.SplitIndex()];
+      if (!node.IsCategorical()) {
+        const bst_float* beg = thresholds_.data() + threshold_ptr_[c];
+        const bst_float* end = thresholds_.data() + threshold_ptr_[c + 1];
+        node.ref = static_cast<uint32_t>(std::lower_bound(beg, end, node.split_cond) - beg);
+      }
+      node.sindex = (node.sindex & ~kIndexMask) | static_cast<uint32_t>(c);
+    }
+    return bin_bytes_;
+  }
+  /*! \brief bytes per bin of the quantized traversal, 0 if not prepared */
+  inline int QuantizedBinBytes() const { return bin_bytes_; }
+  /*! \brief length of the bin vector of a row */
+  inline size_t NumBinColumns() const { return threshold_ptr_.size() - 1; }
+  /*!
+   * \brief map a row to one bin per feature used by the model: the number of
+   *  its thresholds not above the value, or the category id
+   */
+  template <typename BinT>
+  inline void FillBins(const SparsePage::Inst& inst, BinT* bins) const {
+    const BinT missing = std::numeric_limits<BinT>::max();
+    std::fill(bins, bins + this->NumBinColumns(), missing);
+    for (const auto& e : inst) {
+      if (e.index >= column_.size() || column_[e.index] < 0) continue;
+      const int c = column_[e.index];
+      if (category_limit_[c] != 0) {
+        // ids no node sends left all map to the limit
+        const bst_float limit = static_cast<bst_float>(category_limit_[c]);
+        bins[c] = static_cast<BinT>(e.fvalue >= 0.0f && e.fvalue < limit
+                                    ? static_cast<uint32_t>(e.fvalue)
+                                    : category_limit_[c]);
+      } else {
+        const bst_float* beg = thresholds_.data() + threshold_ptr_[c];
+        const bst_float* end = thresholds_.data() + threshold_ptr_[c + 1];
+        bins[c] = static_cast<BinT>(std::upper_bound(beg, end, e.fvalue) - beg);
+      }
+    }
+  }
+  /*!
+   * \brief PredictBlock over the bins of rows [0, n), stored one row after the
+   *  other by FillBins; gives the same sums as the traversal of the values
+   */
+  template <typename BinT>
+  inline void PredictBlockQuantized(const BinT* bins, const unsigned* root_ids,
+                                    size_t n, size_t tree_begin, size_t tree_end,
+                                    int num_group, bst_float* psum) const {
+    const size_t stride = this->NumBinColumns();
+    const BinT missing = std::numeric_limits<BinT>::max();
+    const Node* qnodes = qnodes_.data();
+    this->PredictBlock(qnodes, root_ids, n, tree_begin, tree_end, num_group, psum,
+                       [&](size_t k, const Node& node) {
+                         const BinT bin = bins[k * stride + node.SplitIndex()];
+                         bool go_left;
+                         if (bin == missing) {
+                           go_left = node.DefaultLeft();
+                         } else if (node.IsCategorical()) {
+                           go_left = this->InCategoryBin(node, bin);
+                         } else {
+                           go_left = bin <= node.ref;
+                         }
+                         return qnodes + node.child + (go_left ? 0 : 1);
+                       });
+  }
+  /*! \brief depth of the deepest leaf of tree, from any of its roots */
+  inline int TreeDepth(size_t tree) const { return tree_depth_[tree]; }
+  /*! \brief id of the leaf in the RegTree */
+  inline int LeafIndex(size_t tree, unsigned root_id,
+                       const RegTree::FVec& feats) const {
+    return static_cast<int>(this->GetLeaf(tree, root_id, feats).child);
+  }
+
+ private:
+  // run each tree over rows [0, n), next(k, node) gives the child row k takes
+  template <typename NextFn>
+  inline void PredictBlock(const Node* nodes, const unsigned* root_ids,
+                           size_t n, size_t tree_begin, size_t tree_end,
+                           int num_group, bst_float* psum, NextFn next) const {
+    CHECK_LE(n, static_cast<size_t>(kMaxBlockOfRows));
+    const Node* node[kMaxBlockOfRows];
+    for (size_t i = tree_begin; i < tree_end; ++i) {
+      const Node* root = nodes + tree_ptr_[i];
+      for (size_t k = 0; k < n; ++k) {
+        node[k] = root + root_ids[k];
+      }
+      for (bool active = true; active;) {
+        active = false;
+        for (size_t k = 0; k < n; ++k) {
+          if (!node[k]->IsLeaf()) {
+            node[k] = next(k, *node[k]);
+            active = true;
+          }
+        }
+      }
+      if (size_leaf_vector_ != 0) {
+        for (size_t k = 0; k < n; ++k) {
+          const bst_float* value = leaf_vectors_.data() + node[k]->ref;
+          for (int gid = 0; gid < num_group; ++gid) {
+            psum[k * num_group + gid] += value[gid];
+          }
+        }
+      } else {
+        const int gid = tree_info_[i];
+        for (size_t k = 0; k < n; ++k) {
+          psum[k * num_group + gid] += node[k]->leaf_value;
+        }
+      }
+    }
+  }
+  // smallest, largest and largest absolute leaf value of a tree
+  struct LeafBound {
+    double min;
+    double max;
+    double abs;
+  };
+  // whether category id cat goes left at categorical node
+  inline bool InCategoryBin(const Node& node, uint32_t cat) const {
+    const uint32_t* words = categories_.data() + node.ref;
+    if (cat / 32 >= words[0]) return false;
+    return (words[1 + cat / 32] >> (cat % 32)) & 1U;
+  }
+  // stored as the number of words followed by the words
+  void PushCategories(const std::vector<uint32_t>& cats) {
+    const uint32_t nwords = cats.empty() ? 1 : cats.back() / 32 + 1;
+    const size_t beg = categories_.size();
+    categories_.resize(beg + 1 + nwords, 0U);
+    categories_[beg] = nwords;
+    for (uint32_t cat : cats) {
+      categories_[beg + 1 + cat / 32] |= 1U << (cat % 32);
+    }
+  }
+  // same rule as RegTree::InCategories
+  inline bool InCategories(const Node& node, bst_float fvalue) const {
+    if (!(fvalue >= 0.0f)) return false;
+    return this->InCategoryBin(node, static_cast<uint32_t>(fvalue));
+  }
+
+  std::vector<Node> nodes_;
+  // nodes_ of tree i are [tree_ptr_[i], tree_ptr_[i + 1])
+  std::vector<size_t> tree_ptr_;
+  std::vector<int> tree_info_;
+  std::vector<int> tree_depth_;
+  std::vector<uint32_t> categories_;
+  std::vector<bst_float> leaf_vectors_;
+  // of scalar trees, summed over trees [i, end) at i
+  std::vector<LeafBound> leaf_bounds_;
+  int size_leaf_vector_ {0};
+  uint64_t version_ {0};
+  // quantized traversal: column of each feature in the bin vector or -1,
+  // sorted thresholds of each column, bitset bound of categorical columns
+  std::vector<int> column_;
+  std::vector<size_t> threshold_ptr_ {0};
+  std::vector<bst_float> thresholds_;
+  std::vector<uint32_t> category_limit_;
+  std::vector<Node> qnodes_;
+  int bin_bytes_ {0};
+};
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_FLAT_FOREST_H_
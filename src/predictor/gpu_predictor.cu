@@ -479,6 +479,23 @@ class GPUPredictor : public xgboost::Predictor {
                        unsigned root_index) override {
     cpu_predictor_->PredictInstance(inst, out_preds, model, root_index);
   }
+  void PredictRows(const ExternalRows& rows, bst_float* out_preds,
+                   const gbm::GBTreeModel& model,
+                   unsigned ntree_limit) override {
+    cpu_predictor_->PredictRows(rows, out_preds, model, ntree_limit);
+  }
+  void PredictRow(const ExternalRows& row, bst_float* out_preds,
+                  const gbm::GBTreeModel& model,
+                  unsigned ntree_limit) override {
+    cpu_predictor_->PredictRow(row, out_preds, model, ntree_limit);
+  }
+  void PredictDecision(const ExternalRows& rows, bst_float cutoff,
+                       uint8_t* out_decision, unsigned* out_ntree,
+                       const gbm::GBTreeModel& model,
+                       unsigned ntree_limit) override {
+    cpu_predictor_->PredictDecision(rows, cutoff, out_decision, out_ntree,
+                                    model, ntree_limit);
+  }
   void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
                    const gbm::GBTreeModel& model,
                    unsigned ntree_limit) override {
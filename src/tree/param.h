@@ -33,6 +33,8 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   int max_bin;
   // growing policy
   enum TreeGrowPolicy { kDepthWise = 0, kLossGuide = 1 };
+  enum HistSyncPrecision { kSyncDouble = 0, kSyncFloat = 1, kSyncInt = 2 };
+  enum HistBuildMethod { kHistBuildAuto = 0, kHistBuildRowWise = 1, kHistBuildColumnWise = 2 };
   int grow_policy;
 
   //----- the rest parameters are less important ----
@@ -62,6 +64,8 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   float sketch_eps;
   // accuracy of sketch
   float sketch_ratio;
+  // number of trees that share one set of candidate splits in the approx updater
+  int sketch_reuse_rounds;
   // leaf vector size
   int size_leaf_vector;
   // option for parallelization
@@ -85,15 +89,26 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   double sparse_threshold;
   // use feature grouping? (default yes)
   int enable_feature_grouping;
-  // when grouping features, how many "conflicts" to allow.
+  // when grouping or bundling features, how many "conflicts" to allow.
   // conflict is when an instance has nonzero values for two or more features
   // default is 0, meaning features should be strictly complementary
   double max_conflict_rate;
-  // when grouping features, how much effort to expend to prevent singleton groups
+  // when grouping or bundling features, how much effort to expend to prevent singleton groups
   // we'll try to insert each feature into existing groups before creating a new group
   // for that feature; to save time, only up to (max_search_group) of existing groups
   // will be considered. If set to zero, ALL existing groups will be examined
   unsigned max_search_group;
+  // bundle features that are rarely off their default (missing, or else their
+  // most frequent bin) in the same row, histograms only hold their other bins
+  int enable_feature_bundling;
+  // draw the row subsample with replacement, encoding the multiplicity of
+  // each row as an integer weight on its gradient
+  bool bootstrap;
+  // encoding of the histograms exchanged between workers in distributed
+  // hist training, see HistSyncPrecision
+  int hist_sync_precision;
+  // how node histograms are built in hist training, see HistBuildMethod
+  int hist_build_method;
 
   // declare the parameters
   DMLC_DECLARE_PARAMETER(TrainParam) {
@@ -175,6 +190,12 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
         .set_lower_bound(0.0f)
         .set_default(2.0f)
         .describe("EXP Param: Sketch accuracy related parameter of approximate algorithm.");
+    DMLC_DECLARE_FIELD(sketch_reuse_rounds)
+        .set_lower_bound(1)
+        .set_default(1)
+        .describe("Number of consecutive trees that reuse the candidate splits "
+                  "proposed by the global approximate algorithm, saving the "
+                  "sketching pass over the data for all but the first one.");
     DMLC_DECLARE_FIELD(size_leaf_vector)
         .set_lower_bound(0)
         .set_default(0)
@@ -210,15 +231,41 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
         .describe("if >0, enable feature grouping to ameliorate work imbalance "
                   "among worker threads");
     DMLC_DECLARE_FIELD(max_conflict_rate).set_range(0, 1.0).set_default(0)
-        .describe("when grouping features, how many \"conflicts\" to allow."
+        .describe("when grouping or bundling features, how many \"conflicts\" to allow."
        "conflict is when an instance has nonzero values for two or more features."
        "default is 0, meaning features should be strictly complementary.");
     DMLC_DECLARE_FIELD(max_search_group).set_lower_bound(0).set_default(100)
-        .describe("when grouping features, how much effort to expend to prevent "
+        .describe("when grouping or bundling features, how much effort to expend to prevent "
                   "singleton groups. We'll try to insert each feature into existing "
                   "groups before creating a new group for that feature; to save time, "
                   "only up to (max_search_group) of existing groups will be "
                   "considered. If set to zero, ALL existing groups will be examined.");
+    DMLC_DECLARE_FIELD(enable_feature_bundling).set_lower_bound(0).set_default(0)
+        .describe("if >0, bundle features that are rarely off their default value "
+                  "(missing, or else their most frequent bin) in the same row, e.g. "
+                  "one-hot columns, up to max_conflict_rate conflicting rows per "
+                  "bundle. The histograms only hold the bins off the defaults. "
+                  "Ignored in distributed training.");
+    DMLC_DECLARE_FIELD(bootstrap).set_default(false)
+        .describe("if true, sample rows with replacement: each row is drawn "
+                  "Poisson(subsample) times and its gradient is scaled by the "
+                  "number of draws.");
+    DMLC_DECLARE_FIELD(hist_sync_precision)
+        .set_default(kSyncDouble)
+        .add_enum("double", kSyncDouble)
+        .add_enum("float", kSyncFloat)
+        .add_enum("int", kSyncInt)
+        .describe("Encoding of the histograms allreduced in distributed hist "
+                  "training. 'float' and 'int' halve the traffic; 'int' is "
+                  "scaled per node.");
+    DMLC_DECLARE_FIELD(hist_build_method)
+        .set_default(kHistBuildAuto)
+        .add_enum("auto", kHistBuildAuto)
+        .add_enum("rowwise", kHistBuildRowWise)
+        .add_enum("colwise", kHistBuildColumnWise)
+        .describe("How node histograms are built in hist training: over blocks "
+                  "of rows with one private histogram per thread, over features "
+                  "straight into the node histogram, or chosen per node.");
 
     // add alias of parameters
     DMLC_DECLARE_ALIAS(reg_lambda, lambda);
@@ -9,6 +9,7 @@
 #include <cmath>
 #include <iomanip>
 #include "./param.h"
+#include "../common/common.h"
 
 namespace xgboost {
 // register tree parameter
@@ -40,15 +41,28 @@ void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
     }
   }
   if (tree[nid].IsLeaf()) {
+    // a vector tree lists one value per output group
+    std::stringstream leaf;
+    leaf << std::setprecision(float_max_precision);
+    if (tree.param.size_leaf_vector != 0) {
+      const bst_float* value = tree.LeafVector(nid);
+      leaf << '[';
+      for (int i = 0; i < tree.param.size_leaf_vector; ++i) {
+        leaf << (i == 0 ? "" : ",") << value[i];
+      }
+      leaf << ']';
+    } else {
+      leaf << tree[nid].LeafValue();
+    }
     if (format == "json") {
       fo << "{ \"nodeid\": " << nid
-         << ", \"leaf\": " << std::setprecision(float_max_precision) << tree[nid].LeafValue();
+         << ", \"leaf\": " << leaf.str();
       if (with_stats) {
         fo << ", \"cover\": " << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
       }
       fo << " }";
     } else {
-      fo << nid << ":leaf=" << std::setprecision(float_max_precision) << tree[nid].LeafValue();
+      fo << nid << ":leaf=" << leaf.str();
       if (with_stats) {
         fo << ",cover=" << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
       }
@@ -58,7 +72,42 @@ void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
     // right then left,
     bst_float cond = tree[nid].SplitCond();
     const unsigned split_index = tree[nid].SplitIndex();
-    if (split_index < fmap.Size()) {
+    if (tree.IsCategorical(nid)) {
+      // categorical split, the listed categories go to yes
+      const std::vector<uint32_t> cats = tree.NodeCategories(nid);
+      std::stringstream name;
+      if (split_index < fmap.Size()) {
+        name << fmap.Name(split_index);
+      } else {
+        name << 'f' << split_index;
+      }
+      if (format == "json") {
+        fo << "{ \"nodeid\": " << nid
+           << ", \"depth\": " << depth
+           << ", \"split\": ";
+        if (split_index < fmap.Size()) {
+          fo << '"' << name.str() << '"';
+        } else {
+          fo << split_index;
+        }
+        fo << ", \"split_categories\": [";
+        for (size_t i = 0; i < cats.size(); ++i) {
+          fo << (i == 0 ? "" : ", ") << cats[i];
+        }
+        fo << "]"
+           << ", \"yes\": " << tree[nid].LeftChild()
+           << ", \"no\": " << tree[nid].RightChild()
+           << ", \"missing\": " << tree[nid].DefaultChild();
+      } else {
+        fo << nid << ":[" << name.str() << ":{";
+        for (size_t i = 0; i < cats.size(); ++i) {
+          fo << (i == 0 ? "" : ",") << cats[i];
+        }
+        fo << "}] yes=" << tree[nid].LeftChild()
+           << ",no=" << tree[nid].RightChild()
+           << ",missing=" << tree[nid].DefaultChild();
+      }
+    } else if (split_index < fmap.Size()) {
       switch (fmap.type(split_index)) {
         case FeatureMap::kIndicator: {
           int nyes = tree[nid].DefaultLeft() ?
@@ -169,6 +218,70 @@ std::string RegTree::DumpModel(const FeatureMap& fmap,
   }
   return fo.str();
 }
+std::string RegTree::CompileModel(const std::string& name, int group) const {
+  std::ostringstream fo;
+  std::ostringstream cats;
+  size_t ncats = 0;
+  bool has_categorical = false;
+  const std::string cats_name = name + "Categories";
+  fo << "void " << name << "(const float* fvalue, float* psum) {\n";
+  // preorder, so a left child follows its parent and only right children
+  // are jumped to; the same rules as RegTree::GetNext decide the branch
+  std::vector<int> stack {0};
+  while (!stack.empty()) {
+    const int nid = stack.back();
+    stack.pop_back();
+    if (nid != 0 && !(*this)[nid].IsLeftChild()) {
+      fo << " n" << nid << ":\n";
+    }
+    const Node& node = (*this)[nid];
+    if (node.IsLeaf()) {
+      if (param.size_leaf_vector != 0) {
+        const bst_float* value = this->LeafVector(nid);
+        for (int i = 0; i < param.size_leaf_vector; ++i) {
+          fo << "  psum[" << i << "] += " << common::ToFloatLiteral(value[i]) << ";\n";
+        }
+      } else {
+        fo << "  psum[" << group << "] += " << common::ToFloatLiteral(node.LeafValue())
+           << ";\n";
+      }
+      fo << "  return;\n";
+      continue;
+    }
+    const std::string f = "fvalue[" + common::ToString(node.SplitIndex()) + "]";
+    if (this->IsCategorical(nid)) {
+      has_categorical = true;
+      const std::vector<uint32_t> node_cats = this->NodeCategories(nid);
+      const std::string in_cats = "InCategories(" + f + ", " + cats_name + " + " +
+          common::ToString(ncats) + ", " + cats_name + " + " +
+          common::ToString(ncats + node_cats.size()) + ")";
+      for (uint32_t cat : node_cats) {
+        cats << (ncats++ == 0 ? "" : ", ") << cat;
+      }
+      if (node.DefaultLeft()) {
+        fo << "  if (!std::isnan(" << f << ") && !" << in_cats << ")";
+      } else {
+        fo << "  if (std::isnan(" << f << ") || !" << in_cats << ")";
+      }
+    } else if (node.DefaultLeft()) {
+      // NaN compares false, so missing values stay left
+      fo << "  if (" << f << " >= " << common::ToFloatLiteral(node.SplitCond()) << ")";
+    } else {
+      fo << "  if (!(" << f << " < " << common::ToFloatLiteral(node.SplitCond()) << "))";
+    }
+    fo << " goto n" << node.RightChild() << ";\n";
+    stack.push_back(node.RightChild());
+    stack.push_back(node.LeftChild());
+  }
+  fo << "}\n";
+  if (!has_categorical) {
+    return fo.str();
+  }
+  // an array may not be empty, even when no node sends any category left
+  return "const uint32_t " + cats_name + "[] = {" + (ncats == 0 ? "0" : cats.str()) +
+      "};\n" + fo.str();
+}
+
 void RegTree::FillNodeMeanValues() {
   size_t num_nodes = this->param.num_nodes;
   if (this->node_mean_values_.size() == num_nodes) {
@@ -221,20 +334,6 @@ void RegTree::CalculateContributionsApprox(const RegTree::FVec &feat,
   out_contribs[split_index] += leaf_value - node_value;
 }
 
-// Used by TreeShap
-// data we keep about our decision path
-// note that pweight is included for convenience and is not tied with the other attributes
-// the pweight of the i'th path element is the permuation weight of paths with i-1 ones in them
-struct PathElement {
-  int feature_index;
-  bst_float zero_fraction;
-  bst_float one_fraction;
-  bst_float pweight;
-  PathElement() = default;
-  PathElement(int i, bst_float z, bst_float o, bst_float w) :
-    feature_index(i), zero_fraction(z), one_fraction(o), pweight(w) {}
-};
-
 // extend our decision path with a fraction of one and zero extensions
 void ExtendPath(PathElement *unique_path, unsigned unique_depth,
                 bst_float zero_fraction, bst_float one_fraction,
@@ -339,14 +438,9 @@ void RegTree::TreeShap(const RegTree::FVec &feat, bst_float *phi,
   // internal node
   } else {
     // find which branch is "hot" (meaning x would follow it)
-    unsigned hot_index = 0;
-    if (feat.IsMissing(split_index)) {
-      hot_index = node.DefaultChild();
-    } else if (feat.Fvalue(split_index) < node.SplitCond()) {
-      hot_index = node.LeftChild();
-    } else {
-      hot_index = node.RightChild();
-    }
+    const auto hot_index = static_cast<unsigned>(
+        this->GetNext(node_index, feat.Fvalue(split_index),
+                      feat.IsMissing(split_index)));
     const unsigned cold_index = (static_cast<int>(hot_index) == node.LeftChild() ?
                                  node.RightChild() : node.LeftChild());
     const bst_float w = this->Stat(node_index).sum_hess;
@@ -394,18 +488,25 @@ void RegTree::CalculateContributions(const RegTree::FVec &feat,
                                      unsigned root_id, bst_float *out_contribs,
                                      int condition,
                                      unsigned condition_feature) const {
+  // Preallocate space for the unique path data
+  std::vector<PathElement> unique_path_data(
+      ShapPathSize(this->MaxDepth(static_cast<int>(root_id))));
+  this->CalculateContributions(feat, root_id, out_contribs, condition,
+                               condition_feature, unique_path_data.data());
+}
+
+void RegTree::CalculateContributions(const RegTree::FVec &feat,
+                                     unsigned root_id, bst_float *out_contribs,
+                                     int condition,
+                                     unsigned condition_feature,
+                                     PathElement* unique_path_data) const {
   // find the expected value of the tree's predictions
   if (condition == 0) {
     bst_float node_value = this->node_mean_values_[static_cast<int>(root_id)];
     out_contribs[feat.Size()] += node_value;
   }
 
-  // Preallocate space for the unique path data
-  const int maxd = this->MaxDepth(root_id) + 2;
-  auto *unique_path_data = new PathElement[(maxd * (maxd + 1)) / 2];
-
   TreeShap(feat, out_contribs, root_id, 0, unique_path_data,
            1, 1, -1, condition, condition_feature, 1);
-  delete[] unique_path_data;
 }
 }  // namespace xgboost
@@ -79,6 +79,14 @@ class ColMaker: public TreeUpdater {
     // constructor
     NodeEntry() : root_gain{0.0f}, weight{0.0f} {}
   };
+  /*!
+   * \brief gradient and encoded position of an instance, kept side by side
+   *  so that a column scan loads one cache line per entry instead of two
+   */
+  struct alignas(16) RowState {
+    GradientPair gpair;
+    int position;
+  };
   // actual builder that runs the algorithm
   class Builder {
    public:
@@ -242,8 +250,7 @@ class ColMaker: public TreeUpdater {
     // this function does not support nested functions
     inline void ParallelFindSplit(const SparsePage::Inst &col,
                                   bst_uint fid,
-                                 DMatrix *p_fmat,
-                                  const std::vector<GradientPair> &gpair) {
+                                  DMatrix *p_fmat) {
       // TODO(tqchen): double check stats order.
       const bool ind = col.size() != 0 && col[0].fvalue == col[col.size() - 1].fvalue;
       bool need_forward = param_.NeedForwardSearch(p_fmat->GetColDensity(fid), ind);
@@ -260,14 +267,14 @@ class ColMaker: public TreeUpdater {
         bst_uint step = (col.size() + this->nthread_ - 1) / this->nthread_;
         bst_uint end = std::min(static_cast<bst_uint>(col.size()), step * (tid + 1));
         for (bst_uint i = tid * step; i < end; ++i) {
-          const bst_uint ridx = col[i].index;
-          const int nid = position_[ridx];
+          const RowState &row = row_state_[col[i].index];
+          const int nid = row.position;
           if (nid < 0) continue;
           const bst_float fvalue = col[i].fvalue;
           if (temp[nid].stats.Empty()) {
             temp[nid].first_fvalue = fvalue;
           }
-          temp[nid].stats.Add(gpair[ridx]);
+          temp[nid].stats.Add(row.gpair);
           temp[nid].last_fvalue = fvalue;
         }
       }
@@ -342,14 +349,14 @@ class ColMaker: public TreeUpdater {
         bst_uint step = (col.size() + this->nthread_ - 1) / this->nthread_;
         bst_uint end = std::min(static_cast<bst_uint>(col.size()), step * (tid + 1));
         for (bst_uint i = tid * step; i < end; ++i) {
-          const bst_uint ridx = col[i].index;
-          const int nid = position_[ridx];
+          const RowState &row = row_state_[col[i].index];
+          const int nid = row.position;
           if (nid < 0) continue;
           const bst_float fvalue = col[i].fvalue;
           // get the statistics of nid
           ThreadEntry &e = temp[nid];
           if (e.stats.Empty()) {
-            e.stats.Add(gpair[ridx]);
+            e.stats.Add(row.gpair);
             e.first_fvalue = fvalue;
           } else {
             // forward default right
@@ -377,7 +384,7 @@ class ColMaker: public TreeUpdater {
                 }
               }
             }
-            e.stats.Add(gpair[ridx]);
+            e.stats.Add(row.gpair);
             e.first_fvalue = fvalue;
           }
         }
@@ -425,7 +432,6 @@ class ColMaker: public TreeUpdater {
                                        const Entry *end,
                                        int d_step,
                                        bst_uint fid,
-                                       const std::vector<GradientPair> &gpair,
                                        std::vector<ThreadEntry> &temp) { // NOLINT(*)
       const std::vector<int> &qexpand = qexpand_;
       // clear all the temp statistics
@@ -434,10 +440,10 @@ class ColMaker: public TreeUpdater {
       }
       // left statistics
       GradStats c;
-      // local cache buffer for position and gradient pair
-      constexpr int kBuffer = 32;
-      int buf_position[kBuffer] = {};
-      GradientPair buf_gpair[kBuffer] = {};
+      // local cache buffer for position and gradient pair, filled by
+      // independent loads so that their cache misses overlap
+      constexpr int kBuffer = 64;
+      RowState buf[kBuffer];
       // aligned ending position
       const Entry *align_end;
       if (d_step > 0) {
@@ -452,26 +458,24 @@ class ColMaker: public TreeUpdater {
       for (it = begin; it != align_end; it += align_step) {
         const Entry *p;
         for (i = 0, p = it; i < kBuffer; ++i, p += d_step) {
-          buf_position[i] = position_[p->index];
-          buf_gpair[i] = gpair[p->index];
+          buf[i] = row_state_[p->index];
         }
         for (i = 0, p = it; i < kBuffer; ++i, p += d_step) {
-          const int nid = buf_position[i];
+          const int nid = buf[i].position;
           if (nid < 0) continue;
-          this->UpdateEnumeration(nid, buf_gpair[i],
+          this->UpdateEnumeration(nid, buf[i].gpair,
                                   p->fvalue, d_step,
                                   fid, c, temp);
         }
       }
       // finish up the ending piece
       for (it = align_end, i = 0; it != end; ++i, it += d_step) {
-        buf_position[i] = position_[it->index];
-        buf_gpair[i] = gpair[it->index];
+        buf[i] = row_state_[it->index];
       }
       for (it = align_end, i = 0; it != end; ++i, it += d_step) {
-        const int nid = buf_position[i];
+        const int nid = buf[i].position;
         if (nid < 0) continue;
-        this->UpdateEnumeration(nid, buf_gpair[i],
+        this->UpdateEnumeration(nid, buf[i].gpair,
                                 it->fvalue, d_step,
                                 fid, c, temp);
       }
@@ -511,7 +515,7 @@ class ColMaker: public TreeUpdater {
                                std::vector<ThreadEntry> &temp) { // NOLINT(*)
       // use cacheline aware optimization
       if (param_.cache_opt != 0) {
-        EnumerateSplitCacheOpt(begin, end, d_step, fid, gpair, temp);
+        EnumerateSplitCacheOpt(begin, end, d_step, fid, temp);
         return;
       }
       const std::vector<int> &qexpand = qexpand_;
@@ -620,8 +624,7 @@ class ColMaker: public TreeUpdater {
         }
       } else {
         for (bst_omp_uint fid = 0; fid < num_features; ++fid) {
-          this->ParallelFindSplit(batch[fid], fid,
-                                  p_fmat, gpair);
+          this->ParallelFindSplit(batch[fid], fid, p_fmat);
         }
       }
     }
@@ -632,6 +635,7 @@ class ColMaker: public TreeUpdater {
                           DMatrix *p_fmat,
                           RegTree *p_tree) {
       auto feat_set = column_sampler_.GetFeatureSet(depth);
+      this->InitRowState(gpair);
       for (const auto &batch : p_fmat->GetSortedColumnBatches()) {
         this->UpdateSolution(batch, feat_set->HostVector(), gpair, p_fmat);
       }
@@ -657,6 +661,16 @@ class ColMaker: public TreeUpdater {
         }
       }
     }
+    // gather gradient and position of each instance for the scans of a level
+    inline void InitRowState(const std::vector<GradientPair> &gpair) {
+      const auto ndata = static_cast<bst_omp_uint>(position_.size());
+      row_state_.resize(ndata);
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint ridx = 0; ridx < ndata; ++ridx) {
+        row_state_[ridx].gpair = gpair[ridx];
+        row_state_[ridx].position = position_[ridx];
+      }
+    }
     // reset position of each data points after split is created in the tree
     inline void ResetPosition(const std::vector<int> &qexpand,
                               DMatrix* p_fmat,
@@ -753,6 +767,8 @@ class ColMaker: public TreeUpdater {
     common::ColumnSampler column_sampler_;
     // Instance Data: current node position in the tree of each instance
     std::vector<int> position_;
+    // Instance Data: gradient and position, refreshed before each level's scans
+    std::vector<RowState> row_state_;
     // PerThread x PerTreeNode: statistics for per thread construction
     std::vector< std::vector<ThreadEntry> > stemp_;
     /*! \brief TreeNode Data: statistics for each constructed node */
@@ -642,15 +642,25 @@ class GlobalProposalHistMaker: public CQHistMaker {
                           DMatrix *p_fmat,
                           const std::vector<bst_uint> &fset,
                           const RegTree &tree) override {
+    // only the proposal of the root, over all rows, is kept across trees;
+    // deeper levels with a single node propose again as before
+    const bool is_root = this->qexpand_.size() == 1 && tree[this->qexpand_[0]].IsRoot();
     if (this->qexpand_.size() == 1) {
       cached_rptr_.clear();
       cached_cut_.clear();
+      if (is_root) {
+        this->ReuseProposal(p_fmat, fset);
+        ++num_trees_;
+      }
     }
     if (cached_rptr_.size() == 0) {
       CHECK_EQ(this->qexpand_.size(), 1U);
       CQHistMaker::ResetPosAndPropose(gpair, p_fmat, fset, tree);
       cached_rptr_ = this->wspace_.rptr;
       cached_cut_ = this->wspace_.cut;
+      if (is_root) {
+        this->SaveProposal(fset);
+      }
     } else {
       this->wspace_.cut.clear();
       this->wspace_.rptr.clear();
@@ -668,6 +678,47 @@ class GlobalProposalHistMaker: public CQHistMaker {
     }
   }
 
+  // fill cached_rptr_ and cached_cut_ from the cuts of earlier trees, if all
+  // features of fset were proposed within the last sketch_reuse_rounds trees
+  inline void ReuseProposal(DMatrix *p_fmat, const std::vector<bst_uint> &fset) {
+    const MetaInfo &info = p_fmat->Info();
+    if (p_fmat != proposal_fmat_ || info.num_row_ != proposal_num_row_) {
+      feature_cuts_.clear();
+      feature_round_.clear();
+      proposal_fmat_ = p_fmat;
+      proposal_num_row_ = info.num_row_;
+    }
+    for (bst_uint fid : fset) {
+      if (fid >= feature_round_.size() || feature_round_[fid] < 0 ||
+          num_trees_ - feature_round_[fid] >= this->param_.sketch_reuse_rounds) {
+        return;
+      }
+    }
+    cached_rptr_.push_back(0);
+    for (bst_uint fid : fset) {
+      cached_cut_.insert(cached_cut_.end(), feature_cuts_[fid].begin(),
+                         feature_cuts_[fid].end());
+      cached_rptr_.push_back(static_cast<unsigned>(cached_cut_.size()));
+    }
+    // reserve last value for global statistics
+    cached_cut_.push_back(0.0f);
+    cached_rptr_.push_back(static_cast<unsigned>(cached_cut_.size()));
+  }
+  // remember the cuts of each feature of a fresh proposal
+  inline void SaveProposal(const std::vector<bst_uint> &fset) {
+    if (this->param_.sketch_reuse_rounds <= 1) return;
+    for (size_t j = 0; j < fset.size(); ++j) {
+      const bst_uint fid = fset[j];
+      if (fid >= feature_cuts_.size()) {
+        feature_cuts_.resize(fid + 1);
+        feature_round_.resize(fid + 1, -1);
+      }
+      feature_cuts_[fid].assign(cached_cut_.begin() + cached_rptr_[j],
+                                cached_cut_.begin() + cached_rptr_[j + 1]);
+      feature_round_[fid] = num_trees_ - 1;
+    }
+  }
+
   // code to create histogram
   void CreateHist(const std::vector<GradientPair> &gpair,
                   DMatrix *p_fmat,
@@ -731,6 +782,15 @@ class GlobalProposalHistMaker: public CQHistMaker {
   std::vector<unsigned> cached_rptr_;
   // cached cut value.
   std::vector<bst_float> cached_cut_;
+  // number of trees started by this updater
+  int num_trees_{0};
+  // candidate cuts of each feature from its last proposal
+  std::vector<std::vector<bst_float> > feature_cuts_;
+  // tree (counted by num_trees_) of the last proposal of each feature, -1 if none
+  std::vector<int> feature_round_;
+  // data matrix the proposals were made on
+  const DMatrix* proposal_fmat_{nullptr};
+  uint64_t proposal_num_row_{0};
 };
 
 XGBOOST_REGISTER_TREE_UPDATER(LocalHistMaker, "grow_local_histmaker")
@@ -10,11 +10,13 @@
 #include <xgboost/tree_updater.h>
 
 #include <cmath>
+#include <exception>
 #include <memory>
 #include <vector>
 #include <algorithm>
 #include <queue>
 #include <iomanip>
+#include <limits>
 #include <numeric>
 #include <string>
 #include <utility>
@@ -40,6 +42,8 @@ void QuantileHistMaker::Init(const std::vector<std::pair<std::string, std::strin
   pruner_->Init(args);
   param_.InitAllowUnknown(args);
   is_gmat_initialized_ = false;
+  // keep the configuration around, additional pruners are created on demand
+  cfg_ = args;
 
   // initialise the split evaluator
   if (!spliteval_) {
@@ -49,51 +53,469 @@ void QuantileHistMaker::Init(const std::vector<std::pair<std::string, std::strin
   spliteval_->Init(args);
 }
 
+namespace {
+// one seed per tree, drawn from the random engine of the calling thread
+std::vector<uint32_t> DrawTreeSeeds(size_t ntree) {
+  std::vector<uint32_t> seeds(ntree);
+  for (auto& seed : seeds) {
+    seed = static_cast<uint32_t>(common::GlobalRandom()());
+  }
+  return seeds;
+}
+
+// saves the random engine of the current thread and restores it on scope
+// exit, also when an exception leaves the scope
+class RandomStateGuard {
+ public:
+  RandomStateGuard() : saved_(common::GlobalRandom()) {}
+  RandomStateGuard(const RandomStateGuard&) = delete;
+  RandomStateGuard& operator=(const RandomStateGuard&) = delete;
+  ~RandomStateGuard() { common::GlobalRandom() = saved_; }
+
+ private:
+  const common::GlobalRandomEngine saved_;
+};
+
+// re-seeds the random engine of the current thread for one tree
+class TreeSeedGuard : public RandomStateGuard {
+ public:
+  explicit TreeSeedGuard(uint32_t seed) {
+    common::GlobalRandom().seed(seed);
+  }
+};
+}  // anonymous namespace
+
 void QuantileHistMaker::Update(HostDeviceVector<GradientPair> *gpair,
                                DMatrix *dmat,
                                const std::vector<RegTree *> &trees) {
   if (is_gmat_initialized_ == false) {
     double tstart = dmlc::GetTime();
     gmat_.Init(dmat, static_cast<uint32_t>(param_.max_bin));
+    if (param_.enable_feature_bundling > 0) {
+      // the histograms of all workers must share the bins
+      if (rabit::IsDistributed()) {
+        LOG(WARNING) << "enable_feature_bundling is ignored in distributed training";
+      } else {
+        gmat_.BundleFeatures(param_);
+      }
+    }
     column_matrix_.Init(gmat_, param_.sparse_threshold);
     if (param_.enable_feature_grouping > 0) {
       gmatb_.Init(gmat_, column_matrix_, param_);
     }
+    feature_types_ = dmat->Info().feature_types_;
+    eval_rows_.clear();
     is_gmat_initialized_ = true;
     LOG(INFO) << "Generating gmat: " << dmlc::GetTime() - tstart << " sec";
   }
+  ++num_updates_;
+  for (auto it = eval_rows_.begin(); it != eval_rows_.end();) {
+    if (it->second.last_update + 1 < num_updates_) {
+      it = eval_rows_.erase(it);
+    } else {
+      ++it;
+    }
+  }
   // rescale learning rate according to size of trees
   float lr = param_.learning_rate;
   param_.learning_rate = lr / trees.size();
   // build tree
-  if (!builder_) {
-    builder_.reset(new Builder(
+  const int nthread = omp_get_max_threads();
+  bool concurrent = trees.size() > 1 && nthread > 1 && !rabit::IsDistributed();
+#if XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+  // the custom engine cannot be re-seeded per tree
+  concurrent = false;
+#endif  // XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+  const bool multi_output = trees.front()->param.size_leaf_vector != 0;
+  const size_t nbuilder = multi_output ? 0 : (concurrent ? trees.size() : 1);
+  // with several trees, one seed per tree is drawn before anything else so
+  // that neither the row subsampling nor later rounds depend on which path
+  // grows the trees. A single tree draws from the engine as it always did.
+  const std::vector<uint32_t> seeds = multi_output || trees.size() == 1
+      ? std::vector<uint32_t>() : DrawTreeSeeds(trees.size());
+  {
+#if !XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+    // the concurrent path creates more builders, which draw from the random
+    // engine as well
+    std::unique_ptr<RandomStateGuard> guard;
+    if (concurrent) {
+      guard.reset(new RandomStateGuard());
+    }
+#endif  // !XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+    while (builders_.size() < nbuilder) {
+      std::unique_ptr<TreeUpdater> pruner;
+      if (pruner_) {
+        pruner = std::move(pruner_);
+      } else {
+        pruner.reset(TreeUpdater::Create("prune"));
+        pruner->Init(cfg_);
+      }
+      builders_.emplace_back(new Builder(
+          param_,
+          std::move(pruner),
+          std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+    }
+  }
+  if (multi_output && !multi_builder_) {
+    std::unique_ptr<TreeUpdater> pruner(TreeUpdater::Create("prune"));
+    pruner->Init(cfg_);
+    multi_builder_.reset(new MultiOutputBuilder(
         param_,
-        std::move(pruner_),
+        std::move(pruner),
         std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
   }
-  for (auto tree : trees) {
-    builder_->Update(gmat_, gmatb_, column_matrix_, gpair, dmat, tree);
+  if (multi_output) {
+    // one vector tree serves all output groups
+    for (auto tree : trees) {
+      multi_builder_->Update(gmat_, column_matrix_, gpair, dmat, tree);
+    }
+  } else if (!concurrent) {
+    builders_.front()->SetMaxThreads(0);
+#if XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+    for (auto tree : trees) {
+      builders_.front()->Update(gmat_, gmatb_, column_matrix_, gpair, dmat, tree);
+    }
+#else
+    if (seeds.empty()) {
+      builders_.front()->Update(gmat_, gmatb_, column_matrix_, gpair, dmat, trees.front());
+    }
+    // seed each tree as the concurrent path does, so that the row subsampling
+    // does not depend on the number of threads
+    for (size_t i = 0; i < seeds.size(); ++i) {
+      TreeSeedGuard guard(seeds[i]);
+      builders_.front()->Update(gmat_, gmatb_, column_matrix_, gpair, dmat, trees[i]);
+    }
+#endif  // XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+  } else {
+    this->UpdateConcurrent(gpair, dmat, trees, seeds, nthread);
   }
   param_.learning_rate = lr;
+  p_last_dmat_ = dmat;
+  p_last_tree_ = trees.back();
+}
+
+void QuantileHistMaker::UpdateConcurrent(HostDeviceVector<GradientPair> *gpair,
+                                         DMatrix *dmat,
+                                         const std::vector<RegTree *> &trees,
+                                         const std::vector<uint32_t> &seeds,
+                                         int nthread) {
+  // split the threads across trees; each tree then works on its own row set
+  // and histogram pool while sharing the read-only quantized matrices
+  const auto ntree = static_cast<bst_omp_uint>(trees.size());
+  const int nouter = std::min(static_cast<int>(ntree), nthread);
+  const int ninner = std::max(1, nthread / nouter);
+  for (bst_omp_uint i = 0; i < ntree; ++i) {
+    builders_[i]->SetMaxThreads(ninner);
+  }
+  // make sure the host copy of gradients exists before entering the region
+  gpair->ConstHostVector();
+
+#if defined(_OPENMP)
+  const int max_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(std::max(max_levels, 2));
+#endif  // defined(_OPENMP)
+  std::exception_ptr exc;
+#pragma omp parallel for num_threads(nouter) schedule(dynamic)
+  for (bst_omp_uint i = 0; i < ntree; ++i) {
+    try {
+      TreeSeedGuard guard(seeds[i]);
+      builders_[i]->Update(gmat_, gmatb_, column_matrix_, gpair, dmat, trees[i]);
+    } catch (...) {
+#pragma omp critical
+      {
+        if (!exc) {
+          exc = std::current_exception();
+        }
+      }
+    }
+  }
+#if defined(_OPENMP)
+  omp_set_max_active_levels(max_levels);
+#endif  // defined(_OPENMP)
+  if (exc) {
+    std::rethrow_exception(exc);
+  }
 }
 
 bool QuantileHistMaker::UpdatePredictionCache(
     const DMatrix* data,
     HostDeviceVector<bst_float>* out_preds) {
-  if (!builder_ || param_.subsample < 1.0f) {
+  if (p_last_tree_ == nullptr) {
+    return false;
+  } else if (data == p_last_dmat_) {
+    if (param_.subsample < 1.0f || param_.bootstrap) {
+      return false;
+    } else if (p_last_tree_->param.size_leaf_vector != 0) {
+      return multi_builder_->UpdatePredictionCache(data, out_preds);
+    }
+    return !builders_.empty() &&
+           builders_.front()->UpdatePredictionCache(data, out_preds);
+  } else {
+    return this->UpdateEvalPredictionCache(data, out_preds);
+  }
+}
+
+uint32_t QuantileHistMaker::EvalBin(bst_uint fid, bst_float fvalue) const {
+  const HistCutMatrix& cut = gmat_.cut;
+  const uint32_t nbins = cut.row_ptr[fid + 1] - cut.row_ptr[fid];
+  if (fid < feature_types_.size() &&
+      feature_types_[fid] == FeatureType::kCategorical) {
+    if (!(fvalue >= 0.0f)) {
+      return 0;
+    }
+    // every id past the last category behaves the same at a split
+    return fvalue >= static_cast<bst_float>(nbins) ? nbins + 1 : static_cast<uint32_t>(fvalue) + 1;
+  }
+  if (fvalue < cut.min_val[fid]) {
+    return 0;
+  }
+  auto cbegin = cut.cut.begin() + cut.row_ptr[fid];
+  auto cend = cut.cut.begin() + cut.row_ptr[fid + 1];
+  return static_cast<uint32_t>(std::upper_bound(cbegin, cend, fvalue) - cbegin) + 1;
+}
+
+void QuantileHistMaker::QuantizeEvalRows(DMatrix* dmat,
+                                         QuantizedEvalRows* out) const {
+  const std::vector<uint32_t>& cut_ptr = gmat_.cut.row_ptr;
+  // EvalBin returns at most the number of cuts plus one
+  uint32_t max_bin = 0;
+  for (size_t fid = 0; fid + 1 < cut_ptr.size(); ++fid) {
+    max_bin = std::max(max_bin, cut_ptr[fid + 1] - cut_ptr[fid] + 1);
+  }
+  out->bin8.clear();
+  out->bin16.clear();
+  out->bin32.clear();
+  if (max_bin < std::numeric_limits<uint8_t>::max()) {
+    this->QuantizeEvalRows(dmat, out, &out->bin8);
+  } else if (max_bin < std::numeric_limits<uint16_t>::max()) {
+    this->QuantizeEvalRows(dmat, out, &out->bin16);
+  } else {
+    this->QuantizeEvalRows(dmat, out, &out->bin32);
+  }
+}
+
+template <typename BinT>
+void QuantileHistMaker::QuantizeEvalRows(DMatrix* dmat, QuantizedEvalRows* out,
+                                         std::vector<BinT>* p_bins) const {
+  const auto nfeature = static_cast<bst_uint>(gmat_.cut.row_ptr.size() - 1);
+  std::vector<BinT>& bins = *p_bins;
+  out->row_ptr.assign(1, 0);
+  out->fidx.clear();
+  for (const auto &batch : dmat->GetRowBatches()) {
+    const size_t rbegin = out->row_ptr.size() - 1;
+    const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+    // features unknown to the training matrix are never split on
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      size_t nentry = 0;
+      for (const auto& e : batch[i]) {
+        nentry += e.index < nfeature;
+      }
+      out->row_ptr.push_back(out->row_ptr.back() + nentry);
+    }
+    out->fidx.resize(out->row_ptr.back());
+    bins.resize(out->row_ptr.back());
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      size_t j = out->row_ptr[rbegin + i];
+      for (const auto& e : batch[i]) {
+        if (e.index < nfeature) {
+          out->fidx[j] = e.index;
+          bins[j] = static_cast<BinT>(this->EvalBin(e.index, e.fvalue));
+          ++j;
+        }
+      }
+    }
+  }
+  const size_t nrow = out->row_ptr.size() - 1;
+  const size_t nentry = out->row_ptr.back();
+  out->num_row = nrow;
+  // switch to nfeature bins per row when they take no more memory
+  out->dense = nrow * nfeature * sizeof(BinT) <=
+               nentry * (sizeof(bst_uint) + sizeof(BinT)) + (nrow + 1) * sizeof(size_t);
+  if (out->dense) {
+    std::vector<BinT> dense(nrow * nfeature, std::numeric_limits<BinT>::max());
+    const auto nrow_omp = static_cast<bst_omp_uint>(nrow);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nrow_omp; ++i) {
+      for (size_t j = out->row_ptr[i]; j < out->row_ptr[i + 1]; ++j) {
+        dense[i * nfeature + out->fidx[j]] = bins[j];
+      }
+    }
+    bins.swap(dense);
+    std::vector<size_t>().swap(out->row_ptr);
+    std::vector<bst_uint>().swap(out->fidx);
+  }
+}
+
+template <typename BinT>
+void QuantileHistMaker::PredictEvalRows(const QuantizedEvalRows& rows,
+                                        const std::vector<BinT>& bins,
+                                        const std::vector<uint32_t>& threshold,
+                                        std::vector<bst_float>* out_preds) const {
+  const RegTree& tree = *p_last_tree_;
+  const auto nfeature = static_cast<size_t>(gmat_.cut.row_ptr.size() - 1);
+  std::vector<bst_float>& out = *out_preds;
+  const auto nrow = static_cast<bst_omp_uint>(rows.num_row);
+  // a vector tree adds one output per group
+  const int ngroup = std::max(tree.param.size_leaf_vector, 1);
+  CHECK_EQ(out.size(), static_cast<size_t>(nrow) * ngroup);
+
+  constexpr BinT kMissing = std::numeric_limits<BinT>::max();
+#pragma omp parallel
+  {
+    // the bins of a sparse row, spread over its features
+    std::vector<BinT> feats(rows.dense ? 0 : nfeature, kMissing);
+#pragma omp for schedule(static)
+    for (bst_omp_uint i = 0; i < nrow; ++i) {
+      const BinT* row = dmlc::BeginPtr(feats);
+      if (rows.dense) {
+        row = dmlc::BeginPtr(bins) + static_cast<size_t>(i) * nfeature;
+      } else {
+        for (size_t j = rows.row_ptr[i]; j < rows.row_ptr[i + 1]; ++j) {
+          feats[rows.fidx[j]] = bins[j];
+        }
+      }
+      int nid = 0;
+      while (!tree[nid].IsLeaf()) {
+        const BinT bin = row[tree[nid].SplitIndex()];
+        if (bin == kMissing) {
+          nid = tree[nid].DefaultChild();
+        } else if (tree.IsCategorical(nid)) {
+          const bool go_left = bin != 0 &&
+              tree.InCategories(nid, static_cast<bst_float>(bin - 1));
+          nid = go_left ? tree[nid].LeftChild() : tree[nid].RightChild();
+        } else {
+          nid = bin <= threshold[nid] ? tree[nid].LeftChild()
+                                      : tree[nid].RightChild();
+        }
+      }
+      if (tree.param.size_leaf_vector != 0) {
+        const bst_float* leaf = tree.LeafVector(nid);
+        for (int k = 0; k < ngroup; ++k) {
+          out[i * ngroup + k] += leaf[k];
+        }
+      } else {
+        out[i] += tree[nid].LeafValue();
+      }
+      if (!rows.dense) {
+        for (size_t j = rows.row_ptr[i]; j < rows.row_ptr[i + 1]; ++j) {
+          feats[rows.fidx[j]] = kMissing;
+        }
+      }
+    }
+  }
+}
+
+bool QuantileHistMaker::UpdateEvalPredictionCache(
+    const DMatrix* data,
+    HostDeviceVector<bst_float>* out_preds) {
+  if (!is_gmat_initialized_ || p_last_tree_ == nullptr ||
+      !data->Info().root_index_.empty()) {
     return false;
+  }
+  const RegTree& tree = *p_last_tree_;
+  const HistCutMatrix& cut = gmat_.cut;
+  const auto nfeature = static_cast<bst_uint>(cut.row_ptr.size() - 1);
+  // a split sends a row left iff its bin is not greater than the threshold of
+  // the node; hist splits on cut values or min_val, which all have a bin
+  std::vector<uint32_t> threshold(tree.param.num_nodes, 0);
+  for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+    const RegTree::Node& node = tree[nid];
+    if (node.IsLeaf() || node.IsDeleted()) {
+      continue;
+    }
+    const bst_uint fid = node.SplitIndex();
+    const bool is_cat = fid < feature_types_.size() &&
+                        feature_types_[fid] == FeatureType::kCategorical;
+    if (fid >= nfeature || is_cat != tree.IsCategorical(nid)) {
+      return false;
+    }
+    if (is_cat) {
+      continue;
+    }
+    const bst_float split_pt = node.SplitCond();
+    if (split_pt == cut.min_val[fid]) {
+      threshold[nid] = 0;
+      continue;
+    }
+    auto cbegin = cut.cut.begin() + cut.row_ptr[fid];
+    auto cend = cut.cut.begin() + cut.row_ptr[fid + 1];
+    auto it = std::lower_bound(cbegin, cend, split_pt);
+    if (it == cend || *it != split_pt) {
+      return false;
+    }
+    threshold[nid] = static_cast<uint32_t>(it - cbegin) + 1;
+  }
+
+  const MetaInfo& info = data->Info();
+  auto it = eval_rows_.find(data);
+  if (it == eval_rows_.end() || it->second.num_row != info.num_row_ ||
+      it->second.num_nonzero != info.num_nonzero_) {
+    eval_rows_[data] = QuantizedEvalRows();
+    it = eval_rows_.find(data);
+    // row batches are only read
+    this->QuantizeEvalRows(const_cast<DMatrix*>(data), &it->second);
+    it->second.num_nonzero = info.num_nonzero_;
+  }
+  QuantizedEvalRows& rows = it->second;
+  rows.last_update = num_updates_;
+  std::vector<bst_float>& out = out_preds->HostVector();
+  // without entries any bin type will do
+  if (!rows.bin32.empty()) {
+    this->PredictEvalRows(rows, rows.bin32, threshold, &out);
+  } else if (!rows.bin16.empty()) {
+    this->PredictEvalRows(rows, rows.bin16, threshold, &out);
   } else {
-    return builder_->UpdatePredictionCache(data, out_preds);
+    this->PredictEvalRows(rows, rows.bin8, threshold, &out);
   }
+  return true;
+}
+
+bool QuantileHistMaker::Builder::UseColumnWiseHist(size_t nrows,
+                                                  const GHistIndexMatrix& gmat) const {
+  if (param_.hist_build_method != TrainParam::kHistBuildAuto) {
+    return param_.hist_build_method == TrainParam::kHistBuildColumnWise;
+  }
+  const size_t nfeature = gmat.ColumnPtr().size() - 1;
+  const size_t nbins = gmat.NumBins();
+  if (nthread_ <= 1 || nfeature < static_cast<size_t>(nthread_)) {
+    return false;
+  }
+  // BuildHist assigns blocks of 512 rows; with fewer blocks fewer threads
+  // participate and fewer private histograms need to be reduced
+  const size_t nthread_row = std::min(static_cast<size_t>(nthread_),
+                                      nrows / 512 + !!(nrows % 512));
+  if (nthread_row <= 1) {
+    return false;
+  }
+  // while the private histograms stay in cache, clearing and reducing them is
+  // cheap next to the accumulation
+  if (nbins * nthread_row * sizeof(GradStats) <= kHistCacheBytes) {
+    return false;
+  }
+  const double nnz_per_row = static_cast<double>(gmat.index.size()) /
+                             std::max(gmat.row_ptr.size() - 1, static_cast<size_t>(1));
+  // row-wise: accumulate the entries, then clear and reduce one histogram per
+  // thread, all of which miss the cache
+  const double row_wise = nrows * nnz_per_row + 2.0 * nthread_row * nbins;
+  // column-wise: visit every (row, feature) pair, gathering the gradient of
+  // the row again for every feature; the bins of a feature stay in cache
+  const double column_wise = 2.0 * nrows * nfeature;
+  return column_wise < row_wise;
 }
 
 void QuantileHistMaker::Builder::SyncHistograms(
-    int starting_index,
-    int sync_count,
+    const std::vector<int> &sync_nids,
     RegTree *p_tree) {
   builder_monitor_.Start("SyncHistograms");
-  this->histred_.Allreduce(hist_[starting_index].data(), hist_builder_.GetNumBins() * sync_count);
+  if (rabit::IsDistributed()) {
+    // all nodes of the level in a single allreduce
+    std::vector<GHistRow> hists;
+    for (int nid : sync_nids) {
+      hists.push_back(hist_[nid]);
+    }
+    hist_allreducer_.Allreduce(hists);
+  }
   // use Subtraction Trick
   for (auto const& node_pair : nodes_for_subtraction_trick_) {
     hist_.AddHistRow(node_pair.first);
@@ -103,11 +525,20 @@ void QuantileHistMaker::Builder::SyncHistograms(
   builder_monitor_.Stop("SyncHistograms");
 }
 
+bool QuantileHistMaker::Builder::IsBuiltSibling(int nid, const RegTree &tree) const {
+  const SplitEntry& split = snode_[tree[nid].Parent()].best;
+  if (tree[nid].IsLeftChild()) {
+    return split.left_sum.sum_hess <= split.right_sum.sum_hess;
+  } else {
+    return split.right_sum.sum_hess < split.left_sum.sum_hess;
+  }
+}
+
 void QuantileHistMaker::Builder::BuildLocalHistograms(
-    int *starting_index,
-    int *sync_count,
+    std::vector<int> *sync_nids,
     const GHistIndexMatrix &gmat,
     const GHistIndexBlockMatrix &gmatb,
+    const ColumnMatrix &column_matrix,
     RegTree *p_tree,
     const std::vector<GradientPair> &gpair_h) {
   builder_monitor_.Start("BuildLocalHistograms");
@@ -115,38 +546,36 @@ void QuantileHistMaker::Builder::BuildLocalHistograms(
     int nid = entry.nid;
     RegTree::Node &node = (*p_tree)[nid];
     if (rabit::IsDistributed()) {
-      if (node.IsRoot() || node.IsLeftChild()) {
+      // in distributed setting, the child with the smaller global hessian is built
+      if (node.IsRoot() || this->IsBuiltSibling(nid, *p_tree)) {
         hist_.AddHistRow(nid);
-        // in distributed setting, we always calculate from left child or root node
-        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, hist_[nid], false);
+        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, column_matrix, hist_[nid], false);
         if (!node.IsRoot()) {
-          nodes_for_subtraction_trick_[(*p_tree)[node.Parent()].RightChild()] = nid;
+          const RegTree::Node &parent = (*p_tree)[node.Parent()];
+          const int sibling = node.IsLeftChild() ? parent.RightChild() : parent.LeftChild();
+          nodes_for_subtraction_trick_[sibling] = nid;
         }
-        (*sync_count)++;
-        (*starting_index) = std::min((*starting_index), nid);
+        sync_nids->push_back(nid);
       }
     } else {
       if (!node.IsRoot() && node.IsLeftChild() &&
           (row_set_collection_[nid].Size() <
            row_set_collection_[(*p_tree)[node.Parent()].RightChild()].Size())) {
         hist_.AddHistRow(nid);
-        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, hist_[nid], false);
+        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, column_matrix, hist_[nid], false);
         nodes_for_subtraction_trick_[(*p_tree)[node.Parent()].RightChild()] = nid;
-        (*sync_count)++;
-        (*starting_index) = std::min((*starting_index), nid);
+        sync_nids->push_back(nid);
       } else if (!node.IsRoot() && !node.IsLeftChild() &&
                  (row_set_collection_[nid].Size() <=
                   row_set_collection_[(*p_tree)[node.Parent()].LeftChild()].Size())) {
         hist_.AddHistRow(nid);
-        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, hist_[nid], false);
+        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, column_matrix, hist_[nid], false);
         nodes_for_subtraction_trick_[(*p_tree)[node.Parent()].LeftChild()] = nid;
-        (*sync_count)++;
-        (*starting_index) = std::min((*starting_index), nid);
+        sync_nids->push_back(nid);
       } else if (node.IsRoot()) {
         hist_.AddHistRow(nid);
-        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, hist_[nid], false);
-        (*sync_count)++;
-        (*starting_index) = std::min((*starting_index), nid);
+        BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, column_matrix, hist_[nid], false);
+        sync_nids->push_back(nid);
       }
     }
   }
@@ -219,11 +648,10 @@ void QuantileHistMaker::Builder::ExpandWithDepthWidth(
   qexpand_depth_wise_.emplace_back(ExpandEntry(0, p_tree->GetDepth(0), 0.0, timestamp++));
   ++num_leaves;
   for (int depth = 0; depth < param_.max_depth + 1; depth++) {
-    int starting_index = std::numeric_limits<int>::max();
-    int sync_count = 0;
+    std::vector<int> sync_nids;
     std::vector<ExpandEntry> temp_qexpand_depth;
-    BuildLocalHistograms(&starting_index, &sync_count, gmat, gmatb, p_tree, gpair_h);
-    SyncHistograms(starting_index, sync_count, p_tree);
+    BuildLocalHistograms(&sync_nids, gmat, gmatb, column_matrix, p_tree, gpair_h);
+    SyncHistograms(sync_nids, p_tree);
     BuildNodeStats(gmat, p_fmat, p_tree, gpair_h);
     EvaluateSplits(gmat, column_matrix, p_fmat, p_tree, &num_leaves, depth, &timestamp,
                    &temp_qexpand_depth);
@@ -252,7 +680,7 @@ void QuantileHistMaker::Builder::ExpandWithLossGuide(
 
   for (int nid = 0; nid < p_tree->param.num_roots; ++nid) {
     hist_.AddHistRow(nid);
-    BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, hist_[nid], true);
+    BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, column_matrix, hist_[nid], true);
 
     this->InitNewNode(nid, gmat, gpair_h, *p_fmat, *p_tree);
 
@@ -281,14 +709,23 @@ void QuantileHistMaker::Builder::ExpandWithLossGuide(
 
       if (rabit::IsDistributed()) {
         // in distributed mode, we need to keep consistent across workers
-        BuildHist(gpair_h, row_set_collection_[cleft], gmat, gmatb, hist_[cleft], true);
-        SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
+        if (this->IsBuiltSibling(cleft, *p_tree)) {
+          BuildHist(gpair_h, row_set_collection_[cleft], gmat, gmatb, column_matrix,
+                    hist_[cleft], true);
+          SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
+        } else {
+          BuildHist(gpair_h, row_set_collection_[cright], gmat, gmatb, column_matrix,
+                    hist_[cright], true);
+          SubtractionTrick(hist_[cleft], hist_[cright], hist_[nid]);
+        }
       } else {
         if (row_set_collection_[cleft].Size() < row_set_collection_[cright].Size()) {
-          BuildHist(gpair_h, row_set_collection_[cleft], gmat, gmatb, hist_[cleft], true);
+          BuildHist(gpair_h, row_set_collection_[cleft], gmat, gmatb, column_matrix,
+                    hist_[cleft], true);
           SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
         } else {
-          BuildHist(gpair_h, row_set_collection_[cright], gmat, gmatb, hist_[cright], true);
+          BuildHist(gpair_h, row_set_collection_[cright], gmat, gmatb, column_matrix,
+                    hist_[cright], true);
           SubtractionTrick(hist_[cleft], hist_[cright], hist_[nid]);
         }
       }
@@ -408,15 +845,20 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     // clear local prediction cache
     leaf_value_cache_.clear();
     // initialize histogram collection
-    uint32_t nbins = gmat.cut.row_ptr.back();
+    uint32_t nbins = gmat.NumBins();
     hist_.Init(nbins);
 
     // initialize histogram builder
+    if (max_nthread_ > 0) {
+      this->nthread_ = max_nthread_;
+    } else {
 #pragma omp parallel
-    {
-      this->nthread_ = omp_get_num_threads();
+      {
+        this->nthread_ = omp_get_num_threads();
+      }
     }
     hist_builder_.Init(this->nthread_, nbins);
+    hist_allreducer_.Init(nbins, param_.hist_sync_precision);
 
     CHECK_EQ(info.root_index_.size(), 0U);
     std::vector<size_t>& row_indices = row_set_collection_.row_indices_;
@@ -424,7 +866,9 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     auto* p_row_indices = row_indices.data();
     // mark subsample and build list of member rows
 
-    if (param_.subsample < 1.0f) {
+    if (param_.bootstrap) {
+      this->InitBootstrap(gpair, info, &row_indices);
+    } else if (param_.subsample < 1.0f) {
       std::bernoulli_distribution coin_flip(param_.subsample);
       auto& rnd = common::GlobalRandom();
       size_t j = 0;
@@ -441,9 +885,10 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
 
       const size_t block_size = info.num_row_ / this->nthread_ + !!(info.num_row_ % this->nthread_);
 
-      #pragma omp parallel num_threads(this->nthread_)
-      {
-        const size_t tid = omp_get_thread_num();
+      // iterate over blocks rather than thread ids, as the team may be smaller
+      // than nthread_ when this builder runs inside a nested parallel region
+      #pragma omp parallel for num_threads(this->nthread_) schedule(static)
+      for (bst_omp_uint tid = 0; tid < static_cast<bst_omp_uint>(this->nthread_); ++tid) {
         const size_t ibegin = tid * block_size;
         const size_t iend = std::min(static_cast<size_t>(ibegin + block_size),
             static_cast<size_t>(info.num_row_));
@@ -472,9 +917,8 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
         }
         row_indices.resize(j);
       } else {
-        #pragma omp parallel num_threads(this->nthread_)
-        {
-          const size_t tid = omp_get_thread_num();
+        #pragma omp parallel for num_threads(this->nthread_) schedule(static)
+        for (bst_omp_uint tid = 0; tid < static_cast<bst_omp_uint>(this->nthread_); ++tid) {
           const size_t ibegin = tid * block_size;
           const size_t iend = std::min(static_cast<size_t>(ibegin + block_size),
               static_cast<size_t>(info.num_row_));
@@ -519,6 +963,11 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     column_sampler_.Init(info.num_col_, param_.colsample_bynode, param_.colsample_bylevel,
             param_.colsample_bytree,  false);
   }
+  if (gmat.IsBundled()) {
+    // the bins of a bundled feature miss the rows in its default bin, sum up
+    // the gradients of the rows instead
+    data_layout_ = kSparseData;
+  }
   if (data_layout_ == kDenseDataZeroBased || data_layout_ == kDenseDataOneBased) {
     /* specialized code for dense data:
        choose the column that has a least positive number of discrete bins.
@@ -552,6 +1001,50 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
   builder_monitor_.Stop("InitData");
 }
 
+void QuantileHistMaker::Builder::InitBootstrap(const std::vector<GradientPair>& gpair,
+                                               const MetaInfo& info,
+                                               std::vector<size_t>* p_row_indices) {
+  // Poisson bootstrap: every row is drawn Poisson(subsample) times. Rows are
+  // processed in fixed-size blocks, each with its own engine, so that the
+  // sample only depends on the seed and not on the number of threads.
+  constexpr size_t kBlockSize = 2048;
+  const size_t nrow = info.num_row_;
+  const size_t nblock = nrow / kBlockSize + !!(nrow % kBlockSize);
+  const auto seed = static_cast<uint32_t>(common::GlobalRandom()());
+  std::vector<size_t>& row_indices = *p_row_indices;
+  std::vector<size_t> block_size(nblock, 0);
+  row_multiplicity_.resize(nrow);
+
+#pragma omp parallel for num_threads(nthread_) schedule(static)
+  for (bst_omp_uint bid = 0; bid < nblock; ++bid) {
+    std::seed_seq seq{seed, static_cast<uint32_t>(bid)};
+    common::RandomEngine rnd(seq);
+    std::poisson_distribution<uint32_t> draw(param_.subsample);
+    const size_t ibegin = bid * kBlockSize;
+    const size_t iend = std::min(ibegin + kBlockSize, nrow);
+    size_t j = ibegin;
+    for (size_t i = ibegin; i < iend; ++i) {
+      // with subsample <= 1 a row is practically never drawn more than 255 times
+      const uint32_t k = std::min(draw(rnd), static_cast<uint32_t>(255));
+      if (k == 0 || gpair[i].GetHess() < 0.0f) {
+        row_multiplicity_[i] = 0;
+      } else {
+        row_multiplicity_[i] = static_cast<uint8_t>(k);
+        row_indices[j++] = i;
+      }
+    }
+    block_size[bid] = j - ibegin;
+  }
+  // compact the per-block row lists; blocks only move towards the front
+  size_t nsampled = 0;
+  for (size_t bid = 0; bid < nblock; ++bid) {
+    const size_t* begin = row_indices.data() + bid * kBlockSize;
+    std::copy(begin, begin + block_size[bid], row_indices.data() + nsampled);
+    nsampled += block_size[bid];
+  }
+  row_indices.resize(nsampled);
+}
+
 void QuantileHistMaker::Builder::EvaluateSplit(const int nid,
                                                const GHistIndexMatrix& gmat,
                                                const HistCollection& hist,
@@ -570,6 +1063,18 @@ void QuantileHistMaker::Builder::EvaluateSplit(const int nid,
     best_split_tloc_[tid] = snode_[nid].best;
   }
   GHistRow node_hist = hist[nid];
+  if (gmat.IsBundled()) {
+    // the histogram is over the bins of the feature bundles, enumerate the
+    // splits over the bins of each feature
+    hist_unbundled_.resize(gmat.cut.row_ptr.back());
+#pragma omp parallel for schedule(static) num_threads(nthread)
+    for (bst_omp_uint i = 0; i < nfeature; ++i) {
+      gmat.UnbundleHist(static_cast<bst_uint>(feature_set[i]), node_hist.data(),
+                        &snode_[nid].stats, 1, dmlc::BeginPtr(hist_unbundled_));
+    }
+    node_hist = {dmlc::BeginPtr(hist_unbundled_),
+                 static_cast<GHistRow::index_type>(hist_unbundled_.size())};
+  }
 
 #pragma omp parallel for schedule(dynamic) num_threads(nthread)
   for (bst_omp_uint i = 0; i < nfeature; ++i) {  // NOLINT(*)
@@ -578,7 +1083,13 @@ void QuantileHistMaker::Builder::EvaluateSplit(const int nid,
     const auto node_id = static_cast<bst_uint>(nid);
     // Narrow search space by dropping features that are not feasible under the
     // given set of constraints (e.g. feature interaction constraints)
-    if (spliteval_->CheckFeatureConstraint(node_id, feature_id)) {
+    if (!spliteval_->CheckFeatureConstraint(node_id, feature_id)) {
+      continue;
+    }
+    if (info.IsCategorical(feature_id)) {
+      this->EnumerateCategoricalSplit(gmat, node_hist, snode_[nid],
+                                      &best_split_tloc_[tid], feature_id, node_id);
+    } else {
       this->EnumerateSplit(-1, gmat, node_hist, snode_[nid], info,
                            &best_split_tloc_[tid], feature_id, node_id);
       this->EnumerateSplit(+1, gmat, node_hist, snode_[nid], info,
@@ -606,9 +1117,41 @@ void QuantileHistMaker::Builder::ApplySplit(int nid,
       spliteval_->ComputeWeight(nid, e.best.left_sum) * param_.learning_rate;
   bst_float right_leaf_weight =
       spliteval_->ComputeWeight(nid, e.best.right_sum) * param_.learning_rate;
-  p_tree->ExpandNode(nid, e.best.SplitIndex(), e.best.split_value,
-                     e.best.DefaultLeft(), e.weight, left_leaf_weight,
-                     right_leaf_weight, e.best.loss_chg, e.stats.sum_hess);
+  const bst_uint fid = e.best.SplitIndex();
+  const uint32_t lower_bound = gmat.cut.row_ptr[fid];
+  const uint32_t upper_bound = gmat.cut.row_ptr[fid + 1];
+  const bool is_categorical = fmat.Info().IsCategorical(fid);
+  // for a categorical split, whether each bin of the feature goes left
+  std::vector<uint8_t> left_bins;
+  if (is_categorical) {
+    GHistRow node_hist = hist[nid];
+    if (gmat.IsBundled()) {
+      hist_unbundled_.resize(gmat.cut.row_ptr.back());
+      gmat.UnbundleHist(fid, node_hist.data(), &e.stats, 1,
+                        dmlc::BeginPtr(hist_unbundled_));
+      node_hist = {dmlc::BeginPtr(hist_unbundled_),
+                   static_cast<GHistRow::index_type>(hist_unbundled_.size())};
+    }
+    // the split value is the number of sorted bins sent left
+    std::vector<uint32_t> order;
+    this->SortCategories(gmat, node_hist, fid, &order);
+    const auto nleft = static_cast<size_t>(e.best.split_value);
+    CHECK_GT(nleft, 0U);
+    CHECK_LT(nleft, order.size());
+    left_bins.resize(upper_bound - lower_bound, 0);
+    std::vector<uint32_t> left_categories(nleft);
+    for (size_t i = 0; i < nleft; ++i) {
+      left_bins[order[i] - lower_bound] = 1;
+      left_categories[i] = order[i] - lower_bound;
+    }
+    p_tree->ExpandCategoricalNode(nid, fid, left_categories,
+                                  e.best.DefaultLeft(), e.weight, left_leaf_weight,
+                                  right_leaf_weight, e.best.loss_chg, e.stats.sum_hess);
+  } else {
+    p_tree->ExpandNode(nid, fid, e.best.split_value,
+                       e.best.DefaultLeft(), e.weight, left_leaf_weight,
+                       right_leaf_weight, e.best.loss_chg, e.stats.sum_hess);
+  }
 
   /* 2. Categorize member rows */
   const auto nthread = static_cast<bst_omp_uint>(this->nthread_);
@@ -618,25 +1161,45 @@ void QuantileHistMaker::Builder::ApplySplit(int nid,
     row_split_tloc_[i].right.clear();
   }
   const bool default_left = (*p_tree)[nid].DefaultLeft();
-  const bst_uint fid = (*p_tree)[nid].SplitIndex();
-  const bst_float split_pt = (*p_tree)[nid].SplitCond();
-  const uint32_t lower_bound = gmat.cut.row_ptr[fid];
-  const uint32_t upper_bound = gmat.cut.row_ptr[fid + 1];
+  const auto& rowset = row_set_collection_[nid];
+  const bst_uint col = gmat.FeatureColumn(fid);
+  Column column = column_matrix.GetColumn(col);
+
   int32_t split_cond = -1;
-  // convert floating-point split_pt into corresponding bin_id
-  // split_cond = -1 indicates that split_pt is less than all known cut points
-  CHECK_LT(upper_bound,
-           static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-  for (uint32_t i = lower_bound; i < upper_bound; ++i) {
-    if (split_pt == gmat.cut.cut[i]) {
-      split_cond = static_cast<int32_t>(i);
+  if (!is_categorical) {
+    const bst_float split_pt = (*p_tree)[nid].SplitCond();
+    // convert floating-point split_pt into corresponding bin_id
+    // split_cond = -1 indicates that split_pt is less than all known cut points
+    CHECK_LT(upper_bound,
+             static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
+    for (uint32_t i = lower_bound; i < upper_bound; ++i) {
+      if (split_pt == gmat.cut.cut[i]) {
+        split_cond = static_cast<int32_t>(i);
+      }
     }
   }
 
-  const auto& rowset = row_set_collection_[nid];
-
-  Column column = column_matrix.GetColumn(fid);
-  if (column.GetType() == xgboost::common::kDenseColumn) {
+  if (gmat.IsBundled()) {
+    // the column holds the bins of the whole bundle of fid: rows in the bins
+    // of its other features, or without an entry, lie in the default of fid
+    auto goes_left = [&](uint32_t bin) {
+      return is_categorical ? left_bins[bin - lower_bound] != 0 :
+                              static_cast<int32_t>(bin) <= split_cond;
+    };
+    const uint32_t dflt = gmat.default_bin[fid];
+    const bool absent_left = dflt == GHistIndexMatrix::kNoBin ? default_left : goes_left(dflt);
+    const uint32_t col_begin = gmat.bundle_ptr[col];
+    const uint32_t col_end = gmat.bundle_ptr[col + 1];
+    std::vector<uint8_t> column_left(col_end - col_begin);
+    for (uint32_t i = col_begin; i < col_end; ++i) {
+      const uint32_t bin = gmat.cut_bin[i];
+      column_left[i - col_begin] = bin >= lower_bound && bin < upper_bound ?
+                                   goes_left(bin) : absent_left;
+    }
+    ApplySplitBinLookup(rowset, &row_split_tloc_, column, column_left, absent_left);
+  } else if (is_categorical) {
+    ApplySplitBinLookup(rowset, &row_split_tloc_, column, left_bins, default_left);
+  } else if (column.GetType() == xgboost::common::kDenseColumn) {
     ApplySplitDenseData(rowset, gmat, &row_split_tloc_, column, split_cond,
                         default_left);
   } else {
@@ -723,9 +1286,8 @@ void QuantileHistMaker::Builder::ApplySplitSparseData(
   std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
   const size_t nrows = rowset.end - rowset.begin;
 
-#pragma omp parallel num_threads(nthread_)
-  {
-    const auto tid = static_cast<size_t>(omp_get_thread_num());
+#pragma omp parallel for num_threads(nthread_) schedule(static)
+  for (bst_omp_uint tid = 0; tid < static_cast<bst_omp_uint>(nthread_); ++tid) {
     const size_t ibegin = tid * nrows / nthread_;
     const size_t iend = (tid + 1) * nrows / nthread_;
     if (ibegin < iend) {  // ensure that [ibegin, iend) is nonempty range
@@ -780,6 +1342,53 @@ void QuantileHistMaker::Builder::ApplySplitSparseData(
   }
 }
 
+void QuantileHistMaker::Builder::ApplySplitBinLookup(
+    const RowSetCollection::Elem rowset,
+    std::vector<RowSetCollection::Split>* p_row_split_tloc,
+    const Column& column,
+    const std::vector<uint8_t>& left_bins,
+    bool default_left) {
+  std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
+  const size_t nrows = rowset.end - rowset.begin;
+  const bool is_dense = column.GetType() == xgboost::common::kDenseColumn;
+
+#pragma omp parallel for num_threads(nthread_) schedule(static)
+  for (bst_omp_uint tid = 0; tid < static_cast<bst_omp_uint>(nthread_); ++tid) {
+    const size_t ibegin = tid * nrows / nthread_;
+    const size_t iend = (tid + 1) * nrows / nthread_;
+    if (ibegin >= iend) {
+      continue;
+    }
+    auto& left = row_split_tloc[tid].left;
+    auto& right = row_split_tloc[tid].right;
+    // sparse columns: first nonzero row with index >= rowset[ibegin]
+    size_t cursor = is_dense ? 0 :
+        std::lower_bound(column.GetRowData(), column.GetRowData() + column.Size(),
+                         rowset.begin[ibegin]) - column.GetRowData();
+    for (size_t i = ibegin; i < iend; ++i) {
+      const size_t rid = rowset.begin[i];
+      uint32_t rbin = std::numeric_limits<uint32_t>::max();
+      if (is_dense) {
+        rbin = column.GetFeatureBinIdx(rid);
+      } else {
+        while (cursor < column.Size() && column.GetRowIdx(cursor) < rid) {
+          ++cursor;
+        }
+        if (cursor < column.Size() && column.GetRowIdx(cursor) == rid) {
+          rbin = column.GetFeatureBinIdx(cursor);
+        }
+      }
+      const bool go_left = rbin == std::numeric_limits<uint32_t>::max() ?
+          default_left : left_bins[rbin] != 0;
+      if (go_left) {
+        left.push_back(rid);
+      } else {
+        right.push_back(rid);
+      }
+    }
+  }
+}
+
 void QuantileHistMaker::Builder::InitNewNode(int nid,
                                              const GHistIndexMatrix& gmat,
                                              const std::vector<GradientPair>& gpair,
@@ -805,8 +1414,15 @@ void QuantileHistMaker::Builder::InitNewNode(int nid,
         }
       } else {
         const RowSetCollection::Elem e = row_set_collection_[nid];
-        for (const size_t* it = e.begin; it < e.end; ++it) {
-          stats.Add(gpair[*it]);
+        if (param_.bootstrap) {
+          for (const size_t* it = e.begin; it < e.end; ++it) {
+            const float k = row_multiplicity_[*it];
+            stats.Add(GradientPair(gpair[*it].GetGrad() * k, gpair[*it].GetHess() * k));
+          }
+        } else {
+          for (const size_t* it = e.begin; it < e.end; ++it) {
+            stats.Add(gpair[*it]);
+          }
         }
       }
       histred_.Allreduce(&snode_[nid].stats, 1);
@@ -906,6 +1522,645 @@ void QuantileHistMaker::Builder::EnumerateSplit(int d_step,
   p_best->Update(best);
 }
 
+void QuantileHistMaker::Builder::SortCategories(const GHistIndexMatrix& gmat,
+                                                const GHistRow& hist,
+                                                bst_uint fid,
+                                                std::vector<uint32_t>* p_order) const {
+  std::vector<uint32_t>& order = *p_order;
+  order.clear();
+  for (uint32_t i = gmat.cut.row_ptr[fid]; i < gmat.cut.row_ptr[fid + 1]; ++i) {
+    if (hist[i].GetHess() != 0.0f || hist[i].GetGrad() != 0.0f) {
+      order.push_back(i);
+    }
+  }
+  // sorting by gradient ratio makes the best partition a prefix of the order;
+  // ties are broken by bin index so that ApplySplit recovers the same order
+  const double lambda = param_.reg_lambda;
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    const double ra = hist[a].GetGrad() / (hist[a].GetHess() + lambda);
+    const double rb = hist[b].GetGrad() / (hist[b].GetHess() + lambda);
+    return ra < rb || (ra == rb && a < b);
+  });
+}
+
+void QuantileHistMaker::Builder::EnumerateCategoricalSplit(const GHistIndexMatrix& gmat,
+                                                           const GHistRow& hist,
+                                                           const NodeEntry& snode,
+                                                           SplitEntry* p_best,
+                                                           bst_uint fid,
+                                                           bst_uint nodeID) {
+  std::vector<uint32_t> order;
+  this->SortCategories(gmat, hist, fid, &order);
+  if (order.size() < 2) {
+    return;
+  }
+  // rows missing this feature
+  GradStats present;
+  for (uint32_t i : order) {
+    present.Add(hist[i].GetGrad(), hist[i].GetHess());
+  }
+  GradStats missing;
+  missing.SetSubstract(snode.stats, present);
+
+  SplitEntry best;
+  GradStats prefix;
+  for (size_t k = 0; k + 1 < order.size(); ++k) {
+    prefix.Add(hist[order[k]].GetGrad(), hist[order[k]].GetHess());
+    const auto split_pt = static_cast<bst_float>(k + 1);
+    for (bool default_left : {false, true}) {
+      GradStats left = prefix;
+      if (default_left) {
+        left.Add(missing);
+      }
+      GradStats right;
+      right.SetSubstract(snode.stats, left);
+      if (left.sum_hess >= param_.min_child_weight &&
+          right.sum_hess >= param_.min_child_weight) {
+        const auto loss_chg = static_cast<bst_float>(
+            spliteval_->ComputeSplitScore(nodeID, fid, left, right) -
+            snode.root_gain);
+        best.Update(loss_chg, fid, split_pt, default_left, left, right);
+      }
+    }
+  }
+  p_best->Update(best);
+}
+
+void QuantileHistMaker::MultiOutputBuilder::Update(
+    const GHistIndexMatrix& gmat,
+    const ColumnMatrix& column_matrix,
+    HostDeviceVector<GradientPair>* gpair,
+    DMatrix* p_fmat,
+    RegTree* p_tree) {
+  builder_monitor_.Start("Update");
+  const std::vector<GradientPair>& gpair_h = gpair->ConstHostVector();
+  spliteval_->Reset();
+  this->InitData(gmat, gpair_h, *p_fmat, *p_tree);
+
+  this->BuildNodeStats({0}, gpair_h);
+  this->SetNodeVector(0, p_tree);
+  // nodes of the current level, and those of them built from the data; the
+  // histogram of every other node is its parent's minus its sibling's
+  std::vector<int> level {0};
+  std::vector<int> build {0};
+  for (int depth = 0; depth < param_.max_depth && !level.empty(); ++depth) {
+    this->BuildHistograms(build, gmat, column_matrix, gpair_h);
+    const size_t hist_size = static_cast<size_t>(nbins_) * ngroup_;
+    for (int nid : level) {
+      if (hist_[nid].empty()) {
+        const int parent = (*p_tree)[nid].Parent();
+        const int sibling = (*p_tree)[parent].LeftChild() == nid ?
+            (*p_tree)[parent].RightChild() : (*p_tree)[parent].LeftChild();
+        hist_[nid].resize(hist_size);
+        for (size_t i = 0; i < hist_size; ++i) {
+          hist_[nid][i].SetSubstract(hist_[parent][i], hist_[sibling][i]);
+        }
+      }
+    }
+    for (int nid : level) {
+      if (nid != 0) {
+        std::vector<GradStats>().swap(hist_[(*p_tree)[nid].Parent()]);
+      }
+    }
+
+    this->EvaluateSplits(level, gmat, *p_tree);
+    std::vector<int> split_nids;
+    std::vector<int> next_level;
+    std::vector<int> next_build;
+    for (int nid : level) {
+      const SplitCandidate& best = best_[nid];
+      if (best.loss_chg < kRtEps) {
+        continue;
+      }
+      const GradStats* node_sum = dmlc::BeginPtr(node_stats_[nid]);
+      double sum_hess = 0.0;
+      for (int k = 0; k < ngroup_; ++k) {
+        sum_hess += node_sum[k].sum_hess;
+      }
+      // the scalar leaf values of a vector tree are unused
+      if (best.is_cat) {
+        p_tree->ExpandCategoricalNode(
+            nid, best.SplitIndex(),
+            {static_cast<uint32_t>(best.split_value)}, best.DefaultLeft(),
+            0.0f, 0.0f, 0.0f, best.loss_chg, static_cast<float>(sum_hess));
+      } else {
+        p_tree->ExpandNode(nid, best.SplitIndex(), best.split_value,
+                           best.DefaultLeft(), 0.0f, 0.0f, 0.0f,
+                           best.loss_chg, static_cast<float>(sum_hess));
+      }
+      const int left_id = (*p_tree)[nid].LeftChild();
+      const int right_id = (*p_tree)[nid].RightChild();
+      spliteval_->AddSplit(nid, left_id, right_id, best.SplitIndex(), 0.0f, 0.0f);
+      const auto num_nodes = static_cast<size_t>(p_tree->param.num_nodes);
+      node_stats_.resize(num_nodes);
+      hist_.resize(num_nodes);
+      best_.resize(num_nodes);
+      node_stats_[left_id] = best.left_sum;
+      node_stats_[right_id].resize(ngroup_);
+      double left_hess = 0.0;
+      double right_hess = 0.0;
+      for (int k = 0; k < ngroup_; ++k) {
+        node_stats_[right_id][k].SetSubstract(node_stats_[nid][k],
+                                              node_stats_[left_id][k]);
+        left_hess += node_stats_[left_id][k].sum_hess;
+        right_hess += node_stats_[right_id][k].sum_hess;
+      }
+      this->SetNodeVector(left_id, p_tree);
+      this->SetNodeVector(right_id, p_tree);
+      split_nids.push_back(nid);
+      next_level.push_back(left_id);
+      next_level.push_back(right_id);
+      // the sums are global, so all workers build the same child
+      next_build.push_back(left_hess <= right_hess ? left_id : right_id);
+    }
+    this->ApplySplits(split_nids, gmat, *p_tree);
+    for (int nid : level) {
+      if (!(*p_tree)[nid].IsLeaf()) {
+        continue;
+      }
+      std::vector<GradStats>().swap(hist_[nid]);
+    }
+    level = std::move(next_level);
+    build = std::move(next_build);
+  }
+  hist_.clear();
+
+  pruner_->Update(gpair, p_fmat, std::vector<RegTree*>{p_tree});
+  p_last_tree_ = p_tree;
+  p_last_fmat_ = p_fmat;
+  builder_monitor_.Stop("Update");
+}
+
+bool QuantileHistMaker::MultiOutputBuilder::UpdatePredictionCache(
+    const DMatrix* data,
+    HostDeviceVector<bst_float>* p_out_preds) {
+  if (!p_last_fmat_ || !p_last_tree_ || data != p_last_fmat_) {
+    return false;
+  }
+  std::vector<bst_float>& out_preds = p_out_preds->HostVector();
+  const RegTree& tree = *p_last_tree_;
+  const auto nrow = static_cast<bst_omp_uint>(position_.size());
+  CHECK_EQ(out_preds.size(), position_.size() * ngroup_);
+#pragma omp parallel for schedule(static)
+  for (bst_omp_uint i = 0; i < nrow; ++i) {
+    int nid = position_[i];
+    // rows left out of the tree keep their prediction
+    if (nid < 0) {
+      continue;
+    }
+    // a node marked as deleted by the pruner lies below a leaf
+    while (tree[nid].IsDeleted()) {
+      nid = tree[nid].Parent();
+    }
+    const bst_float* leaf = tree.LeafVector(nid);
+    for (int k = 0; k < ngroup_; ++k) {
+      out_preds[i * ngroup_ + k] += leaf[k];
+    }
+  }
+  return true;
+}
+
+void QuantileHistMaker::MultiOutputBuilder::InitData(
+    const GHistIndexMatrix& gmat,
+    const std::vector<GradientPair>& gpair,
+    const DMatrix& fmat,
+    const RegTree& tree) {
+  CHECK_EQ(tree.param.num_nodes, tree.param.num_roots)
+      << "ColMakerHist: can only grow new tree";
+  CHECK_GT(param_.max_depth, 0)
+      << "multi_output_tree grows depthwise and needs max_depth > 0";
+  CHECK_EQ(param_.grow_policy, TrainParam::kDepthWise)
+      << "multi_output_tree only supports grow_policy=depthwise";
+  CHECK(!param_.bootstrap) << "multi_output_tree does not support bootstrap";
+  CHECK(std::all_of(param_.monotone_constraints.begin(),
+                    param_.monotone_constraints.end(),
+                    [](int c) { return c == 0; }))
+      << "multi_output_tree does not support monotone constraints";
+  const MetaInfo& info = fmat.Info();
+  CHECK_EQ(info.root_index_.size(), 0U);
+  ngroup_ = tree.param.size_leaf_vector;
+  nbins_ = gmat.NumBins();
+  feature_types_ = info.feature_types_;
+  CHECK_EQ(gpair.size(), info.num_row_ * ngroup_)
+      << "must have exactly ngroup*nrow gpairs";
+
+  if (max_nthread_ > 0) {
+    nthread_ = max_nthread_;
+  } else {
+#pragma omp parallel
+    {
+      nthread_ = omp_get_num_threads();
+    }
+  }
+  hist_allreducer_.Init(nbins_ * static_cast<uint32_t>(ngroup_), param_.hist_sync_precision);
+
+  // rows with a negative hessian are left out, as in the scalar builder
+  position_.resize(info.num_row_);
+  if (param_.subsample < 1.0f) {
+    std::bernoulli_distribution coin_flip(param_.subsample);
+    auto& rnd = common::GlobalRandom();
+    for (size_t i = 0; i < info.num_row_; ++i) {
+      position_[i] = gpair[i * ngroup_].GetHess() >= 0.0f && coin_flip(rnd) ? 0 : -1;
+    }
+  } else {
+    for (size_t i = 0; i < info.num_row_; ++i) {
+      position_[i] = gpair[i * ngroup_].GetHess() >= 0.0f ? 0 : -1;
+    }
+  }
+  std::vector<size_t>& row_indices = row_set_collection_.row_indices_;
+  row_indices.clear();
+  for (size_t i = 0; i < info.num_row_; ++i) {
+    if (position_[i] == 0) {
+      row_indices.push_back(i);
+    }
+  }
+  row_set_collection_.Clear();
+  row_set_collection_.Init();
+  column_sampler_.Init(info.num_col_, param_.colsample_bynode,
+                       param_.colsample_bylevel, param_.colsample_bytree);
+  node_stats_.assign(1, std::vector<GradStats>());
+  hist_.assign(1, std::vector<GradStats>());
+  best_.assign(1, SplitCandidate());
+}
+
+void QuantileHistMaker::MultiOutputBuilder::BuildNodeStats(
+    const std::vector<int>& nids,
+    const std::vector<GradientPair>& gpair) {
+  builder_monitor_.Start("BuildNodeStats");
+  const int nthread = nthread_;
+  const auto nrow = static_cast<bst_omp_uint>(position_.size());
+  // slot of every requested node in the thread local sums, so that the rows
+  // of all nodes are visited in one pass
+  std::vector<int> slot(node_stats_.size(), -1);
+  for (size_t j = 0; j < nids.size(); ++j) {
+    slot[nids[j]] = static_cast<int>(j);
+  }
+  const size_t nslot = nids.size() * ngroup_;
+  std::vector<GradStats> stats_tloc(nthread * nslot);
+#pragma omp parallel num_threads(nthread)
+  {
+    GradStats* stats = dmlc::BeginPtr(stats_tloc) + omp_get_thread_num() * nslot;
+#pragma omp for schedule(static)
+    for (bst_omp_uint i = 0; i < nrow; ++i) {
+      const int nid = position_[i];
+      if (nid < 0 || slot[nid] < 0) {
+        continue;
+      }
+      GradStats* node = stats + static_cast<size_t>(slot[nid]) * ngroup_;
+      for (int k = 0; k < ngroup_; ++k) {
+        node[k].Add(gpair[i * ngroup_ + k]);
+      }
+    }
+  }
+  // one allreduce for all the nodes
+  std::vector<GradStats> sums(nslot);
+  for (int tid = 0; tid < nthread; ++tid) {
+    for (size_t j = 0; j < nslot; ++j) {
+      sums[j].Add(stats_tloc[tid * nslot + j]);
+    }
+  }
+  histred_.Allreduce(dmlc::BeginPtr(sums), nslot);
+  for (size_t j = 0; j < nids.size(); ++j) {
+    node_stats_[nids[j]].assign(sums.begin() + j * ngroup_,
+                                sums.begin() + (j + 1) * ngroup_);
+  }
+  builder_monitor_.Stop("BuildNodeStats");
+}
+
+void QuantileHistMaker::MultiOutputBuilder::BuildHistograms(
+    const std::vector<int>& nids,
+    const GHistIndexMatrix& gmat,
+    const ColumnMatrix& column_matrix,
+    const std::vector<GradientPair>& gpair) {
+  if (nids.empty()) {
+    return;
+  }
+  builder_monitor_.Start("BuildHistograms");
+  for (int nid : nids) {
+    hist_[nid].assign(static_cast<size_t>(nbins_) * ngroup_, GradStats());
+  }
+  // every thread owns the bins of its features and visits the rows of all
+  // built nodes of the level; the rows of a node are sorted, so the entries
+  // of a sparse column are found by skipping ahead with a binary search
+  const int ngroup = ngroup_;
+  const auto nfeature = static_cast<bst_omp_uint>(column_matrix.GetNumFeature());
+#pragma omp parallel for num_threads(nthread_) schedule(dynamic)
+  for (bst_omp_uint fid = 0; fid < nfeature; ++fid) {
+    const Column column = column_matrix.GetColumn(fid);
+    const size_t* col_begin = column.GetRowData();
+    const size_t* col_end = col_begin + column.Size();
+    for (int nid : nids) {
+      const RowSetCollection::Elem rows = row_set_collection_[nid];
+      GradStats* hist = dmlc::BeginPtr(hist_[nid]);
+      if (column.GetType() == xgboost::common::kDenseColumn) {
+        for (const size_t* it = rows.begin; it != rows.end; ++it) {
+          if (column.IsMissing(*it)) {
+            continue;
+          }
+          GradStats* bin = hist + static_cast<size_t>(column.GetGlobalBinIdx(*it)) * ngroup;
+          const GradientPair* g = &gpair[*it * ngroup];
+          for (int k = 0; k < ngroup; ++k) {
+            bin[k].Add(g[k]);
+          }
+        }
+      } else {
+        const size_t* p = col_begin;
+        for (const size_t* it = rows.begin; it != rows.end && p != col_end; ++it) {
+          p = std::lower_bound(p, col_end, *it);
+          if (p == col_end || *p != *it) {
+            continue;
+          }
+          GradStats* bin = hist +
+              static_cast<size_t>(column.GetGlobalBinIdx(p - col_begin)) * ngroup;
+          const GradientPair* g = &gpair[*it * ngroup];
+          for (int k = 0; k < ngroup; ++k) {
+            bin[k].Add(g[k]);
+          }
+          ++p;
+        }
+      }
+    }
+  }
+  // the histograms of the level in one allreduce
+  if (rabit::IsDistributed()) {
+    std::vector<GHistRow> hists;
+    for (int nid : nids) {
+      hists.emplace_back(dmlc::BeginPtr(hist_[nid]),
+                         static_cast<GHistRow::index_type>(hist_[nid].size()));
+    }
+    hist_allreducer_.Allreduce(hists);
+  }
+  builder_monitor_.Stop("BuildHistograms");
+}
+
+double QuantileHistMaker::MultiOutputBuilder::NodeGain(
+    int parentid, const GradStats* stats) const {
+  double gain = 0.0;
+  for (int k = 0; k < ngroup_; ++k) {
+    gain += spliteval_->ComputeScore(parentid, stats[k],
+                                     spliteval_->ComputeWeight(parentid, stats[k]));
+  }
+  return gain;
+}
+
+void QuantileHistMaker::MultiOutputBuilder::EvaluateSplits(
+    const std::vector<int>& nids,
+    const GHistIndexMatrix& gmat,
+    const RegTree& tree) {
+  builder_monitor_.Start("EvaluateSplits");
+  // one feature set per node, drawn in node order on every worker
+  std::vector<std::shared_ptr<HostDeviceVector<int>>> feature_sets;
+  std::vector<size_t> task_ptr(1, 0);
+  std::vector<bst_float> root_gain;
+  for (int nid : nids) {
+    feature_sets.push_back(column_sampler_.GetFeatureSet(tree.GetDepth(nid)));
+    task_ptr.push_back(task_ptr.back() + feature_sets.back()->Size());
+    root_gain.push_back(static_cast<bst_float>(
+        this->NodeGain(tree[nid].Parent(), dmlc::BeginPtr(node_stats_[nid]))));
+  }
+  const int nthread = nthread_;
+  // histograms over the bins of the features; a bundled histogram is over the
+  // bins of the feature bundles and is unbundled first
+  std::vector<const GradStats*> node_hist(nids.size());
+  std::vector<std::vector<GradStats>> hist_unbundled(gmat.IsBundled() ? nids.size() : 0);
+  for (size_t i = 0; i < nids.size(); ++i) {
+    node_hist[i] = dmlc::BeginPtr(hist_[nids[i]]);
+    if (gmat.IsBundled()) {
+      hist_unbundled[i].resize(static_cast<size_t>(gmat.cut.row_ptr.back()) * ngroup_);
+      const std::vector<int>& feature_set = feature_sets[i]->ConstHostVector();
+      const auto nfeature = static_cast<bst_omp_uint>(feature_set.size());
+#pragma omp parallel for schedule(static) num_threads(nthread)
+      for (bst_omp_uint j = 0; j < nfeature; ++j) {
+        gmat.UnbundleHist(static_cast<bst_uint>(feature_set[j]), node_hist[i],
+                          dmlc::BeginPtr(node_stats_[nids[i]]), ngroup_,
+                          dmlc::BeginPtr(hist_unbundled[i]));
+      }
+      node_hist[i] = dmlc::BeginPtr(hist_unbundled[i]);
+    }
+  }
+  std::vector<SplitCandidate> best_tloc(nthread * nids.size());
+  const auto ntask = static_cast<bst_omp_uint>(task_ptr.back());
+#pragma omp parallel num_threads(nthread)
+  {
+    std::vector<GradStats> left(ngroup_);
+    std::vector<GradStats> right(ngroup_);
+    const int tid = omp_get_thread_num();
+#pragma omp for schedule(dynamic)
+    for (bst_omp_uint t = 0; t < ntask; ++t) {
+      const size_t i = std::upper_bound(task_ptr.begin(), task_ptr.end(), t) -
+                       task_ptr.begin() - 1;
+      const int nid = nids[i];
+      const auto fid = static_cast<bst_uint>(
+          feature_sets[i]->ConstHostVector()[t - task_ptr[i]]);
+      if (!spliteval_->CheckFeatureConstraint(nid, fid)) {
+        continue;
+      }
+      SplitCandidate* p_best = &best_tloc[tid * nids.size() + i];
+      if (fid < feature_types_.size() &&
+          feature_types_[fid] == FeatureType::kCategorical) {
+        this->EnumerateCategories(nid, fid, root_gain[i], gmat, node_hist[i],
+                                  &right, p_best);
+      } else {
+        this->EnumerateSplit(nid, fid, +1, root_gain[i], gmat, node_hist[i],
+                             &left, &right, p_best);
+        this->EnumerateSplit(nid, fid, -1, root_gain[i], gmat, node_hist[i],
+                             &left, &right, p_best);
+      }
+    }
+  }
+  for (size_t i = 0; i < nids.size(); ++i) {
+    SplitCandidate& best = best_[nids[i]];
+    best = SplitCandidate();
+    for (int tid = 0; tid < nthread; ++tid) {
+      const SplitCandidate& e = best_tloc[tid * nids.size() + i];
+      if (!e.left_sum.empty() && best.NeedReplace(e.loss_chg, e.SplitIndex())) {
+        best = e;
+      }
+    }
+  }
+  builder_monitor_.Stop("EvaluateSplits");
+}
+
+void QuantileHistMaker::MultiOutputBuilder::EnumerateSplit(
+    int nid, bst_uint fid, int d_step, bst_float root_gain,
+    const GHistIndexMatrix& gmat,
+    const GradStats* hist,
+    std::vector<GradStats>* p_left,
+    std::vector<GradStats>* p_right,
+    SplitCandidate* p_best) const {
+  CHECK(d_step == +1 || d_step == -1);
+  const std::vector<uint32_t>& cut_ptr = gmat.cut.row_ptr;
+  const std::vector<bst_float>& cut_val = gmat.cut.cut;
+  const GradStats* node_sum = dmlc::BeginPtr(node_stats_[nid]);
+  // e accumulates the bins visited so far, c holds the other rows
+  std::vector<GradStats>& e = *p_left;
+  std::vector<GradStats>& c = *p_right;
+  std::fill(e.begin(), e.end(), GradStats());
+
+  const auto imin = static_cast<int32_t>(cut_ptr[fid]);
+  int32_t ibegin, iend;
+  if (d_step > 0) {
+    ibegin = static_cast<int32_t>(cut_ptr[fid]);
+    iend = static_cast<int32_t>(cut_ptr[fid + 1]);
+  } else {
+    ibegin = static_cast<int32_t>(cut_ptr[fid + 1]) - 1;
+    iend = static_cast<int32_t>(cut_ptr[fid]) - 1;
+  }
+  for (int32_t i = ibegin; i != iend; i += d_step) {
+    double e_hess = 0.0;
+    double c_hess = 0.0;
+    for (int k = 0; k < ngroup_; ++k) {
+      e[k].Add(hist[static_cast<size_t>(i) * ngroup_ + k]);
+      c[k].SetSubstract(node_sum[k], e[k]);
+      e_hess += e[k].sum_hess;
+      c_hess += c[k].sum_hess;
+    }
+    if (e_hess < param_.min_child_weight || c_hess < param_.min_child_weight) {
+      continue;
+    }
+    // forward enumeration sends missing values right, backward sends them left
+    const std::vector<GradStats>& left = d_step > 0 ? e : c;
+    const std::vector<GradStats>& right = d_step > 0 ? c : e;
+    double score = 0.0;
+    for (int k = 0; k < ngroup_; ++k) {
+      score += spliteval_->ComputeSplitScore(nid, fid, left[k], right[k]);
+    }
+    const auto loss_chg = static_cast<bst_float>(score - root_gain);
+    if (p_best->NeedReplace(loss_chg, fid)) {
+      p_best->loss_chg = loss_chg;
+      p_best->sindex = d_step > 0 ? fid : (fid | (1U << 31));
+      p_best->is_cat = false;
+      if (d_step > 0) {
+        p_best->split_value = cut_val[i];
+        p_best->split_bin = i;
+      } else {
+        // split at the left bound of bin i
+        p_best->split_value = i == imin ? gmat.cut.min_val[fid] : cut_val[i - 1];
+        p_best->split_bin = i - 1;
+      }
+      p_best->left_sum = left;
+    }
+  }
+}
+
+void QuantileHistMaker::MultiOutputBuilder::EnumerateCategories(
+    int nid, bst_uint fid, bst_float root_gain,
+    const GHistIndexMatrix& gmat,
+    const GradStats* hist,
+    std::vector<GradStats>* p_right,
+    SplitCandidate* p_best) const {
+  const GradStats* node_sum = dmlc::BeginPtr(node_stats_[nid]);
+  std::vector<GradStats>& right = *p_right;
+  const auto ibegin = static_cast<int32_t>(gmat.cut.row_ptr[fid]);
+  const auto iend = static_cast<int32_t>(gmat.cut.row_ptr[fid + 1]);
+  // one category against all others, missing values go right
+  for (int32_t i = ibegin; i != iend; ++i) {
+    const GradStats* left = hist + static_cast<size_t>(i) * ngroup_;
+    double left_hess = 0.0;
+    double right_hess = 0.0;
+    for (int k = 0; k < ngroup_; ++k) {
+      right[k].SetSubstract(node_sum[k], left[k]);
+      left_hess += left[k].sum_hess;
+      right_hess += right[k].sum_hess;
+    }
+    if (left_hess < param_.min_child_weight ||
+        right_hess < param_.min_child_weight) {
+      continue;
+    }
+    double score = 0.0;
+    for (int k = 0; k < ngroup_; ++k) {
+      score += spliteval_->ComputeSplitScore(nid, fid, left[k], right[k]);
+    }
+    const auto loss_chg = static_cast<bst_float>(score - root_gain);
+    if (p_best->NeedReplace(loss_chg, fid)) {
+      p_best->loss_chg = loss_chg;
+      p_best->sindex = fid;
+      p_best->is_cat = true;
+      p_best->split_value = static_cast<bst_float>(i - ibegin);
+      p_best->split_bin = i;
+      p_best->left_sum.assign(left, left + ngroup_);
+    }
+  }
+}
+
+void QuantileHistMaker::MultiOutputBuilder::ApplySplits(
+    const std::vector<int>& nids,
+    const GHistIndexMatrix& gmat,
+    const RegTree& tree) {
+  if (nids.empty()) {
+    return;
+  }
+  builder_monitor_.Start("ApplySplits");
+  const auto nthread = static_cast<bst_omp_uint>(nthread_);
+  row_split_tloc_.resize(nthread);
+  const std::vector<uint32_t>& col_ptr = gmat.ColumnPtr();
+  for (int nid : nids) {
+    const SplitCandidate& split = best_[nid];
+    const bst_uint fid = split.SplitIndex();
+    const uint32_t lower = gmat.cut.row_ptr[fid];
+    const uint32_t upper = gmat.cut.row_ptr[fid + 1];
+    const bst_uint col = gmat.FeatureColumn(fid);
+    const int left_id = tree[nid].LeftChild();
+    const int right_id = tree[nid].RightChild();
+    const RowSetCollection::Elem rowset = row_set_collection_[nid];
+    const size_t nrows = rowset.Size();
+    // every thread partitions a contiguous range, so the rows stay sorted
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+      auto& left = row_split_tloc_[tid].left;
+      auto& right = row_split_tloc_[tid].right;
+      left.clear();
+      right.clear();
+      const size_t iend = (tid + 1) * nrows / nthread;
+      for (size_t i = tid * nrows / nthread; i < iend; ++i) {
+        const size_t rid = rowset.begin[i];
+        // the bins of a row are sorted, so its bin in the column of fid is
+        // found by search
+        const uint32_t* begin = dmlc::BeginPtr(gmat.index) + gmat.row_ptr[rid];
+        const uint32_t* end = dmlc::BeginPtr(gmat.index) + gmat.row_ptr[rid + 1];
+        const uint32_t* it = std::lower_bound(begin, end, col_ptr[col]);
+        uint32_t bin = GHistIndexMatrix::kNoBin;
+        if (it != end && *it < col_ptr[col + 1]) {
+          bin = gmat.IsBundled() ? gmat.cut_bin[*it] : *it;
+        }
+        // rows in the bins of the other features of a bundle, or without an
+        // entry, lie in the default of fid
+        if (bin < lower || bin >= upper) {
+          bin = gmat.IsBundled() ? gmat.default_bin[fid] : GHistIndexMatrix::kNoBin;
+        }
+        bool go_left;
+        if (bin != GHistIndexMatrix::kNoBin) {
+          go_left = split.is_cat ? static_cast<int32_t>(bin) == split.split_bin
+                                 : static_cast<int32_t>(bin) <= split.split_bin;
+        } else {
+          go_left = split.DefaultLeft();
+        }
+        position_[rid] = go_left ? left_id : right_id;
+        if (go_left) {
+          left.push_back(rid);
+        } else {
+          right.push_back(rid);
+        }
+      }
+    }
+    row_set_collection_.AddSplit(nid, row_split_tloc_, left_id, right_id);
+  }
+  builder_monitor_.Stop("ApplySplits");
+}
+
+void QuantileHistMaker::MultiOutputBuilder::SetNodeVector(int nid, RegTree* p_tree) {
+  const auto parentid = static_cast<bst_uint>((*p_tree)[nid].Parent());
+  std::vector<bst_float> weight(ngroup_);
+  double sum_hess = 0.0;
+  for (int k = 0; k < ngroup_; ++k) {
+    weight[k] = spliteval_->ComputeWeight(parentid, node_stats_[nid][k]) *
+                param_.learning_rate;
+    sum_hess += node_stats_[nid][k].sum_hess;
+  }
+  p_tree->SetLeafVector(nid, dmlc::BeginPtr(weight));
+  p_tree->Stat(nid).sum_hess = static_cast<bst_float>(sum_hess);
+}
+
 XGBOOST_REGISTER_TREE_UPDATER(FastHistMaker, "grow_fast_histmaker")
 .describe("(Deprecated, use grow_quantile_histmaker instead.)"
           " Grow tree using quantized histogram.")
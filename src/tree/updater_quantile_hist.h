@@ -98,6 +98,64 @@ class QuantileHistMaker: public TreeUpdater {
   // column accessor
   ColumnMatrix column_matrix_;
   bool is_gmat_initialized_;
+  // configuration used to initialize the pruners of additional builders
+  std::vector<std::pair<std::string, std::string> > cfg_;
+
+  /*!
+   * \brief rows of an evaluation matrix quantized with the cuts of gmat_, so
+   *  that its prediction cache is updated with integer comparisons only.
+   *  The bins are kept in the narrowest of bin8, bin16 and bin32 that holds
+   *  every bin and the missing value, the largest value of the type. They are
+   *  stored densely, nfeature per row, unless the entries take less memory.
+   */
+  struct QuantizedEvalRows {
+    size_t num_row {0};
+    /*! \brief number of entries of the matrix, checked on every use */
+    uint64_t num_nonzero {0};
+    bool dense {false};
+    /*! \brief row pointer into fidx and the bins, empty when dense */
+    std::vector<size_t> row_ptr;
+    /*! \brief feature index of each present entry, empty when dense */
+    std::vector<bst_uint> fidx;
+    /*! \brief position of each entry among the cuts, see EvalBin */
+    std::vector<uint8_t> bin8;
+    std::vector<uint16_t> bin16;
+    std::vector<uint32_t> bin32;
+    /*! \brief number of the update that last used the rows */
+    size_t last_update {0};
+  };
+  // feature types of the training matrix, fixed together with gmat_
+  std::vector<FeatureType> feature_types_;
+  // matrix and tree of the last update, used for the evaluation matrices
+  const DMatrix* p_last_dmat_ {nullptr};
+  const RegTree* p_last_tree_ {nullptr};
+  // quantized evaluation matrices, built on their first cache update. The
+  // predictor updates all of its cached matrices after every update, so the
+  // rows not used since the previous update belong to no cache and are freed.
+  // A matrix whose shape differs from its entry is quantized again, in case a
+  // new matrix took the address of a freed one.
+  std::unordered_map<const DMatrix*, QuantizedEvalRows> eval_rows_;
+  size_t num_updates_ {0};
+
+  /*!
+   * \brief position of fvalue among the cuts of feature fid preceded by its
+   *  min_val, i.e. the index of the first of them that is greater than fvalue.
+   *  Categorical values map to their category id plus one, 0 for negative ids.
+   */
+  uint32_t EvalBin(bst_uint fid, bst_float fvalue) const;
+  void QuantizeEvalRows(DMatrix* dmat, QuantizedEvalRows* out) const;
+  template <typename BinT>
+  void QuantizeEvalRows(DMatrix* dmat, QuantizedEvalRows* out,
+                        std::vector<BinT>* p_bins) const;
+  // route every row through the last tree and add its leaf to out_preds
+  template <typename BinT>
+  void PredictEvalRows(const QuantizedEvalRows& rows, const std::vector<BinT>& bins,
+                       const std::vector<uint32_t>& threshold,
+                       std::vector<bst_float>* out_preds) const;
+  // add the leaf values of the last tree to the predictions of an evaluation
+  // matrix, return false when the tree cannot be routed on quantized rows
+  bool UpdateEvalPredictionCache(const DMatrix* data,
+                                 HostDeviceVector<bst_float>* out_preds);
 
   // data structure
   struct NodeEntry {
@@ -138,20 +196,31 @@ class QuantileHistMaker: public TreeUpdater {
                           const RowSetCollection::Elem row_indices,
                           const GHistIndexMatrix& gmat,
                           const GHistIndexBlockMatrix& gmatb,
+                          const ColumnMatrix& column_matrix,
                           GHistRow hist,
                           bool sync_hist) {
       builder_monitor_.Start("BuildHist");
+      const uint8_t* multiplicity = param_.bootstrap ? row_multiplicity_.data() : nullptr;
       if (param_.enable_feature_grouping > 0) {
-        hist_builder_.BuildBlockHist(gpair, row_indices, gmatb, hist);
+        hist_builder_.BuildBlockHist(gpair, row_indices, gmatb, hist, multiplicity);
+      } else if (UseColumnWiseHist(row_indices.Size(), gmat)) {
+        hist_builder_.BuildHistColumnWise(gpair, row_indices, column_matrix, hist,
+                                          multiplicity);
       } else {
-        hist_builder_.BuildHist(gpair, row_indices, gmat, hist);
+        hist_builder_.BuildHist(gpair, row_indices, gmat, hist, multiplicity);
       }
-      if (sync_hist) {
-        this->histred_.Allreduce(hist.data(), hist_builder_.GetNumBins());
+      if (sync_hist && rabit::IsDistributed()) {
+        hist_allreducer_.Allreduce({hist});
       }
       builder_monitor_.Stop("BuildHist");
     }
 
+    // whether a node with nrows rows is cheaper to build feature by feature,
+    // rather than row by row with one private histogram per thread
+    bool UseColumnWiseHist(size_t nrows, const GHistIndexMatrix& gmat) const;
+    // private histograms of all threads up to this size are built row-wise
+    static constexpr size_t kHistCacheBytes = size_t(1) << 20;
+
     inline void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
       builder_monitor_.Start("SubtractionTrick");
       hist_builder_.SubtractionTrick(self, sibling, parent);
@@ -161,6 +230,11 @@ class QuantileHistMaker: public TreeUpdater {
     bool UpdatePredictionCache(const DMatrix* data,
                                HostDeviceVector<bst_float>* p_out_preds);
 
+    /*! \brief limit the number of threads used by this builder, 0 means no limit */
+    void SetMaxThreads(int nthread) {
+      max_nthread_ = nthread;
+    }
+
    protected:
     /* tree growing policies */
     struct ExpandEntry {
@@ -178,6 +252,11 @@ class QuantileHistMaker: public TreeUpdater {
                   const DMatrix& fmat,
                   const RegTree& tree);
 
+    // draw a bootstrap sample, fills row_multiplicity_ and the row indices
+    void InitBootstrap(const std::vector<GradientPair>& gpair,
+                       const MetaInfo& info,
+                       std::vector<size_t>* p_row_indices);
+
     void EvaluateSplit(const int nid,
                        const GHistIndexMatrix& gmat,
                        const HistCollection& hist,
@@ -207,6 +286,14 @@ class QuantileHistMaker: public TreeUpdater {
                               bst_int split_cond,
                               bool default_left);
 
+    // partition the rows of a node by the bin of each row in column; left_bins
+    // marks, per bin of the column, whether it goes left
+    void ApplySplitBinLookup(const RowSetCollection::Elem rowset,
+                             std::vector<RowSetCollection::Split>* p_row_split_tloc,
+                             const Column& column,
+                             const std::vector<uint8_t>& left_bins,
+                             bool default_left);
+
     void InitNewNode(int nid,
                      const GHistIndexMatrix& gmat,
                      const std::vector<GradientPair>& gpair,
@@ -223,6 +310,21 @@ class QuantileHistMaker: public TreeUpdater {
                         bst_uint fid,
                         bst_uint nodeID);
 
+    // order the non-empty bins of a categorical feature by gradient ratio
+    void SortCategories(const GHistIndexMatrix& gmat,
+                        const GHistRow& hist,
+                        bst_uint fid,
+                        std::vector<uint32_t>* p_order) const;
+
+    // enumerate the category partitions of a categorical feature; the split
+    // value of a candidate is the number of sorted bins sent left
+    void EnumerateCategoricalSplit(const GHistIndexMatrix& gmat,
+                                   const GHistRow& hist,
+                                   const NodeEntry& snode,
+                                   SplitEntry* p_best,
+                                   bst_uint fid,
+                                   bst_uint nodeID);
+
     void ExpandWithDepthWidth(const GHistIndexMatrix &gmat,
                               const GHistIndexBlockMatrix &gmatb,
                               const ColumnMatrix &column_matrix,
@@ -230,17 +332,23 @@ class QuantileHistMaker: public TreeUpdater {
                               RegTree *p_tree,
                               const std::vector<GradientPair> &gpair_h);
 
-    void BuildLocalHistograms(int *starting_index,
-                              int *sync_count,
+    // build the histograms of a level that cannot be obtained by subtraction;
+    // their node ids are appended to sync_nids
+    void BuildLocalHistograms(std::vector<int> *sync_nids,
                               const GHistIndexMatrix &gmat,
                               const GHistIndexBlockMatrix &gmatb,
+                              const ColumnMatrix &column_matrix,
                               RegTree *p_tree,
                               const std::vector<GradientPair> &gpair_h);
 
-    void SyncHistograms(int starting_index,
-                        int sync_count,
+    void SyncHistograms(const std::vector<int> &sync_nids,
                         RegTree *p_tree);
 
+    // in distributed mode, whether the histogram of nid is built and its
+    // sibling's derived. Decided on the global hessian sums of the parent's
+    // split, so that all workers pick the same child.
+    bool IsBuiltSibling(int nid, const RegTree &tree) const;
+
     void BuildNodeStats(const GHistIndexMatrix &gmat,
                         DMatrix *p_fmat,
                         RegTree *p_tree,
@@ -274,12 +382,16 @@ class QuantileHistMaker: public TreeUpdater {
     const TrainParam& param_;
     // number of omp thread used during training
     int nthread_;
+    // upper bound on nthread_, set when several trees are grown concurrently
+    int max_nthread_{0};
     common::ColumnSampler column_sampler_;
     // the internal row sets
     RowSetCollection row_set_collection_;
     // the temp space for split
     std::vector<RowSetCollection::Split> row_split_tloc_;
     std::vector<SplitEntry> best_split_tloc_;
+    // histogram of a node over the bins of the features, when gmat is bundled
+    std::vector<GradStats> hist_unbundled_;
     /*! \brief TreeNode Data: statistics for each constructed node */
     std::vector<NodeEntry> snode_;
     /*! \brief culmulative histogram of gradients. */
@@ -287,10 +399,13 @@ class QuantileHistMaker: public TreeUpdater {
     /*! \brief feature with least # of bins. to be used for dense specialization
                of InitNewNode() */
     uint32_t fid_least_bins_;
+    /*! \brief number of times each row is drawn into the bootstrap sample */
+    std::vector<uint8_t> row_multiplicity_;
     /*! \brief local prediction cache; maps node id to leaf value */
     std::vector<float> leaf_value_cache_;
 
     GHistBuilder hist_builder_;
+    common::GHistAllreducer hist_allreducer_;
     std::unique_ptr<TreeUpdater> pruner_;
     std::unique_ptr<SplitEvaluator> spliteval_;
 
@@ -315,7 +430,136 @@ class QuantileHistMaker: public TreeUpdater {
     rabit::Reducer<GradStats, GradStats::Reduce> histred_;
   };
 
-  std::unique_ptr<Builder> builder_;
+  /*!
+   * \brief grows vector trees, whose nodes hold one output per output group.
+   *  Each bin of a histogram sums the gradients of all groups, so a level is
+   *  built in one pass over the columns for all groups; a split is scored by
+   *  its gain summed over the groups.
+   */
+  struct MultiOutputBuilder {
+   public:
+    MultiOutputBuilder(const TrainParam& param,
+                       std::unique_ptr<TreeUpdater> pruner,
+                       std::unique_ptr<SplitEvaluator> spliteval)
+      : param_(param), pruner_(std::move(pruner)),
+        spliteval_(std::move(spliteval)) {
+      builder_monitor_.Init("Quantile::MultiOutputBuilder");
+    }
+    // grow one vector tree; gpair holds size_leaf_vector pairs per row
+    void Update(const GHistIndexMatrix& gmat,
+                const ColumnMatrix& column_matrix,
+                HostDeviceVector<GradientPair>* gpair,
+                DMatrix* p_fmat,
+                RegTree* p_tree);
+
+    bool UpdatePredictionCache(const DMatrix* data,
+                               HostDeviceVector<bst_float>* p_out_preds);
+
+    /*! \brief limit the number of threads used by this builder, 0 means no limit */
+    void SetMaxThreads(int nthread) {
+      max_nthread_ = nthread;
+    }
+
+   protected:
+    // best split of a node, with the gradient sums of its left child
+    struct SplitCandidate {
+      bst_float loss_chg{0.0f};
+      unsigned sindex{0};
+      bst_float split_value{0.0f};
+      // the last bin sent left, or the category bin sent left
+      int32_t split_bin{-1};
+      bool is_cat{false};
+      std::vector<GradStats> left_sum;
+      // same tie breaking as SplitEntry
+      inline bool NeedReplace(bst_float new_loss_chg, unsigned split_index) const {
+        if (this->SplitIndex() <= split_index) {
+          return new_loss_chg > this->loss_chg;
+        } else {
+          return !(this->loss_chg > new_loss_chg);
+        }
+      }
+      inline unsigned SplitIndex() const { return sindex & ((1U << 31) - 1U); }
+      inline bool DefaultLeft() const { return (sindex >> 31) != 0; }
+    };
+
+    void InitData(const GHistIndexMatrix& gmat,
+                  const std::vector<GradientPair>& gpair,
+                  const DMatrix& fmat,
+                  const RegTree& tree);
+    // sums of the gradients of every group over the rows of each node in nids
+    void BuildNodeStats(const std::vector<int>& nids,
+                        const std::vector<GradientPair>& gpair);
+    // histograms of the nodes in nids from their rows, in one pass over the
+    // columns
+    void BuildHistograms(const std::vector<int>& nids,
+                         const GHistIndexMatrix& gmat,
+                         const ColumnMatrix& column_matrix,
+                         const std::vector<GradientPair>& gpair);
+    // score of a node with the given sums, summed over the groups
+    double NodeGain(int parentid, const GradStats* stats) const;
+    void EvaluateSplits(const std::vector<int>& nids,
+                        const GHistIndexMatrix& gmat,
+                        const RegTree& tree);
+    // hist is the histogram of nid over the bins of the features
+    void EnumerateSplit(int nid, bst_uint fid, int d_step, bst_float root_gain,
+                        const GHistIndexMatrix& gmat,
+                        const GradStats* hist,
+                        std::vector<GradStats>* p_left,
+                        std::vector<GradStats>* p_right,
+                        SplitCandidate* p_best) const;
+    // splits of a categorical feature that send one category left
+    void EnumerateCategories(int nid, bst_uint fid, bst_float root_gain,
+                             const GHistIndexMatrix& gmat,
+                             const GradStats* hist,
+                             std::vector<GradStats>* p_right,
+                             SplitCandidate* p_best) const;
+    // move the rows of the split nodes to their children
+    void ApplySplits(const std::vector<int>& nids,
+                     const GHistIndexMatrix& gmat,
+                     const RegTree& tree);
+    // set the leaf vector of nid to the weights of its sums
+    void SetNodeVector(int nid, RegTree* p_tree);
+
+    const TrainParam& param_;
+    std::unique_ptr<TreeUpdater> pruner_;
+    std::unique_ptr<SplitEvaluator> spliteval_;
+    common::ColumnSampler column_sampler_;
+    // number of output groups
+    int ngroup_{0};
+    uint32_t nbins_{0};
+    std::vector<FeatureType> feature_types_;
+    int nthread_{1};
+    // upper bound on nthread_
+    int max_nthread_{0};
+    // node id of each row, -1 for rows left out by subsampling
+    std::vector<int> position_;
+    // the rows of each node, sorted by index
+    RowSetCollection row_set_collection_;
+    std::vector<RowSetCollection::Split> row_split_tloc_;
+    // per node: sums of each group, the histogram with ngroup_ entries per
+    // bin (kept until the children are built) and the best split
+    std::vector<std::vector<GradStats>> node_stats_;
+    std::vector<std::vector<GradStats>> hist_;
+    std::vector<SplitCandidate> best_;
+    const RegTree* p_last_tree_{nullptr};
+    const DMatrix* p_last_fmat_{nullptr};
+    common::Monitor builder_monitor_;
+    rabit::Reducer<GradStats, GradStats::Reduce> histred_;
+    // sums the histograms of a level across workers
+    common::GHistAllreducer hist_allreducer_;
+  };
+
+  // grow the trees of one round concurrently, one builder per tree; the
+  // random engine of each tree's thread is seeded with seeds[i], drawn on the
+  // calling thread so that the row subsampling does not depend on the schedule
+  void UpdateConcurrent(HostDeviceVector<GradientPair>* gpair,
+                        DMatrix* dmat,
+                        const std::vector<RegTree*>& trees,
+                        const std::vector<uint32_t>& seeds,
+                        int nthread);
+
+  std::vector<std::unique_ptr<Builder>> builders_;
+  std::unique_ptr<MultiOutputBuilder> multi_builder_;
   std::unique_ptr<TreeUpdater> pruner_;
   std::unique_ptr<SplitEvaluator> spliteval_;
 };
@@ -30,6 +30,11 @@ class TreeRefresher: public TreeUpdater {
               const std::vector<RegTree*> &trees) override {
     if (trees.size() == 0) return;
     const std::vector<GradientPair> &gpair_h = gpair->ConstHostVector();
+    // offset of the node statistics of each tree in the flat arrays
+    std::vector<size_t> tree_offset(trees.size() + 1, 0);
+    for (size_t i = 0; i < trees.size(); ++i) {
+      tree_offset[i + 1] = tree_offset[i] + trees[i]->param.num_nodes;
+    }
     // thread temporal space
     std::vector<std::vector<GradStats> > stemp;
     std::vector<RegTree::FVec> fvec_temp;
@@ -40,11 +45,7 @@ class TreeRefresher: public TreeUpdater {
     #pragma omp parallel
     {
       int tid = omp_get_thread_num();
-      int num_nodes = 0;
-      for (auto tree : trees) {
-        num_nodes += tree->param.num_nodes;
-      }
-      stemp[tid].resize(num_nodes, GradStats());
+      stemp[tid].resize(tree_offset.back(), GradStats());
       std::fill(stemp[tid].begin(), stemp[tid].end(), GradStats());
       fvec_temp[tid].Init(trees[0]->param.num_feature);
     }
@@ -63,11 +64,9 @@ class TreeRefresher: public TreeUpdater {
           const auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
           RegTree::FVec &feats = fvec_temp[tid];
           feats.Fill(inst);
-          int offset = 0;
-          for (auto tree : trees) {
-            AddStats(*tree, feats, gpair_h, info, ridx,
-                     dmlc::BeginPtr(stemp[tid]) + offset);
-            offset += tree->param.num_nodes;
+          for (size_t t = 0; t < trees.size(); ++t) {
+            AddStats(*trees[t], feats, gpair_h, info, ridx,
+                     dmlc::BeginPtr(stemp[tid]) + tree_offset[t]);
           }
           feats.Drop(inst);
         }
@@ -85,12 +84,10 @@ class TreeRefresher: public TreeUpdater {
     // rescale learning rate according to size of trees
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
-    int offset = 0;
-    for (auto tree : trees) {
-      for (int rid = 0; rid < tree->param.num_roots; ++rid) {
-        this->Refresh(dmlc::BeginPtr(stemp[0]) + offset, rid, tree);
+    for (size_t t = 0; t < trees.size(); ++t) {
+      for (int rid = 0; rid < trees[t]->param.num_roots; ++rid) {
+        this->Refresh(dmlc::BeginPtr(stemp[0]) + tree_offset[t], rid, trees[t]);
       }
-      offset += tree->param.num_nodes;
     }
     // set learning rate back
     param_.learning_rate = lr;
@@ -0,0 +1,55 @@
+"""Run benchmark on batch prediction of the tree booster."""
+
+import argparse
+import time
+
+import numpy as np
+import xgboost as xgb
+
+RNG = np.random.RandomState(1994)
+
+
+def run_benchmark(args):
+    """Runs the benchmark."""
+    print("Generating dataset: {} rows * {} columns".format(args.rows, args.columns))
+    X = RNG.rand(args.rows, args.columns)
+    y = RNG.randint(0, 2, args.rows)
+    if 0.0 < args.sparsity < 1.0:
+        X[RNG.uniform(0, 1, X.shape) < args.sparsity] = np.nan
+    dtrain = xgb.DMatrix(X, y, nthread=-1)
+    dtest = xgb.DMatrix(X, nthread=-1)
+
+    # shallow and deep trees, small and large forests
+    for max_depth in args.depths:
+        param = {'objective': 'binary:logistic', 'tree_method': 'hist',
+                 'max_depth': max_depth, 'eta': 0.1}
+        bst = xgb.train(param, dtrain, max(args.trees))
+        for ntrees in args.trees:
+            bst.predict(dtest, ntree_limit=ntrees)
+            tmp = time.time()
+            for _ in range(args.repeats):
+                bst.predict(dtest, ntree_limit=ntrees)
+            elapsed = (time.time() - tmp) / args.repeats
+            print("max_depth={} trees={}: {:.4f} seconds per prediction".format(
+                max_depth, ntrees, elapsed))
+
+
+def main():
+    """The main function.
+
+    Defines and parses command line arguments and calls the benchmark.
+    """
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--sparsity', type=float, default=0.0)
+    parser.add_argument('--rows', type=int, default=100000)
+    parser.add_argument('--columns', type=int, default=50)
+    parser.add_argument('--depths', type=int, nargs='+', default=[3, 10])
+    parser.add_argument('--trees', type=int, nargs='+', default=[100, 2000])
+    parser.add_argument('--repeats', type=int, default=3)
+    args = parser.parse_args()
+
+    run_benchmark(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -3,6 +3,8 @@
 #include <xgboost/c_api.h>
 #include <xgboost/data.h>
 
+#include <thread>
+
 TEST(c_api, XGDMatrixCreateFromMatDT) {
   std::vector<int> col0 = {0, -1, 3};
   std::vector<float> col1 = {-4.0f, 2.0f, 0.0f};
@@ -63,3 +65,219 @@ TEST(c_api, XGDMatrixCreateFromMat_omp) {
     delete dmat;
   }
 }
+
+TEST(c_api, XGBoosterPredictFromDense) {
+  const int kRows = 300, kCols = 6;
+  std::vector<float> data(kRows * kCols);
+  std::vector<float> labels(kRows);
+  for (int i = 0; i < kRows; ++i) {
+    for (int j = 0; j < kCols; ++j) {
+      data[i * kCols + j] = static_cast<float>((i * 7 + j * 13) % 17) - 8.0f;
+    }
+    labels[i] = static_cast<float>(i % 3);
+  }
+  // some explicit missing values, and a -1 sentinel used by the dense input
+  const float kMissing = -1.0f;
+  for (int i = 0; i < kRows; i += 5) {
+    data[i * kCols + i % kCols] = kMissing;
+  }
+
+  DMatrixHandle dmat;
+  XGDMatrixCreateFromMat(data.data(), kRows, kCols, kMissing, &dmat);
+  XGDMatrixSetFloatInfo(dmat, "label", labels.data(), kRows);
+  BoosterHandle booster;
+  XGBoosterCreate(&dmat, 1, &booster);
+  XGBoosterSetParam(booster, "objective", "multi:softprob");
+  XGBoosterSetParam(booster, "num_class", "3");
+  XGBoosterSetParam(booster, "max_depth", "3");
+  for (int iter = 0; iter < 4; ++iter) {
+    XGBoosterUpdateOneIter(booster, iter, dmat);
+  }
+
+  // CSR view of the same rows
+  std::vector<size_t> indptr = {0};
+  std::vector<unsigned> indices;
+  std::vector<float> values;
+  for (int i = 0; i < kRows; ++i) {
+    for (int j = 0; j < kCols; ++j) {
+      if (data[i * kCols + j] != kMissing) {
+        indices.push_back(j);
+        values.push_back(data[i * kCols + j]);
+      }
+    }
+    indptr.push_back(indices.size());
+  }
+
+  for (int option_mask : {0, 1}) {
+    xgboost::bst_ulong expected_len;
+    const float* expected;
+    ASSERT_EQ(XGBoosterPredict(booster, dmat, option_mask, 0,
+                               &expected_len, &expected), 0);
+    ASSERT_EQ(expected_len, kRows * 3);
+
+    std::vector<float> out(kRows * 3);
+    xgboost::bst_ulong len;
+    ASSERT_EQ(XGBoosterPredictFromDense(booster, data.data(), kRows, kCols,
+                                        kMissing, option_mask, 0, &len,
+                                        out.data()), 0);
+    ASSERT_EQ(len, expected_len);
+    for (size_t i = 0; i < out.size(); ++i) {
+      ASSERT_NEAR(out[i], expected[i], 1e-6);
+    }
+
+    std::fill(out.begin(), out.end(), 0.0f);
+    ASSERT_EQ(XGBoosterPredictFromCSR(booster, indptr.data(), indices.data(),
+                                      values.data(), indptr.size(),
+                                      values.size(), kCols, option_mask, 0,
+                                      &len, out.data()), 0);
+    ASSERT_EQ(len, expected_len);
+    for (size_t i = 0; i < out.size(); ++i) {
+      ASSERT_NEAR(out[i], expected[i], 1e-6);
+    }
+  }
+
+  // leaf or contribution output is only available through XGBoosterPredict
+  std::vector<float> out(kRows * 3);
+  xgboost::bst_ulong len;
+  ASSERT_EQ(XGBoosterPredictFromDense(booster, data.data(), kRows, kCols,
+                                      kMissing, 2, 0, &len, out.data()), -1);
+
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+}
+
+TEST(c_api, ConcurrentPredict) {
+  const int kRows = 500, kCols = 8, kThreads = 8;
+  std::vector<float> data(kRows * kCols);
+  std::vector<float> labels(kRows);
+  for (int i = 0; i < kRows; ++i) {
+    for (int j = 0; j < kCols; ++j) {
+      data[i * kCols + j] = static_cast<float>((i * 11 + j * 5) % 23);
+    }
+    labels[i] = static_cast<float>(i % 2);
+  }
+  DMatrixHandle dmat;
+  XGDMatrixCreateFromMat(data.data(), kRows, kCols,
+                         std::numeric_limits<float>::quiet_NaN(), &dmat);
+  XGDMatrixSetFloatInfo(dmat, "label", labels.data(), kRows);
+  BoosterHandle trained;
+  XGBoosterCreate(&dmat, 1, &trained);
+  XGBoosterSetParam(trained, "objective", "binary:logistic");
+  XGBoosterSetParam(trained, "max_depth", "4");
+  for (int iter = 0; iter < 10; ++iter) {
+    XGBoosterUpdateOneIter(trained, iter, dmat);
+  }
+  xgboost::bst_ulong expected_len;
+  const float* p_expected;
+  XGBoosterPredict(trained, dmat, 0, 0, &expected_len, &p_expected);
+  std::vector<float> expected(p_expected, p_expected + expected_len);
+
+  // a loaded booster is configured lazily by whichever thread predicts first
+  xgboost::bst_ulong raw_len;
+  const char* raw;
+  XGBoosterGetModelRaw(trained, &raw_len, &raw);
+  BoosterHandle booster;
+  XGBoosterCreate(nullptr, 0, &booster);
+  XGBoosterLoadModelFromBuffer(booster, raw, raw_len);
+
+  std::vector<int> mismatches(kThreads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int repeat = 0; repeat < 20; ++repeat) {
+        xgboost::bst_ulong len;
+        const float* preds;
+        if (XGBoosterPredict(booster, dmat, 0, 0, &len, &preds) != 0 ||
+            len != expected.size()) {
+          ++mismatches[t];
+          continue;
+        }
+        std::vector<float> dense(kRows);
+        XGBoosterPredictFromDense(booster, data.data(), kRows, kCols,
+                                  std::numeric_limits<float>::quiet_NaN(), 0, 0,
+                                  &len, dense.data());
+        for (int i = 0; i < kRows; ++i) {
+          if (preds[i] != expected[i] || dense[i] != expected[i]) {
+            ++mismatches[t];
+          }
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < kThreads; ++t) {
+    ASSERT_EQ(mismatches[t], 0);
+  }
+
+  XGBoosterFree(booster);
+  XGBoosterFree(trained);
+  XGDMatrixFree(dmat);
+}
+
+TEST(c_api, XGBoosterPredictRow) {
+  const int kRows = 200, kCols = 5, kClasses = 3;
+  std::vector<float> data(kRows * kCols);
+  std::vector<float> labels(kRows);
+  for (int i = 0; i < kRows; ++i) {
+    for (int j = 0; j < kCols; ++j) {
+      data[i * kCols + j] = static_cast<float>((i * 3 + j * 7) % 13);
+    }
+    data[i * kCols + i % kCols] = std::numeric_limits<float>::quiet_NaN();
+    labels[i] = static_cast<float>(i % kClasses);
+  }
+  DMatrixHandle dmat;
+  XGDMatrixCreateFromMat(data.data(), kRows, kCols,
+                         std::numeric_limits<float>::quiet_NaN(), &dmat);
+  XGDMatrixSetFloatInfo(dmat, "label", labels.data(), kRows);
+  BoosterHandle booster;
+  XGBoosterCreate(&dmat, 1, &booster);
+  XGBoosterSetParam(booster, "objective", "multi:softmax");
+  XGBoosterSetParam(booster, "num_class", "3");
+  XGBoosterSetParam(booster, "max_depth", "3");
+  for (int iter = 0; iter < 4; ++iter) {
+    XGBoosterUpdateOneIter(booster, iter, dmat);
+  }
+
+  // margins, then class indices
+  for (int option_mask : {1, 0}) {
+    const size_t per_row = option_mask == 1 ? kClasses : 1;
+    xgboost::bst_ulong expected_len;
+    const float* expected;
+    ASSERT_EQ(XGBoosterPredict(booster, dmat, option_mask, 0,
+                               &expected_len, &expected), 0);
+    ASSERT_EQ(expected_len, kRows * per_row);
+    for (int i = 0; i < kRows; ++i) {
+      const float* row = data.data() + i * kCols;
+      float out[kClasses];
+      xgboost::bst_ulong len;
+      ASSERT_EQ(XGBoosterPredictRowFromDense(
+          booster, row, kCols, std::numeric_limits<float>::quiet_NaN(),
+          option_mask, 0, &len, out), 0);
+      ASSERT_EQ(len, per_row);
+      for (size_t k = 0; k < per_row; ++k) {
+        ASSERT_NEAR(out[k], expected[i * per_row + k], 1e-6);
+      }
+
+      std::vector<unsigned> indices;
+      std::vector<float> values;
+      for (int j = 0; j < kCols; ++j) {
+        if (!std::isnan(row[j])) {
+          indices.push_back(j);
+          values.push_back(row[j]);
+        }
+      }
+      ASSERT_EQ(XGBoosterPredictRowFromCSR(
+          booster, indices.data(), values.data(), values.size(), kCols,
+          option_mask, 0, &len, out), 0);
+      ASSERT_EQ(len, per_row);
+      for (size_t k = 0; k < per_row; ++k) {
+        ASSERT_NEAR(out[k], expected[i * per_row + k], 1e-6);
+      }
+    }
+  }
+
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+}
@@ -1,7 +1,12 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
 #include <vector>
 #include <string>
 #include <utility>
+#include <xgboost/c_api.h>
 
 #include "../../../src/common/hist_util.h"
 #include "../helpers.h"
@@ -47,5 +52,174 @@ TEST(HistCutMatrix, SearchGroupInd) {
   delete pp_mat;
 }
 
+TEST(HistCutMatrix, CategoricalLimit) {
+  auto make_cuts = [](bst_float max_id, HistCutMatrix* cuts) {
+    std::vector<HistCutMatrix::WXQSketch> sketchs(1);
+    sketchs[0].Init(4, 1.0 / 64);
+    for (bst_float id : {0.0f, 2.0f, max_id}) {
+      sketchs[0].Push(id);
+    }
+    cuts->Init(&sketchs, 16, {FeatureType::kCategorical});
+  };
+  // one bin per id up to the largest
+  HistCutMatrix cuts;
+  make_cuts(5.0f, &cuts);
+  ASSERT_EQ(cuts.row_ptr.back(), 6U);
+  ASSERT_EQ(cuts.cut.back(), 6.0f);
+  // sparse ids far beyond the limit are rejected instead of allocated
+  HistCutMatrix rejected;
+  ASSERT_THROW(make_cuts(HistCutMatrix::kMaxCategory + 1.0f, &rejected), dmlc::Error);
+}
+
+TEST(GHistIndexMatrix, BundleFeatures) {
+  // two one-hot encoded variables with explicit zeros, and a numeric column
+  size_t constexpr kRows = 64, kCategories = 8, kCols = 2 * kCategories + 1;
+  std::vector<float> data(kRows * kCols, 0.0f);
+  for (size_t i = 0; i < kRows; ++i) {
+    data[i * kCols + i % kCategories] = 1.0f;
+    data[i * kCols + kCategories + (i / 3) % kCategories] = 1.0f;
+    data[i * kCols + kCols - 1] = static_cast<float>(i);
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), kRows, kCols,
+                         std::numeric_limits<float>::quiet_NaN(), &handle);
+  auto pp_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+
+  GHistIndexMatrix original;
+  original.Init((*pp_dmat).get(), 16);
+  ASSERT_EQ(original.index.size(), kRows * kCols);
+  auto feature_of = [&](uint32_t bin) {
+    return static_cast<bst_uint>(std::upper_bound(original.cut.row_ptr.begin(),
+                                                  original.cut.row_ptr.end(), bin) -
+                                 original.cut.row_ptr.begin() - 1);
+  };
+
+  for (auto max_conflict_rate : {"0", "0.5"}) {
+    tree::TrainParam param;
+    param.InitAllowUnknown(std::vector<std::pair<std::string, std::string>>{
+        {"max_conflict_rate", max_conflict_rate}});
+    GHistIndexMatrix gmat = original;
+    gmat.BundleFeatures(param);
+    ASSERT_TRUE(gmat.IsBundled());
+    const size_t nbundle = gmat.bundle_ptr.size() - 1;
+    if (std::string(max_conflict_rate) == "0") {
+      // one bundle per one-hot variable, the numeric column stays alone
+      ASSERT_EQ(nbundle, 3U);
+      for (bst_uint fid = 0; fid < kCategories; ++fid) {
+        ASSERT_EQ(gmat.feature_bundle[fid], gmat.feature_bundle[0]);
+        ASSERT_EQ(gmat.feature_bundle[kCategories + fid], gmat.feature_bundle[kCategories]);
+      }
+      // the histogram loses the default bins of the one-hot columns
+      ASSERT_EQ(gmat.NumBins(), original.NumBins() - 2 * kCategories);
+    } else {
+      ASSERT_LE(nbundle, 3U);
+      ASSERT_LE(gmat.NumBins(), original.NumBins() - 2 * kCategories);
+    }
+    ASSERT_EQ(gmat.hit_count.size(), gmat.NumBins());
+    // at most one entry per row and bundle
+    ASSERT_LE(gmat.index.size(), kRows * nbundle);
+
+    for (size_t i = 0; i < kRows; ++i) {
+      auto row = gmat[i];
+      ASSERT_TRUE(std::is_sorted(row.begin(), row.end()));
+      for (size_t k = 1; k < row.size(); ++k) {
+        ASSERT_NE(std::upper_bound(gmat.bundle_ptr.begin(), gmat.bundle_ptr.end(), row[k - 1]),
+                  std::upper_bound(gmat.bundle_ptr.begin(), gmat.bundle_ptr.end(), row[k]));
+      }
+      // an entry is either kept, dropped as a default or, when conflicts are
+      // allowed, dropped for another feature of its bundle
+      for (auto bin : original[i]) {
+        const bst_uint fid = feature_of(bin);
+        if (gmat.bundled_bin[bin] == GHistIndexMatrix::kNoBin) {
+          ASSERT_EQ(bin, gmat.default_bin[fid]);
+        } else if (std::find(row.begin(), row.end(), gmat.bundled_bin[bin]) == row.end()) {
+          ASSERT_EQ(std::string(max_conflict_rate), "0.5");
+          ASSERT_TRUE(std::any_of(row.begin(), row.end(), [&](uint32_t b) {
+            return gmat.feature_bundle[feature_of(gmat.cut_bin[b])] == gmat.feature_bundle[fid];
+          }));
+        }
+      }
+    }
+
+    // unbundling restores the histogram of every feature
+    std::vector<tree::GradStats> hist(gmat.NumBins());
+    std::vector<tree::GradStats> expected(original.NumBins());
+    tree::GradStats total;
+    for (size_t i = 0; i < kRows; ++i) {
+      const GradientPair g(static_cast<float>(i % 5), 1.0f);
+      total.Add(g);
+      for (auto bin : gmat[i]) {
+        hist[bin].Add(g);
+      }
+      for (auto bin : original[i]) {
+        expected[bin].Add(g);
+      }
+    }
+    if (std::string(max_conflict_rate) == "0") {
+      std::vector<tree::GradStats> unbundled(original.NumBins());
+      for (bst_uint fid = 0; fid < kCols; ++fid) {
+        gmat.UnbundleHist(fid, hist.data(), &total, 1, unbundled.data());
+      }
+      for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(unbundled[i].sum_grad, expected[i].sum_grad);
+        ASSERT_EQ(unbundled[i].sum_hess, expected[i].sum_hess);
+      }
+    }
+  }
+
+  delete pp_dmat;
+}
+
+TEST(GHistAllreducer, Precision) {
+  // two adjacent node histograms and one apart
+  uint32_t constexpr kBins = 16;
+  bst_uint constexpr kNodes = 3;
+  HistCollection collection;
+  collection.Init(kBins);
+  for (bst_uint nid = 0; nid < kNodes; ++nid) {
+    collection.AddHistRow(nid);
+  }
+  auto hists = [&]() {
+    return std::vector<GHistRow>{collection[0], collection[2], collection[1]};
+  };
+
+  std::mt19937 rng(7);
+  for (int precision : {tree::TrainParam::kSyncDouble, tree::TrainParam::kSyncFloat,
+                        tree::TrainParam::kSyncInt}) {
+    GHistAllreducer reducer;
+    reducer.Init(kBins, precision);
+    // different histograms on every call, with node scales far apart, as for
+    // the nodes of successive levels and trees
+    for (size_t r = 0; r < 16; ++r) {
+      std::vector<tree::GradStats> expected(kNodes * kBins);
+      std::vector<double> max_grad(kNodes, 0.0), max_hess(kNodes, 0.0);
+      for (bst_uint nid = 0; nid < kNodes; ++nid) {
+        const double magnitude = std::pow(10.0, static_cast<double>(rng() % 7) - 3.0);
+        std::uniform_real_distribution<double> grad(-magnitude, magnitude);
+        std::uniform_real_distribution<double> hess(0.0, magnitude);
+        GHistRow hist = collection[nid];
+        for (uint32_t i = 0; i < kBins; ++i) {
+          hist[i] = tree::GradStats(grad(rng), hess(rng));
+          expected[nid * kBins + i] = hist[i];
+          max_grad[nid] = std::max(max_grad[nid], std::fabs(hist[i].sum_grad));
+          max_hess[nid] = std::max(max_hess[nid], hist[i].sum_hess);
+        }
+      }
+      reducer.Allreduce(hists());
+      // the error of every bin is bounded by the scale of its own node
+      const double tolerance = precision == tree::TrainParam::kSyncDouble ? 0.0 :
+                               precision == tree::TrainParam::kSyncFloat ? 1e-7 : 1e-9;
+      for (bst_uint nid = 0; nid < kNodes; ++nid) {
+        GHistRow hist = collection[nid];
+        for (uint32_t i = 0; i < kBins; ++i) {
+          const tree::GradStats& sol = expected[nid * kBins + i];
+          ASSERT_NEAR(hist[i].sum_grad, sol.sum_grad, tolerance * max_grad[nid]);
+          ASSERT_NEAR(hist[i].sum_hess, sol.sum_hess, tolerance * max_hess[nid]);
+        }
+      }
+    }
+  }
+}
+
 }  // namespace common
 }  // namespace xgboost
@@ -0,0 +1,136 @@
+// Copyright by Contributors
+#include <xgboost/c_api.h>
+#include <xgboost/learner.h>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+
+#include "../../../src/common/hist_util.h"
+#include "../../../src/data/dense_dmatrix.h"
+#include "../../../src/data/diff_dmatrix.h"
+
+namespace xgboost {
+
+namespace {
+// a dense matrix with missing cells, as values and as both kinds of DMatrix
+std::vector<float> DenseTestData(size_t rows, size_t cols, float missing) {
+  std::vector<float> data(rows * cols);
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  for (auto& v : data) {
+    v = dist(rng);
+    if (v < 0.2f) v = missing;
+  }
+  return data;
+}
+
+std::shared_ptr<DMatrix> SparseFromMat(const std::vector<float>& data, size_t rows,
+                                       size_t cols, float missing) {
+  DMatrixHandle handle;
+  CHECK_EQ(XGDMatrixCreateFromMat(data.data(), rows, cols, missing, &handle), 0);
+  auto* p_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+  std::shared_ptr<DMatrix> dmat = *p_dmat;
+  delete p_dmat;
+  return dmat;
+}
+}  // anonymous namespace
+
+TEST(DenseDMatrix, Batches) {
+  size_t constexpr kRows = 100, kCols = 7;
+  for (float missing : {std::numeric_limits<float>::quiet_NaN(), 0.0f}) {
+    std::vector<float> data = DenseTestData(kRows, kCols, missing);
+    auto sparse = SparseFromMat(data, kRows, kCols, missing);
+    data::DenseDMatrix dense(data.data(), kRows, kCols, missing);
+    ASSERT_EQ(dense.Info().num_nonzero_, sparse->Info().num_nonzero_);
+    data::DiffDMatrix(dense, *sparse);
+    data::DenseDMatrix single(data.data(), kRows, kCols, missing, 1);
+    ASSERT_EQ(single.Info().num_nonzero_, sparse->Info().num_nonzero_);
+    data::DiffDMatrix(single, *sparse);
+
+    const SparsePage& column = *dense.GetColumnBatches().begin();
+    const SparsePage& sparse_column = *sparse->GetColumnBatches().begin();
+    ASSERT_EQ(column.offset.HostVector(), sparse_column.offset.HostVector());
+    for (size_t j = 0; j < column.data.Size(); ++j) {
+      ASSERT_EQ(column.data.HostVector()[j].index, sparse_column.data.HostVector()[j].index);
+      ASSERT_EQ(column.data.HostVector()[j].fvalue, sparse_column.data.HostVector()[j].fvalue);
+    }
+    for (size_t j = 0; j < kCols; ++j) {
+      ASSERT_EQ(dense.GetColDensity(j), sparse->GetColDensity(j));
+    }
+  }
+}
+
+TEST(DenseDMatrix, RowPages) {
+  // one row per page
+  size_t constexpr kRows = 3, kCols = data::DenseDMatrix::kPageEntries / 2 + 1;
+  std::vector<float> data(kRows * kCols, std::numeric_limits<float>::quiet_NaN());
+  for (size_t i = 0; i < kRows; ++i) {
+    data[i * kCols + i] = static_cast<float>(i);
+    data[i * kCols + kCols - 1] = 1.0f;
+  }
+  data::DenseDMatrix dense(data.data(), kRows, kCols,
+                           std::numeric_limits<float>::quiet_NaN());
+  ASSERT_EQ(dense.RowsPerPage(), 1);
+  size_t rows = 0;
+  for (const auto& batch : dense.GetRowBatches()) {
+    ASSERT_EQ(batch.base_rowid, rows);
+    ASSERT_EQ(batch.Size(), 1);
+    ASSERT_EQ(batch[0].size(), 2);
+    ASSERT_EQ(batch[0][0].index, rows);
+    ASSERT_EQ(batch[0][0].fvalue, static_cast<float>(rows));
+    ASSERT_EQ(batch[0][1].index, kCols - 1);
+    ++rows;
+  }
+  ASSERT_EQ(rows, kRows);
+}
+
+TEST(DenseDMatrix, HistIndexAndPrediction) {
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 200, kCols = 6;
+  const float missing = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data = DenseTestData(kRows, kCols, missing);
+  auto sparse = SparseFromMat(data, kRows, kCols, missing);
+  auto dense = std::make_shared<data::DenseDMatrix>(data.data(), kRows, kCols, missing);
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<bst_float>(i % 3);
+  }
+  sparse->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+  dense->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  common::GHistIndexMatrix gmat, dense_gmat;
+  gmat.Init(sparse.get(), 16);
+  dense_gmat.Init(dense.get(), 16);
+  ASSERT_EQ(gmat.cut.cut, dense_gmat.cut.cut);
+  ASSERT_EQ(gmat.row_ptr, dense_gmat.row_ptr);
+  ASSERT_EQ(gmat.index, dense_gmat.index);
+  ASSERT_EQ(gmat.hit_count, dense_gmat.hit_count);
+
+  // the same model from either matrix, predicting the same on both; the
+  // matrices predicted on are not the cached training matrices
+  auto sparse_test = SparseFromMat(data, kRows, kCols, missing);
+  data::DenseDMatrix dense_test(data.data(), kRows, kCols, missing);
+  std::vector<HostDeviceVector<bst_float>> preds(4);
+  std::vector<std::shared_ptr<DMatrix>> train = {sparse, dense};
+  for (size_t k = 0; k < train.size(); ++k) {
+    std::vector<std::shared_ptr<DMatrix>> mat = {train[k]};
+    std::unique_ptr<Learner> learner(Learner::Create(mat));
+    learner->Configure({Arg{"tree_method", "hist"}, Arg{"max_depth", "4"},
+                        Arg{"nthread", "1"}});
+    learner->InitModel();
+    for (int i = 0; i < 4; ++i) {
+      learner->UpdateOneIter(i, train[k].get());
+    }
+    learner->Predict(sparse_test.get(), false, &preds[2 * k]);
+    learner->Predict(&dense_test, false, &preds[2 * k + 1]);
+  }
+  for (size_t k = 1; k < preds.size(); ++k) {
+    ASSERT_EQ(preds[0].HostVector(), preds[k].HostVector());
+  }
+}
+}  // namespace xgboost
@@ -0,0 +1,183 @@
+// Copyright by Contributors
+#include <dmlc/filesystem.h>
+#include <xgboost/learner.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+
+#include "../../../src/common/hist_util.h"
+#include "../../../src/data/diff_dmatrix.h"
+#include "../../../src/data/mapped_dmatrix.h"
+#include "../../../src/data/simple_csr_source.h"
+
+namespace xgboost {
+
+TEST(MappedDMatrix, InPlace) {
+  size_t constexpr kRows = 100, kCols = 7;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3, 3);
+  std::shared_ptr<DMatrix> sparse = *pp_dmat;
+  delete pp_dmat;
+  dmlc::TemporaryDirectory tempdir;
+  const std::string fname = tempdir.path + "/mapped.aligned";
+  sparse->SaveToPageAlignedFile(fname);
+
+  std::unique_ptr<DMatrix> loaded(DMatrix::Load(fname, true, false));
+  auto* mapped = dynamic_cast<data::MappedDMatrix*>(loaded.get());
+  ASSERT_NE(mapped, nullptr);
+  ASSERT_EQ(mapped->Info().num_nonzero_, sparse->Info().num_nonzero_);
+  data::DiffDMatrix(*mapped, *sparse);
+
+  // the in place rows read the same entries as the pages
+  ExternalRows rows;
+  ASSERT_TRUE(data::InPlaceRows(mapped, &rows));
+  ASSERT_EQ(rows.Size(), kRows);
+  const SparsePage& page = *sparse->GetRowBatches().begin();
+  for (size_t i = 0; i < kRows; ++i) {
+    std::vector<Entry> row;
+    rows.ForEach(i, [&row](bst_uint index, bst_float fvalue) {
+      row.emplace_back(index, fvalue);
+    });
+    ASSERT_EQ(row.size(), page[i].size());
+    for (size_t j = 0; j < row.size(); ++j) {
+      ASSERT_EQ(row[j].index, page[i][j].index);
+      ASSERT_EQ(row[j].fvalue, page[i][j].fvalue);
+    }
+  }
+
+  const SparsePage& column = *mapped->GetColumnBatches().begin();
+  const SparsePage& sparse_column = *sparse->GetColumnBatches().begin();
+  ASSERT_EQ(column.offset.HostVector(), sparse_column.offset.HostVector());
+  for (size_t j = 0; j < column.data.Size(); ++j) {
+    ASSERT_EQ(column.data.HostVector()[j].index, sparse_column.data.HostVector()[j].index);
+    ASSERT_EQ(column.data.HostVector()[j].fvalue, sparse_column.data.HostVector()[j].fvalue);
+  }
+  for (size_t j = 0; j < kCols; ++j) {
+    ASSERT_EQ(mapped->GetColDensity(j), sparse->GetColDensity(j));
+  }
+}
+
+TEST(MappedDMatrix, RowPages) {
+  // rows of kPageEntries / 2 + 1 entries, so that every page holds one row
+  size_t constexpr kRows = 3, kCols = data::MappedDMatrix::kPageEntries / 2 + 1;
+  data::SimpleCSRSource source;
+  source.info.num_row_ = kRows;
+  source.info.num_col_ = kCols;
+  std::vector<Entry> row(kCols);
+  for (size_t i = 0; i < kRows; ++i) {
+    for (size_t j = 0; j < kCols; ++j) {
+      row[j] = Entry(static_cast<bst_uint>(j), static_cast<bst_float>(i));
+    }
+    source.page_.Push(SparsePage::Inst(row.data(), row.size()));
+  }
+  source.info.num_nonzero_ = source.page_.data.Size();
+  dmlc::TemporaryDirectory tempdir;
+  const std::string fname = tempdir.path + "/pages.aligned";
+  {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
+    source.SavePageAlignedBinary(fo.get());
+  }
+
+  data::MappedDMatrix mapped(fname);
+  size_t rows = 0;
+  for (const auto& batch : mapped.GetRowBatches()) {
+    ASSERT_EQ(batch.base_rowid, rows);
+    ASSERT_EQ(batch.Size(), 1);
+    ASSERT_EQ(batch[0].size(), kCols);
+    ASSERT_EQ(batch[0][kCols - 1].index, kCols - 1);
+    ASSERT_EQ(batch[0][kCols - 1].fvalue, static_cast<float>(rows));
+    ++rows;
+  }
+  ASSERT_EQ(rows, kRows);
+}
+
+TEST(MappedDMatrix, HistIndexAndPrediction) {
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 200, kCols = 6;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.2, 5);
+  std::shared_ptr<DMatrix> sparse = *pp_dmat;
+  delete pp_dmat;
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<bst_float>(i % 3);
+  }
+  sparse->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+  dmlc::TemporaryDirectory tempdir;
+  const std::string fname = tempdir.path + "/train.aligned";
+  sparse->SaveToPageAlignedFile(fname);
+  std::shared_ptr<DMatrix> mapped(DMatrix::Load(fname, true, false));
+
+  common::GHistIndexMatrix gmat, mapped_gmat;
+  gmat.Init(sparse.get(), 16);
+  mapped_gmat.Init(mapped.get(), 16);
+  ASSERT_EQ(gmat.cut.cut, mapped_gmat.cut.cut);
+  ASSERT_EQ(gmat.row_ptr, mapped_gmat.row_ptr);
+  ASSERT_EQ(gmat.index, mapped_gmat.index);
+  ASSERT_EQ(gmat.hit_count, mapped_gmat.hit_count);
+
+  // the same model from either matrix, predicting the same on both; the
+  // matrices predicted on are not the cached training matrices
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+  source->CopyFrom(sparse.get());
+  std::unique_ptr<DMatrix> sparse_test(DMatrix::Create(std::move(source)));
+  std::unique_ptr<DMatrix> mapped_test(DMatrix::Load(fname, true, false));
+  std::vector<HostDeviceVector<bst_float>> preds(4);
+  std::vector<std::shared_ptr<DMatrix>> train = {sparse, mapped};
+  for (size_t k = 0; k < train.size(); ++k) {
+    std::vector<std::shared_ptr<DMatrix>> mat = {train[k]};
+    std::unique_ptr<Learner> learner(Learner::Create(mat));
+    learner->Configure({Arg{"tree_method", "hist"}, Arg{"max_depth", "4"},
+                        Arg{"nthread", "1"}});
+    learner->InitModel();
+    for (int i = 0; i < 4; ++i) {
+      learner->UpdateOneIter(i, train[k].get());
+    }
+    learner->Predict(sparse_test.get(), false, &preds[2 * k]);
+    learner->Predict(mapped_test.get(), false, &preds[2 * k + 1]);
+  }
+  for (size_t k = 1; k < preds.size(); ++k) {
+    ASSERT_EQ(preds[0].HostVector(), preds[k].HostVector());
+  }
+}
+
+TEST(MappedDMatrix, ExactTraining) {
+  // ColMaker reads the column densities from all of its threads at once
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 200, kCols = 16;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3, 7);
+  std::shared_ptr<DMatrix> sparse = *pp_dmat;
+  delete pp_dmat;
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<bst_float>(i % 2);
+  }
+  sparse->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+  dmlc::TemporaryDirectory tempdir;
+  const std::string fname = tempdir.path + "/train.aligned";
+  sparse->SaveToPageAlignedFile(fname);
+  std::shared_ptr<DMatrix> mapped(DMatrix::Load(fname, true, false));
+  // predict on a matrix that is not cached by either learner
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+  source->CopyFrom(sparse.get());
+  std::unique_ptr<DMatrix> test(DMatrix::Create(std::move(source)));
+
+  std::vector<HostDeviceVector<bst_float>> preds(2);
+  std::vector<std::shared_ptr<DMatrix>> train = {sparse, mapped};
+  for (size_t k = 0; k < train.size(); ++k) {
+    std::vector<std::shared_ptr<DMatrix>> mat = {train[k]};
+    std::unique_ptr<Learner> learner(Learner::Create(mat));
+    learner->Configure({Arg{"tree_method", "exact"}, Arg{"max_depth", "4"},
+                        Arg{"nthread", "4"}});
+    learner->InitModel();
+    for (int i = 0; i < 3; ++i) {
+      learner->UpdateOneIter(i, train[k].get());
+    }
+    learner->Predict(test.get(), false, &preds[k]);
+  }
+  ASSERT_EQ(preds[0].HostVector(), preds[1].HostVector());
+  for (size_t j = 0; j < kCols; ++j) {
+    ASSERT_EQ(mapped->GetColDensity(j), sparse->GetColDensity(j));
+  }
+}
+}  // namespace xgboost
@@ -1,6 +1,7 @@
 // Copyright by Contributors
 #include <xgboost/data.h>
 #include <dmlc/filesystem.h>
+#include "../../../src/data/mapped_dmatrix.h"
 #include "../../../src/data/simple_csr_source.h"
 
 #include "../helpers.h"
@@ -33,3 +34,42 @@ TEST(SimpleCSRSource, SaveLoadBinary) {
   delete dmat;
   delete dmat_read;
 }
+
+TEST(SimpleCSRSource, SaveLoadPageAlignedBinary) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Load(tmp_file, true, false));
+  dmat->Info().weights_.HostVector().assign(dmat->Info().num_row_, 0.5f);
+
+  const std::string tmp_binfile = tempdir.path + "/csr_source.aligned";
+  dmat->SaveToPageAlignedFile(tmp_binfile);
+  // arrays start on page boundaries
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_binfile.c_str(), "r"));
+  xgboost::data::PageAlignedHeader header;
+  ASSERT_EQ(fi->Read(&header, sizeof(header)), sizeof(header));
+  EXPECT_EQ(header.magic, static_cast<int32_t>(xgboost::data::SimpleCSRSource::kMagicPageAligned));
+  EXPECT_EQ(header.offset_size, dmat->Info().num_row_ + 1);
+  EXPECT_EQ(header.data_size, dmat->Info().num_nonzero_);
+  EXPECT_EQ(header.offset_begin % xgboost::data::SimpleCSRSource::kPageAlign, 0);
+  EXPECT_EQ(header.data_begin % xgboost::data::SimpleCSRSource::kPageAlign, 0);
+
+  std::unique_ptr<xgboost::DMatrix> dmat_read(xgboost::DMatrix::Load(tmp_binfile, true, false));
+  EXPECT_EQ(dmat->Info().num_col_, dmat_read->Info().num_col_);
+  EXPECT_EQ(dmat->Info().num_row_, dmat_read->Info().num_row_);
+  EXPECT_EQ(dmat->Info().num_nonzero_, dmat_read->Info().num_nonzero_);
+  EXPECT_EQ(dmat->Info().labels_.HostVector(), dmat_read->Info().labels_.HostVector());
+  EXPECT_EQ(dmat->Info().weights_.HostVector(), dmat_read->Info().weights_.HostVector());
+
+  const auto& page = *dmat->GetRowBatches().begin();
+  // read in place from the mapping, the page is owned by the iterator
+  ASSERT_NE(dynamic_cast<xgboost::data::MappedDMatrix*>(dmat_read.get()), nullptr);
+  auto iter_read = dmat_read->GetRowBatches().begin();
+  const auto& page_read = *iter_read;
+  EXPECT_EQ(page.offset.HostVector(), page_read.offset.HostVector());
+  ASSERT_EQ(page.data.Size(), page_read.data.Size());
+  for (size_t i = 0; i < page.data.Size(); ++i) {
+    EXPECT_EQ(page.data.HostVector()[i].index, page_read.data.HostVector()[i].index);
+    EXPECT_EQ(page.data.HostVector()[i].fvalue, page_read.data.HostVector()[i].fvalue);
+  }
+}
@@ -1,7 +1,12 @@
 // Copyright by Contributors
 #include <dmlc/filesystem.h>
 #include <gtest/gtest.h>
+#include <xgboost/c_api.h>
 #include <xgboost/predictor.h>
+
+#include <limits>
+#include <tuple>
+
 #include "../helpers.h"
 
 namespace xgboost {
@@ -54,6 +59,291 @@ TEST(cpu_predictor, Test) {
   delete dmat;
 }
 
+TEST(cpu_predictor, FlatForest) {
+  // numerical and categorical splits, both default directions, two groups
+  auto make_tree = [](float shift) {
+    std::unique_ptr<RegTree> tree(new RegTree());
+    tree->ExpandNode(0, 1, 0.5f + shift, true, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    tree->ExpandCategoricalNode((*tree)[0].LeftChild(), 0, {1, 3}, false,
+                                0.0f, 1.0f + shift, 2.0f, 0.0f, 0.0f);
+    tree->ExpandNode((*tree)[0].RightChild(), 2, 0.25f, false,
+                     0.0f, -1.0f, -2.0f - shift, 0.0f, 0.0f);
+    return tree;
+  };
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 2;
+  model.param.num_feature = 3;
+  for (int i = 0; i < 4; ++i) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(make_tree(0.1f * i));
+    model.CommitModel(std::move(trees), i % 2);
+  }
+
+  size_t constexpr kRows = 40;
+  std::vector<float> data(kRows * 3);
+  for (size_t i = 0; i < kRows; ++i) {
+    data[i * 3] = static_cast<float>(i % 5);
+    data[i * 3 + 1] = i % 7 == 0 ? std::numeric_limits<float>::quiet_NaN()
+                                 : static_cast<float>(i % 9) / 8.0f;
+    data[i * 3 + 2] = i % 4 == 0 ? std::numeric_limits<float>::quiet_NaN()
+                                 : static_cast<float>(i % 3) / 4.0f;
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), kRows, 3,
+                         std::numeric_limits<float>::quiet_NaN(), &handle);
+  auto pp_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+  DMatrix* dmat = (*pp_dmat).get();
+
+  std::unique_ptr<Predictor> cpu_predictor(Predictor::Create("cpu_predictor"));
+  for (int round = 0; round < 2; ++round) {
+    HostDeviceVector<float> preds;
+    cpu_predictor->PredictBatch(dmat, &preds, model, 0);
+    std::vector<float> leaves;
+    cpu_predictor->PredictLeaf(dmat, &leaves, model);
+    const size_t ntrees = model.trees.size();
+    ASSERT_EQ(leaves.size(), kRows * ntrees);
+
+    RegTree::FVec feats;
+    feats.Init(3);
+    for (const auto& batch : dmat->GetRowBatches()) {
+      for (size_t i = 0; i < batch.Size(); ++i) {
+        const size_t ridx = batch.base_rowid + i;
+        feats.Fill(batch[i]);
+        std::vector<float> expected(2, 0.5f);
+        for (size_t j = 0; j < ntrees; ++j) {
+          const int leaf = model.trees[j]->GetLeafIndex(feats, 0);
+          ASSERT_EQ(leaves[ridx * ntrees + j], leaf);
+          expected[model.tree_info[j]] += (*model.trees[j])[leaf].LeafValue();
+        }
+        feats.Drop(batch[i]);
+        std::vector<float> instance;
+        cpu_predictor->PredictInstance(batch[i], &instance, model);
+        for (int gid = 0; gid < 2; ++gid) {
+          ASSERT_FLOAT_EQ(preds.HostVector()[ridx * 2 + gid], expected[gid]);
+          ASSERT_FLOAT_EQ(instance[gid], expected[gid]);
+        }
+      }
+    }
+    // committing trees makes the predictor flatten the model again
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(make_tree(-0.3f));
+    model.CommitModel(std::move(trees), 1);
+  }
+
+  delete pp_dmat;
+}
+
+TEST(cpu_predictor, QuantizedPrediction) {
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 3;
+  auto commit = [&](std::unique_ptr<RegTree> tree) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::move(tree));
+    model.CommitModel(std::move(trees), 0);
+  };
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<RegTree> tree(new RegTree());
+    tree->ExpandNode(0, 1, 0.5f, i % 2 == 0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    tree->ExpandCategoricalNode((*tree)[0].LeftChild(), 0, {1, 3}, false,
+                                0.0f, 1.0f, 2.0f + i, 0.0f, 0.0f);
+    tree->ExpandNode((*tree)[0].RightChild(), 2, 0.25f * i, true,
+                     0.0f, -1.0f, -2.0f, 0.0f, 0.0f);
+    commit(std::move(tree));
+  }
+
+  size_t constexpr kRows = 70;
+  std::vector<float> data(kRows * 3);
+  for (size_t i = 0; i < kRows; ++i) {
+    data[i * 3] = i % 11 == 0 ? -1.0f : static_cast<float>(i % 6);
+    data[i * 3 + 1] = i % 7 == 0 ? std::numeric_limits<float>::quiet_NaN()
+                                 : static_cast<float>(i % 9) / 8.0f;
+    data[i * 3 + 2] = i % 4 == 0 ? std::numeric_limits<float>::quiet_NaN()
+                                 : static_cast<float>(i % 5) / 4.0f;
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), kRows, 3,
+                         std::numeric_limits<float>::quiet_NaN(), &handle);
+  auto pp_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+  DMatrix* dmat = (*pp_dmat).get();
+
+  std::unique_ptr<Predictor> predictor(Predictor::Create("cpu_predictor"));
+  predictor->Init({}, {});
+  std::unique_ptr<Predictor> quantized(Predictor::Create("cpu_predictor"));
+  quantized->Init({{"quantized_prediction", "1"}}, {});
+  // the second round has more thresholds on feature 1 than uint8 bins hold
+  for (int round = 0; round < 2; ++round) {
+    HostDeviceVector<float> expected, preds;
+    predictor->PredictBatch(dmat, &expected, model, 0);
+    quantized->PredictBatch(dmat, &preds, model, 0);
+    ASSERT_EQ(preds.HostVector(), expected.HostVector());
+    for (int i = 0; i < 300; ++i) {
+      std::unique_ptr<RegTree> tree(new RegTree());
+      tree->ExpandNode(0, 1, i / 299.0f, false, 0.0f, 0.01f, -0.01f, 0.0f, 0.0f);
+      commit(std::move(tree));
+    }
+  }
+
+  delete pp_dmat;
+}
+
+TEST(cpu_predictor, ContributionsInBlocks) {
+  // a feature split twice on one path, two groups
+  auto make_tree = [](float shift) {
+    std::unique_ptr<RegTree> tree(new RegTree());
+    RegTree& t = *tree;
+    t.ExpandNode(0, 0, 0.5f, true, 0.0f, 0.0f, 0.0f, 0.0f, 10.0f);
+    const int left = t[0].LeftChild(), right = t[0].RightChild();
+    t.ExpandNode(left, 1, 0.3f + shift, false, 0.0f, 1.0f + shift, -0.5f, 0.0f, 6.0f);
+    t.ExpandNode(right, 0, 0.8f, true, 0.0f, 0.25f, -1.5f - shift, 0.0f, 4.0f);
+    t.Stat(t[left].LeftChild()).sum_hess = 2.0f;
+    t.Stat(t[left].RightChild()).sum_hess = 4.0f;
+    t.Stat(t[right].LeftChild()).sum_hess = 1.0f + shift;
+    t.Stat(t[right].RightChild()).sum_hess = 3.0f - shift;
+    return tree;
+  };
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 2;
+  model.param.num_feature = 3;
+  for (int i = 0; i < 6; ++i) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(make_tree(0.1f * i));
+    model.CommitModel(std::move(trees), i % 2);
+  }
+
+  // more rows than one block
+  size_t constexpr kRows = 150, kCols = 3;
+  std::vector<float> data(kRows * kCols);
+  for (size_t i = 0; i < kRows; ++i) {
+    data[i * 3] = i % 5 == 0 ? std::numeric_limits<float>::quiet_NaN()
+                             : static_cast<float>(i % 11) / 10.0f;
+    data[i * 3 + 1] = static_cast<float>(i % 7) / 6.0f;
+    data[i * 3 + 2] = static_cast<float>(i % 3);
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), kRows, kCols,
+                         std::numeric_limits<float>::quiet_NaN(), &handle);
+  auto pp_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+  DMatrix* dmat = (*pp_dmat).get();
+
+  std::unique_ptr<Predictor> cpu_predictor(Predictor::Create("cpu_predictor"));
+  // {approximate, condition, condition_feature}
+  const std::vector<std::tuple<bool, int, unsigned>> configs {
+    std::make_tuple(false, 0, 0U), std::make_tuple(false, 1, 0U),
+    std::make_tuple(false, -1, 1U), std::make_tuple(true, 0, 0U)};
+  for (const auto& config : configs) {
+    const bool approximate = std::get<0>(config);
+    const int condition = std::get<1>(config);
+    const unsigned condition_feature = std::get<2>(config);
+    std::vector<float> contribs;
+    cpu_predictor->PredictContribution(dmat, &contribs, model, 0, approximate,
+                                       condition, condition_feature);
+    // row by row with the allocating TreeShap, as the predictor did before
+    std::vector<float> expected(kRows * 2 * (kCols + 1), 0.0f);
+    RegTree::FVec feats;
+    feats.Init(kCols);
+    for (const auto& batch : dmat->GetRowBatches()) {
+      for (size_t i = 0; i < batch.Size(); ++i) {
+        const size_t ridx = batch.base_rowid + i;
+        feats.Fill(batch[i]);
+        for (size_t j = 0; j < model.trees.size(); ++j) {
+          float* out = &expected[(ridx * 2 + model.tree_info[j]) * (kCols + 1)];
+          if (approximate) {
+            model.trees[j]->CalculateContributionsApprox(feats, 0, out);
+          } else {
+            model.trees[j]->CalculateContributions(feats, 0, out, condition,
+                                                   condition_feature);
+          }
+        }
+        feats.Drop(batch[i]);
+        for (int gid = 0; gid < 2; ++gid) {
+          expected[(ridx * 2 + gid) * (kCols + 1) + kCols] += 0.5f;
+        }
+      }
+    }
+    ASSERT_EQ(contribs, expected);
+  }
+
+  // interactions, against the combination of full passes conditioned on each
+  // feature; feature 2 is never split on
+  size_t constexpr kColumns = kCols + 1;
+  for (bool approximate : {false, true}) {
+    std::vector<float> interactions;
+    cpu_predictor->PredictInteractionContributions(dmat, &interactions, model, 0,
+                                                   approximate);
+    std::vector<float> expected(kRows * 2 * kColumns * kColumns), diag, off, on;
+    cpu_predictor->PredictContribution(dmat, &diag, model, 0, approximate, 0, 0);
+    for (size_t i = 0; i < kColumns; ++i) {
+      cpu_predictor->PredictContribution(dmat, &off, model, 0, approximate, -1, i);
+      cpu_predictor->PredictContribution(dmat, &on, model, 0, approximate, 1, i);
+      for (size_t r = 0; r < kRows * 2; ++r) {
+        float* out = &expected[(r * kColumns + i) * kColumns];
+        out[i] = 0;
+        for (size_t k = 0; k < kColumns; ++k) {
+          if (k == i) {
+            out[i] += diag[r * kColumns + k];
+          } else {
+            out[k] = (on[r * kColumns + k] - off[r * kColumns + k]) / 2.0;
+            out[i] -= out[k];
+          }
+        }
+      }
+    }
+    ASSERT_EQ(interactions, expected);
+  }
+
+  delete pp_dmat;
+}
+
+TEST(cpu_predictor, PredictDecision) {
+  gbm::GBTreeModel model(0.5);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 2;
+  for (int i = 0; i < 20; ++i) {
+    std::unique_ptr<RegTree> tree(new RegTree());
+    tree->ExpandNode(0, i % 2, 0.05f * i, i % 3 == 0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    tree->ExpandNode((*tree)[0].LeftChild(), (i + 1) % 2, 0.5f, false,
+                     0.0f, 0.3f / (i + 1), -0.1f, 0.0f, 0.0f);
+    (*tree)[(*tree)[0].RightChild()].SetLeaf(i % 2 == 0 ? 0.2f : -0.25f);
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::move(tree));
+    model.CommitModel(std::move(trees), 0);
+  }
+
+  size_t constexpr kRows = 50;
+  std::vector<float> data(kRows * 2);
+  for (size_t i = 0; i < kRows; ++i) {
+    data[i * 2] = i % 6 == 0 ? std::numeric_limits<float>::quiet_NaN()
+                             : static_cast<float>(i % 10) / 9.0f;
+    data[i * 2 + 1] = static_cast<float>(i % 7) / 6.0f;
+  }
+  const ExternalRows rows = ExternalRows::Dense(
+      data.data(), kRows, 2, std::numeric_limits<float>::quiet_NaN());
+
+  std::unique_ptr<Predictor> cpu_predictor(Predictor::Create("cpu_predictor"));
+  for (unsigned ntree_limit : {0U, 7U}) {
+    std::vector<float> margin(kRows);
+    cpu_predictor->PredictRows(rows, margin.data(), model, ntree_limit);
+    const unsigned ntrees = ntree_limit == 0 ? 20 : ntree_limit;
+    // cutoffs far from, near and exactly at the margins
+    std::vector<float> cutoffs {-10.0f, -0.3f, 0.5f, 1.2f, 10.0f};
+    cutoffs.insert(cutoffs.end(), margin.begin(), margin.begin() + 5);
+    for (float cutoff : cutoffs) {
+      std::vector<uint8_t> decision(kRows);
+      std::vector<unsigned> ntree(kRows);
+      cpu_predictor->PredictDecision(rows, cutoff, decision.data(), ntree.data(),
+                                     model, ntree_limit);
+      for (size_t i = 0; i < kRows; ++i) {
+        ASSERT_EQ(decision[i], margin[i] > cutoff ? 1 : 0) << cutoff;
+        ASSERT_LE(ntree[i], ntrees);
+        if (std::abs(cutoff) == 10.0f) {
+          ASSERT_EQ(ntree[i], 0U);
+        }
+      }
+    }
+  }
+}
+
 TEST(cpu_predictor, ExternalMemoryTest) {
   std::unique_ptr<DMatrix> dmat = CreateSparsePageDMatrix(12, 64);
 
@@ -1,9 +1,15 @@
 // Copyright by Contributors
 #include <gtest/gtest.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
 #include <vector>
 #include "helpers.h"
 #include "xgboost/learner.h"
 #include "dmlc/filesystem.h"
+#include "../../src/common/common.h"
+#include "../../src/common/random.h"
 
 namespace xgboost {
 
@@ -93,6 +99,304 @@ TEST(Learner, CheckGroup) {
   delete pp_mat;
 }
 
+TEST(Learner, MultiOutputTree) {
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 64, kCols = 5, kClasses = 3, kRounds = 2;
+  auto pp_train = CreateDMatrix(kRows, kCols, 0, 11);
+  auto pp_test = CreateDMatrix(kRows, kCols, 0, 11);
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<bst_float>(i % kClasses);
+  }
+  (*pp_train)->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*pp_train};
+  auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  learner->Configure({Arg{"objective", "multi:softprob"},
+                      Arg{"num_class", std::to_string(kClasses)},
+                      Arg{"tree_method", "hist"},
+                      Arg{"multi_strategy", "multi_output_tree"}});
+  learner->InitModel();
+  for (size_t i = 0; i < kRounds; ++i) {
+    learner->UpdateOneIter(static_cast<int>(i), (*pp_train).get());
+  }
+  // one vector tree per round instead of one tree per class
+  ASSERT_EQ(learner->DumpModel(FeatureMap(), false, "text").size(), kRounds);
+
+  // the cached training margin matches a fresh traversal of the same rows
+  HostDeviceVector<bst_float> cached, fresh, first;
+  learner->Predict((*pp_train).get(), true, &cached);
+  learner->Predict((*pp_test).get(), true, &fresh);
+  ASSERT_EQ(cached.Size(), kRows * kClasses);
+  ASSERT_EQ(fresh.Size(), kRows * kClasses);
+  for (size_t i = 0; i < cached.Size(); ++i) {
+    ASSERT_NEAR(cached.HostVector()[i], fresh.HostVector()[i], 1e-5);
+  }
+  learner->Predict((*pp_test).get(), true, &first, 1);
+  ASSERT_EQ(first.Size(), kRows * kClasses);
+  ASSERT_NE(first.HostVector(), fresh.HostVector());
+
+  delete pp_train;
+  delete pp_test;
+}
+
+TEST(Learner, MulticlassContributions) {
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 32, kCols = 4, kClasses = 3;
+  auto pp_mat = CreateDMatrix(kRows, kCols, 0.2, 5);
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<bst_float>(i % kClasses);
+  }
+  (*pp_mat)->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  // no tree is dropped, so the margins of dart are plain tree sums as well
+  for (std::string booster : {"gbtree", "dart"}) {
+    std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*pp_mat};
+    auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+    learner->Configure({Arg{"booster", booster},
+                        Arg{"objective", "multi:softprob"},
+                        Arg{"num_class", std::to_string(kClasses)}});
+    learner->InitModel();
+    for (int i = 0; i < 2; ++i) {
+      learner->UpdateOneIter(i, (*pp_mat).get());
+    }
+    HostDeviceVector<bst_float> margin, contribs;
+    learner->Predict((*pp_mat).get(), true, &margin, 2);
+    learner->Predict((*pp_mat).get(), true, &contribs, 2, false, true);
+    ASSERT_EQ(margin.Size(), kRows * kClasses);
+    ASSERT_EQ(contribs.Size(), kRows * kClasses * (kCols + 1));
+    for (size_t i = 0; i < kRows * kClasses; ++i) {
+      bst_float sum = 0.0f;
+      for (size_t j = 0; j <= kCols; ++j) {
+        sum += contribs.HostVector()[i * (kCols + 1) + j];
+      }
+      ASSERT_NEAR(sum, margin.HostVector()[i], 1e-5) << booster;
+    }
+  }
+
+  delete pp_mat;
+}
+
+TEST(Learner, DartPredictionCache) {
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 100, kCols = 5;
+  auto pp_train = CreateDMatrix(kRows, kCols, 0.1, 3);
+  // the same rows, not cached by the learner
+  auto pp_copy = CreateDMatrix(kRows, kCols, 0.1, 3);
+  // the same rows, cached but predicted only every other round
+  auto pp_eval = CreateDMatrix(kRows, kCols, 0.1, 3);
+  std::vector<bst_float> labels(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    labels[i] = static_cast<bst_float>(i % 2);
+  }
+  (*pp_train)->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+
+  std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*pp_train, *pp_eval};
+  auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  learner->Configure({Arg{"booster", "dart"},
+                      Arg{"objective", "binary:logistic"},
+                      Arg{"max_depth", "3"},
+                      Arg{"rate_drop", "0.5"}});
+  learner->InitModel();
+  for (int i = 0; i < 8; ++i) {
+    learner->UpdateOneIter(i, (*pp_train).get());
+    // the same trees dropped from the cached sum and from a full prediction;
+    // the cache updates a double sum incrementally, so only up to rounding
+    HostDeviceVector<bst_float> cached, fresh;
+    common::GlobalRandom().seed(i);
+    learner->Predict((*pp_train).get(), true, &cached);
+    common::GlobalRandom().seed(i);
+    learner->Predict((*pp_copy).get(), true, &fresh);
+    ASSERT_EQ(cached.Size(), kRows);
+    ASSERT_EQ(fresh.Size(), kRows);
+    for (size_t j = 0; j < kRows; ++j) {
+      ASSERT_NEAR(cached.HostVector()[j], fresh.HostVector()[j], 1e-5);
+    }
+    if (i % 2 == 1) {
+      HostDeviceVector<bst_float> late;
+      common::GlobalRandom().seed(i);
+      learner->Predict((*pp_eval).get(), true, &late);
+      for (size_t j = 0; j < kRows; ++j) {
+        ASSERT_NEAR(late.HostVector()[j], fresh.HostVector()[j], 1e-5);
+      }
+    }
+  }
+
+  delete pp_train;
+  delete pp_copy;
+  delete pp_eval;
+}
+
+TEST(Learner, PredictRows) {
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 32, kCols = 4, kClasses = 3;
+  auto pp_mat = CreateDMatrix(kRows, kCols, 0.2, 5);
+  auto pp_test = CreateDMatrix(kRows, kCols, 0.2, 5);
+  std::vector<bst_float> dense(kRows * kCols, std::numeric_limits<bst_float>::quiet_NaN());
+  for (const auto& batch : (*pp_mat)->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      for (const auto& e : batch[i]) {
+        dense[(batch.base_rowid + i) * kCols + e.index] = e.fvalue;
+      }
+    }
+  }
+  // transformed in place per row, including softmax shrinking every row
+  for (const char* objective : {"binary:logistic", "multi:softprob", "multi:softmax"}) {
+    const bool binary = std::string(objective) == "binary:logistic";
+    std::vector<bst_float> labels(kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+      labels[i] = static_cast<bst_float>(i % (binary ? 2 : kClasses));
+    }
+    (*pp_mat)->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+    std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*pp_mat};
+    auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+    std::vector<Arg> args {Arg{"objective", objective}};
+    if (!binary) {
+      args.emplace_back("num_class", std::to_string(kClasses));
+    }
+    learner->Configure(args);
+    learner->InitModel();
+    for (int i = 0; i < 2; ++i) {
+      learner->UpdateOneIter(i, (*pp_mat).get());
+    }
+    HostDeviceVector<bst_float> expected;
+    learner->Predict((*pp_test).get(), false, &expected);
+    std::vector<bst_float> preds(kRows * kClasses);
+    preds.resize(learner->PredictRows(
+        ExternalRows::Dense(dense.data(), kRows, kCols,
+                            std::numeric_limits<bst_float>::quiet_NaN()),
+        false, preds.data(), 0));
+    ASSERT_EQ(preds.size(), expected.Size()) << objective;
+    for (size_t i = 0; i < preds.size(); ++i) {
+      ASSERT_NEAR(preds[i], expected.HostVector()[i], 1e-6) << objective;
+    }
+  }
+
+  delete pp_mat;
+  delete pp_test;
+}
+
+TEST(Learner, CompileModel) {
+  using Arg = std::pair<std::string, std::string>;
+  size_t constexpr kRows = 40, kCols = 5, kClasses = 3;
+  if (std::system("c++ --version > /dev/null 2>&1") != 0) {
+    LOG(CONSOLE) << "No C++ compiler found, skipping Learner.CompileModel";
+    return;
+  }
+  auto pp_mat = CreateDMatrix(kRows, kCols, 0.3, 7);
+  std::vector<bst_float> dense(kRows * kCols, std::numeric_limits<bst_float>::quiet_NaN());
+  for (const auto& batch : (*pp_mat)->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      for (const auto& e : batch[i]) {
+        dense[(batch.base_rowid + i) * kCols + e.index] = e.fvalue;
+      }
+    }
+  }
+
+  dmlc::TemporaryDirectory tempdir;
+  std::ofstream driver(tempdir.path + "/driver.cc");
+  driver << "#include <cmath>\n#include <cstdint>\n#include <cstdio>\n#include <limits>\n\n"
+         << "const float kData[] = {";
+  for (bst_float v : dense) {
+    // the literals must read back bitwise, or the predictions may differ
+    driver << (std::isnan(v) ? "NAN" : common::ToFloatLiteral(v)) << ", ";
+  }
+  driver << "};\n";
+
+  // every objective overriding PredTransformRowSource, with the number of label values
+  const std::vector<std::pair<std::string, size_t>> objectives {
+    {"reg:squarederror", kClasses}, {"reg:logistic", 2}, {"binary:logistic", 2},
+    {"binary:logitraw", 2}, {"count:poisson", kClasses}, {"survival:cox", kClasses},
+    {"reg:gamma", kClasses}, {"reg:tweedie", kClasses}, {"binary:hinge", 2},
+    {"multi:softprob", kClasses}, {"multi:softmax", kClasses}, {"rank:pairwise", 2}};
+  // expected outputs of option_mask 0 and 1 with all trees and with the first round
+  std::vector<std::vector<bst_float>> expected;
+  std::string sources;
+  for (size_t m = 0; m < objectives.size(); ++m) {
+    std::vector<Arg> args {Arg{"objective", objectives[m].first}};
+    if (objectives[m].first.find("multi:") == 0) {
+      args.emplace_back("num_class", std::to_string(kClasses));
+    }
+    std::vector<bst_float> labels(kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+      labels[i] = static_cast<bst_float>(i % objectives[m].second);
+    }
+    (*pp_mat)->Info().SetInfo("label", labels.data(), DataType::kFloat32, kRows);
+    std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*pp_mat};
+    auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+    learner->Configure(args);
+    learner->InitModel();
+    for (int i = 0; i < 3; ++i) {
+      learner->UpdateOneIter(i, (*pp_mat).get());
+    }
+    const std::string name = "Predict" + std::to_string(m);
+    const std::string path = tempdir.path + "/model" + std::to_string(m) + ".cc";
+    std::ofstream(path) << learner->CompileModel(name);
+    sources += " " + path;
+    driver << "extern \"C\" int " << name << "(void*, const float*, uint64_t, uint64_t, "
+           << "float, int, unsigned, uint64_t*, float*);\n";
+    for (unsigned ntree_limit : {0U, 1U}) {
+      for (bool margin : {false, true}) {
+        std::vector<bst_float> preds(kRows * kClasses);
+        preds.resize(learner->PredictRows(
+            ExternalRows::Dense(dense.data(), kRows, kCols,
+                                std::numeric_limits<bst_float>::quiet_NaN()),
+            margin, preds.data(), ntree_limit));
+        expected.push_back(preds);
+      }
+    }
+  }
+  driver << "typedef int (*Predict)(void*, const float*, uint64_t, uint64_t, "
+         << "float, int, unsigned, uint64_t*, float*);\n"
+         << "int main(int argc, char** argv) {\n"
+         << "  const Predict funcs[] = {";
+  for (size_t m = 0; m < objectives.size(); ++m) {
+    driver << "Predict" << m << ", ";
+  }
+  driver << "};\n"
+         << "  float out[" << kRows * kClasses << "];\n"
+         << "  FILE* fo = fopen(argv[1], \"wb\");\n"
+         << "  for (Predict func : funcs) {\n"
+         << "    for (unsigned ntree_limit = 0; ntree_limit < 2; ++ntree_limit) {\n"
+         << "      for (int option_mask = 0; option_mask < 2; ++option_mask) {\n"
+         << "        uint64_t len = 0;\n"
+         << "        if (func(nullptr, kData, " << kRows << ", " << kCols
+         << ", NAN, option_mask, ntree_limit, &len, out) != 0) return 1;\n"
+         << "        fwrite(&len, sizeof(len), 1, fo);\n"
+         << "        fwrite(out, sizeof(float), len, fo);\n"
+         << "      }\n"
+         << "    }\n"
+         << "  }\n"
+         << "  fclose(fo);\n"
+         << "  return 0;\n"
+         << "}\n";
+  driver.close();
+
+  const std::string binary = tempdir.path + "/driver";
+  const std::string output = tempdir.path + "/preds.bin";
+  ASSERT_EQ(std::system(("c++ -O2 -std=c++11 -o " + binary + sources + " " +
+                         tempdir.path + "/driver.cc").c_str()), 0);
+  ASSERT_EQ(std::system((binary + " " + output).c_str()), 0);
+
+  // the compiled models predict the same floats as the CPU predictor
+  std::ifstream fi(output, std::ios::binary);
+  for (size_t k = 0; k < expected.size(); ++k) {
+    const std::string& objective = objectives[k / 4].first;
+    const std::vector<bst_float>& preds = expected[k];
+    uint64_t len = 0;
+    fi.read(reinterpret_cast<char*>(&len), sizeof(len));
+    ASSERT_EQ(len, preds.size()) << objective;
+    std::vector<bst_float> compiled(len);
+    fi.read(reinterpret_cast<char*>(compiled.data()), sizeof(bst_float) * len);
+    ASSERT_TRUE(fi.good());
+    ASSERT_EQ(std::memcmp(compiled.data(), preds.data(), sizeof(bst_float) * len), 0)
+        << objective;
+  }
+
+  delete pp_mat;
+}
+
 TEST(Learner, SLOW_CheckMultiBatch) {
   using Arg = std::pair<std::string, std::string>;
   // Create sufficiently large data to make two row pages
@@ -0,0 +1,48 @@
+/*!
+ * Copyright 2019 by Contributors
+ */
+#include "../helpers.h"
+#include "../../../src/common/host_device_vector.h"
+#include <xgboost/tree_updater.h>
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace xgboost {
+namespace tree {
+
+TEST(Updater, ColMaker_CacheOpt) {
+  int constexpr kRows = 300, kCols = 8;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.3, 11);
+
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (int i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(static_cast<float>(i % 11) - 5.0f,
+                              0.5f + static_cast<float>(i % 3));
+  }
+
+  // the scans over the gathered row states must give the same tree as
+  // the plain per entry lookups
+  auto grow = [&](std::string cache_opt) {
+    std::vector<std::pair<std::string, std::string>> cfg
+        {{"num_feature", std::to_string(kCols)}, {"max_depth", "4"},
+         {"cache_opt", cache_opt}};
+    RegTree tree;
+    tree.param.InitAllowUnknown(cfg);
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_colmaker"));
+    updater->Init(cfg);
+    updater->Update(&gpair, dmat->get(), {&tree});
+    return tree;
+  };
+  RegTree expected = grow("0");
+  RegTree tree = grow("1");
+  ASSERT_GT(tree.NumExtraNodes(), 2);
+  ASSERT_TRUE(tree == expected);
+
+  delete dmat;
+}
+
+}  // namespace tree
+}  // namespace xgboost
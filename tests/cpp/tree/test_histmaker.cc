@@ -0,0 +1,81 @@
+/*!
+ * Copyright 2019 by Contributors
+ */
+#include "../helpers.h"
+#include "../../../src/common/host_device_vector.h"
+#include <xgboost/tree_updater.h>
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace xgboost {
+namespace tree {
+
+TEST(Updater, HistMaker_SketchReuse) {
+  int constexpr kRows = 200, kCols = 6, kTrees = 4;
+  auto dmat = CreateDMatrix(kRows, kCols, 0.2, 5);
+
+  // the gradients change with every tree; the hessians, which weight the
+  // sketch, are either spread over all rows or concentrated on the first half
+  auto make_gpair = [&](int tree, bool concentrated) {
+    std::vector<GradientPair> h_gpair(kRows);
+    for (int i = 0; i < kRows; ++i) {
+      float hess = concentrated ? (i < kRows / 2 ? 20.0f : 0.1f)
+                                : 1.0f + static_cast<float>(i % 4);
+      h_gpair[i] = GradientPair(static_cast<float>((i * (tree + 3)) % 9) - 4.0f, hess);
+    }
+    return h_gpair;
+  };
+
+  // the first tree is grown from `first`, the others from make_gpair(i, false)
+  auto grow = [&](std::string reuse_rounds, std::string colsample,
+                  std::vector<GradientPair> const& first) {
+    std::vector<std::pair<std::string, std::string>> cfg
+        {{"num_feature", std::to_string(kCols)}, {"max_depth", "3"},
+         {"sketch_reuse_rounds", reuse_rounds}, {"colsample_bytree", colsample}};
+    std::unique_ptr<TreeUpdater> updater(TreeUpdater::Create("grow_histmaker"));
+    updater->Init(cfg);
+    std::vector<RegTree> trees(kTrees);
+    for (int i = 0; i < kTrees; ++i) {
+      HostDeviceVector<GradientPair> gpair(i == 0 ? first : make_gpair(i, false));
+      trees[i].param.InitAllowUnknown(cfg);
+      updater->Update(&gpair, dmat->get(), {&trees[i]});
+    }
+    return trees;
+  };
+
+  auto fresh = grow("1", "1", make_gpair(0, false));
+  // the first tree of each run proposes from different hessians, trees 2..N
+  // keep its cuts
+  auto spread = grow(std::to_string(kTrees), "1", make_gpair(0, false));
+  auto concentrated = grow(std::to_string(kTrees), "1", make_gpair(0, true));
+  auto concentrated_other = grow(std::to_string(kTrees), "1", make_gpair(5, true));
+  for (int i = 0; i < kTrees; ++i) {
+    ASSERT_GT(fresh[i].NumExtraNodes(), 0);
+    // the hessians of the first tree equal those of the others
+    ASSERT_TRUE(spread[i] == fresh[i]);
+    if (i == 0) {
+      continue;
+    }
+    // the cuts of the first tree depend on its hessians only
+    ASSERT_FALSE(concentrated[i] == fresh[i]);
+    ASSERT_TRUE(concentrated[i] == concentrated_other[i]);
+  }
+
+  // the proposal expires after the given number of trees, counted once per tree
+  auto expiring = grow("2", "1", make_gpair(0, true));
+  ASSERT_TRUE(expiring[1] == concentrated[1]);
+  ASSERT_TRUE(expiring[2] == fresh[2]);
+  ASSERT_TRUE(expiring[3] == fresh[3]);
+
+  // features missing from the cache are proposed again
+  for (auto const& tree : grow("3", "0.5", make_gpair(0, false))) {
+    ASSERT_GT(tree.NumExtraNodes(), 0);
+  }
+
+  delete dmat;
+}
+
+}  // namespace tree
+}  // namespace xgboost
@@ -6,11 +6,16 @@
 #include "../../../src/tree/updater_quantile_hist.h"
 #include "../../../src/tree/split_evaluator.h"
 #include "../../../src/common/host_device_vector.h"
+#include "../../../src/common/random.h"
 
+#include <dmlc/omp.h>
+#include <xgboost/c_api.h>
 #include <xgboost/tree_updater.h>
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 #include <string>
 
@@ -91,6 +96,73 @@ class QuantileHistMock : public QuantileHistMaker {
       }
     }
 
+    void TestBootstrap(const GHistIndexMatrix& gmat,
+                       const std::vector<GradientPair>& gpair,
+                       const DMatrix& fmat,
+                       const RegTree& tree) {
+      const size_t num_row = fmat.Info().num_row_;
+      common::GlobalRandom().seed(17);
+      this->SetMaxThreads(1);
+      RealImpl::InitData(gmat, gpair, fmat, tree);
+      const std::vector<size_t> expected_rows = row_set_collection_.row_indices_;
+      const std::vector<uint8_t> expected_multiplicity = row_multiplicity_;
+
+      // The sample must not depend on the number of threads
+      common::GlobalRandom().seed(17);
+      this->SetMaxThreads(4);
+      RealImpl::InitData(gmat, gpair, fmat, tree);
+      ASSERT_EQ(row_set_collection_.row_indices_, expected_rows);
+      ASSERT_EQ(row_multiplicity_, expected_multiplicity);
+
+      // Sampled rows are drawn at least once, the others never
+      std::vector<bool> sampled(num_row, false);
+      size_t total = 0;
+      for (size_t rid : expected_rows) {
+        ASSERT_LT(rid, num_row);
+        ASSERT_FALSE(sampled[rid]);
+        sampled[rid] = true;
+        ASSERT_GE(expected_multiplicity[rid], 1);
+        total += expected_multiplicity[rid];
+      }
+      for (size_t rid = 0; rid < num_row; ++rid) {
+        if (!sampled[rid]) {
+          ASSERT_EQ(expected_multiplicity[rid], 0);
+        }
+      }
+      // Some rows are left out of the bag and the expected sample size is num_row
+      ASSERT_LT(expected_rows.size(), num_row);
+      ASSERT_NEAR(static_cast<double>(total), static_cast<double>(num_row), 0.1 * num_row);
+
+      // Every sampled row enters the histograms as many times as it is drawn
+      std::vector<GradientPairPrecise> histogram_expected(gmat.cut.row_ptr.back());
+      for (size_t rid : expected_rows) {
+        for (size_t i = gmat.row_ptr[rid]; i < gmat.row_ptr[rid + 1]; ++i) {
+          for (uint8_t k = 0; k < expected_multiplicity[rid]; ++k) {
+            histogram_expected[gmat.index[i]] += GradientPairPrecise(gpair[rid]);
+          }
+        }
+      }
+      ColumnMatrix column_matrix;
+      column_matrix.Init(gmat, param_.sparse_threshold);
+      const RowSetCollection::Elem root = row_set_collection_[0];
+      std::vector<GradStats> row_wise(histogram_expected.size());
+      std::vector<GradStats> column_wise(histogram_expected.size());
+      hist_builder_.BuildHist(
+          gpair, root, gmat,
+          {row_wise.data(), static_cast<GHistRow::index_type>(row_wise.size())},
+          row_multiplicity_.data());
+      hist_builder_.BuildHistColumnWise(
+          gpair, root, column_matrix,
+          {column_wise.data(), static_cast<GHistRow::index_type>(column_wise.size())},
+          row_multiplicity_.data());
+      for (size_t i = 0; i < histogram_expected.size(); ++i) {
+        ASSERT_EQ(histogram_expected[i].GetGrad(), row_wise[i].GetGrad());
+        ASSERT_EQ(histogram_expected[i].GetHess(), row_wise[i].GetHess());
+        ASSERT_EQ(histogram_expected[i].GetGrad(), column_wise[i].GetGrad());
+        ASSERT_EQ(histogram_expected[i].GetHess(), column_wise[i].GetHess());
+      }
+    }
+
     void TestBuildHist(int nid,
                        const GHistIndexMatrix& gmat,
                        const DMatrix& fmat,
@@ -100,9 +172,11 @@ class QuantileHistMock : public QuantileHistMaker {
             {0.27f, 0.29f}, {0.37f, 0.39f}, {0.47f, 0.49f}, {0.57f, 0.59f} };
       RealImpl::InitData(gmat, gpair, fmat, tree);
       GHistIndexBlockMatrix dummy;
+      ColumnMatrix column_matrix;
+      column_matrix.Init(gmat, param_.sparse_threshold);
       hist_.AddHistRow(nid);
       BuildHist(gpair, row_set_collection_[nid],
-                gmat, dummy, hist_[nid], false);
+                gmat, dummy, column_matrix, hist_[nid], false);
 
       // Check if number of histogram bins is correct
       ASSERT_EQ(hist_[nid].size(), gmat.cut.row_ptr.back());
@@ -126,6 +200,21 @@ class QuantileHistMock : public QuantileHistMaker {
         ASSERT_NEAR(sol.GetGrad(), hist_[nid][i].GetGrad(), kEps);
         ASSERT_NEAR(sol.GetHess(), hist_[nid][i].GetHess(), kEps);
       }
+
+      // The column-wise builder must agree, for sparse and for dense columns
+      for (double sparse_threshold : {1.0, 0.0}) {
+        ColumnMatrix columns;
+        columns.Init(gmat, sparse_threshold);
+        std::vector<GradStats> column_wise(hist_[nid].size());
+        hist_builder_.BuildHistColumnWise(
+            gpair, row_set_collection_[nid], columns,
+            {column_wise.data(), static_cast<GHistRow::index_type>(column_wise.size())});
+        for (size_t i = 0; i < column_wise.size(); ++i) {
+          GradientPairPrecise sol = histogram_expected[i];
+          ASSERT_NEAR(sol.GetGrad(), column_wise[i].GetGrad(), kEps);
+          ASSERT_NEAR(sol.GetHess(), column_wise[i].GetHess(), kEps);
+        }
+      }
     }
 
     void TestEvaluateSplit(const GHistIndexBlockMatrix& quantile_index_block,
@@ -143,8 +232,10 @@ class QuantileHistMock : public QuantileHistMaker {
       RealImpl::InitData(gmat, row_gpairs, *(*dmat), tree);
       hist_.AddHistRow(0);
 
+      ColumnMatrix column_matrix;
+      column_matrix.Init(gmat, param_.sparse_threshold);
       BuildHist(row_gpairs, row_set_collection_[0],
-                gmat, quantile_index_block, hist_[0], false);
+                gmat, quantile_index_block, column_matrix, hist_[0], false);
 
       RealImpl::InitNewNode(0, gmat, row_gpairs, *(*dmat), tree);
 
@@ -261,6 +352,24 @@ class QuantileHistMock : public QuantileHistMaker {
     builder_->TestBuildHist(0, gmat, *(*dmat_).get(), tree);
   }
 
+  void TestBootstrap() {
+    size_t constexpr kRows = 5000, kCols = 4, kMaxBins = 4;
+    auto pp_dmat = CreateDMatrix(kRows, kCols, 0, 5);
+    common::GHistIndexMatrix gmat;
+    gmat.Init((*pp_dmat).get(), kMaxBins);
+
+    RegTree tree = RegTree();
+    tree.param.InitAllowUnknown(cfg_);
+
+    std::vector<GradientPair> gpair(kRows);
+    for (size_t i = 0; i < kRows; ++i) {
+      gpair[i] = GradientPair(static_cast<float>(i % 5) - 2.0f, 0.5f);
+    }
+
+    builder_->TestBootstrap(gmat, gpair, *(*pp_dmat).get(), tree);
+    delete pp_dmat;
+  }
+
   void TestEvaluateSplit() {
     RegTree tree = RegTree();
     tree.param.InitAllowUnknown(cfg_);
@@ -285,6 +394,244 @@ TEST(Updater, QuantileHist_BuildHist) {
   maker.TestBuildHist();
 }
 
+TEST(Updater, QuantileHist_Bootstrap) {
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", "4"}, {"bootstrap", "1"}};
+  QuantileHistMock maker(cfg);
+  maker.TestBootstrap();
+}
+
+TEST(Updater, QuantileHist_FeatureBundling) {
+  // a one-hot encoded variable with explicit zeros, a sparse categorical and
+  // a sparse numeric feature that never share a row, and a numeric column
+  size_t constexpr kRows = 128, kCategories = 8, kCols = kCategories + 3;
+  int constexpr kGroups = 2;
+  const float kNaN = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data(kRows * kCols, 0.0f);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  HostDeviceVector<GradientPair> gpair_multi(kRows * kGroups);
+  for (size_t i = 0; i < kRows; ++i) {
+    const size_t cat = (i * 5) % kCategories;
+    data[i * kCols + cat] = 1.0f;
+    data[i * kCols + kCategories] = i % 4 == 0 ? static_cast<float>(i % 7) : kNaN;
+    data[i * kCols + kCategories + 1] = i % 4 == 1 ? static_cast<float>(i % 5) : kNaN;
+    data[i * kCols + kCategories + 2] = static_cast<float>(i % 13);
+    // integral gradients, so that the sums do not depend on their order
+    const GradientPair g(static_cast<float>(cat % 3) + static_cast<float>(i % 13 > 6) +
+                         (i % 4 == 0 ? static_cast<float>(i % 7) : 0.0f) - 2.0f, 1.0f);
+    gpair.HostVector()[i] = g;
+    for (int k = 0; k < kGroups; ++k) {
+      gpair_multi.HostVector()[i * kGroups + k] = g;
+    }
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), kRows, kCols, kNaN, &handle);
+  std::vector<unsigned> feature_type(kCols, 0);
+  feature_type[kCategories] = 1;
+  XGDMatrixSetUIntInfo(handle, "feature_type", feature_type.data(), kCols);
+  auto pp_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+
+  auto grow = [&](std::string bundling, std::string method, int ngroup) {
+    std::vector<std::pair<std::string, std::string>> cfg
+        {{"num_feature", std::to_string(kCols)}, {"max_depth", "4"},
+         {"min_child_weight", "0"}, {"enable_feature_bundling", bundling},
+         {"hist_build_method", method}};
+    RegTree tree;
+    tree.param.InitAllowUnknown(cfg);
+    tree.param.size_leaf_vector = ngroup == 1 ? 0 : ngroup;
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker"));
+    updater->Init(cfg);
+    updater->Update(ngroup == 1 ? &gpair : &gpair_multi, (*pp_dmat).get(), {&tree});
+    return tree;
+  };
+  auto expect_equal = [](const RegTree& tree, const RegTree& expected) {
+    ASSERT_GT(tree.NumExtraNodes(), 0);
+    ASSERT_EQ(tree.param.num_nodes, expected.param.num_nodes);
+    for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+      ASSERT_EQ(tree[nid].IsLeaf(), expected[nid].IsLeaf());
+      if (tree[nid].IsLeaf()) {
+        ASSERT_NEAR(tree[nid].LeafValue(), expected[nid].LeafValue(), 1e-5);
+        for (int k = 0; k < tree.param.size_leaf_vector; ++k) {
+          ASSERT_NEAR(tree.LeafVector(nid)[k], expected.LeafVector(nid)[k], 1e-5);
+        }
+      } else {
+        ASSERT_EQ(tree[nid].SplitIndex(), expected[nid].SplitIndex());
+        ASSERT_EQ(tree[nid].DefaultLeft(), expected[nid].DefaultLeft());
+        ASSERT_EQ(tree.IsCategorical(nid), expected.IsCategorical(nid));
+        if (tree.IsCategorical(nid)) {
+          ASSERT_EQ(tree.NodeCategories(nid), expected.NodeCategories(nid));
+        } else {
+          ASSERT_EQ(tree[nid].SplitCond(), expected[nid].SplitCond());
+        }
+      }
+    }
+  };
+
+  // the bundles are exclusive, so the trees are the same as without them
+  RegTree expected = grow("0", "rowwise", 1);
+  for (auto method : {"rowwise", "colwise"}) {
+    expect_equal(grow("1", method, 1), expected);
+  }
+  expect_equal(grow("1", "auto", kGroups), grow("0", "auto", kGroups));
+
+  delete pp_dmat;
+}
+
+TEST(Updater, QuantileHist_CategoricalSplit) {
+  // the gradient depends on an unordered subset of the categories
+  size_t constexpr kRows = 120, kCols = 2, kCategories = 10;
+  std::vector<float> data(kRows * kCols);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  auto in_set = [](size_t cat) { return cat == 1 || cat == 4 || cat == 7; };
+  for (size_t i = 0; i < kRows; ++i) {
+    const size_t cat = (i * 7) % kCategories;
+    data[i * kCols] = static_cast<float>(cat);
+    data[i * kCols + 1] = static_cast<float>(i % 5);
+    h_gpair[i] = GradientPair(in_set(cat) ? -1.0f : 1.0f, 1.0f);
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), kRows, kCols,
+                         std::numeric_limits<float>::quiet_NaN(), &handle);
+  std::vector<unsigned> feature_type {1, 0};
+  XGDMatrixSetUIntInfo(handle, "feature_type", feature_type.data(), kCols);
+  auto pp_dmat = static_cast<std::shared_ptr<DMatrix>*>(handle);
+  ASSERT_TRUE((*pp_dmat)->Info().IsCategorical(0));
+  ASSERT_FALSE((*pp_dmat)->Info().IsCategorical(1));
+
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(kCols)}, {"max_depth", "1"},
+       {"reg_lambda", "0"}};
+  RegTree tree;
+  tree.param.InitAllowUnknown(cfg);
+  std::unique_ptr<TreeUpdater> updater(
+      TreeUpdater::Create("grow_quantile_histmaker"));
+  updater->Init(cfg);
+  updater->Update(&gpair, (*pp_dmat).get(), {&tree});
+
+  ASSERT_TRUE(tree.IsCategorical(0));
+  ASSERT_EQ(tree[0].SplitIndex(), 0);
+  ASSERT_EQ(tree.NodeCategories(0), std::vector<uint32_t>({1, 4, 7}));
+  // one split separates the two gradient groups
+  for (size_t cat = 0; cat < kCategories; ++cat) {
+    const int leaf = tree.GetNext(0, static_cast<float>(cat), false);
+    ASSERT_EQ(leaf, in_set(cat) ? tree[0].LeftChild() : tree[0].RightChild());
+    ASSERT_EQ(tree[leaf].LeafValue() > 0, in_set(cat));
+  }
+
+  delete pp_dmat;
+}
+
+TEST(Updater, QuantileHist_EvalPredictionCache) {
+  // feature 0 is categorical, the evaluation rows hold values outside of the
+  // training range, unknown and negative categories and missing values
+  size_t constexpr kRows = 200, kCols = 4, kCategories = 6;
+  auto make_dmat = [&](size_t nrows, float scale, float shift, bool train) {
+    std::vector<float> data(nrows * kCols);
+    for (size_t i = 0; i < nrows; ++i) {
+      data[i * kCols] = train ? static_cast<float>(i % kCategories)
+                              : static_cast<float>(i % (kCategories + 3)) - 1.5f;
+      for (size_t j = 1; j < kCols; ++j) {
+        data[i * kCols + j] = (i * (j + 3)) % 17 == 0
+            ? std::numeric_limits<float>::quiet_NaN()
+            : static_cast<float>((i * 31 + j * 7) % 23) * scale + shift;
+      }
+    }
+    DMatrixHandle handle;
+    XGDMatrixCreateFromMat(data.data(), nrows, kCols,
+                           std::numeric_limits<float>::quiet_NaN(), &handle);
+    std::vector<unsigned> feature_type {1, 0, 0, 0};
+    XGDMatrixSetUIntInfo(handle, "feature_type", feature_type.data(), kCols);
+    return static_cast<std::shared_ptr<DMatrix>*>(handle);
+  };
+  auto pp_train = make_dmat(kRows, 1.0f, 0.0f, true);
+  auto pp_eval = make_dmat(kRows / 2, 1.3f, -3.0f, false);
+
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(static_cast<float>((i * 13) % 7) - 3.0f, 1.0f);
+  }
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(kCols)}, {"max_depth", "4"},
+       {"reg_lambda", "0"}, {"min_child_weight", "0"}};
+  RegTree tree;
+  tree.param.InitAllowUnknown(cfg);
+  std::unique_ptr<TreeUpdater> updater(
+      TreeUpdater::Create("grow_quantile_histmaker"));
+  updater->Init(cfg);
+  updater->Update(&gpair, (*pp_train).get(), {&tree});
+  ASSERT_GT(tree.NumExtraNodes(), 0);
+  bool has_categorical = false;
+  for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+    has_categorical = has_categorical || tree.IsCategorical(nid);
+  }
+  ASSERT_TRUE(has_categorical);
+
+  // quantized routing gives the leaves of the floating-point traversal
+  DMatrix* eval = (*pp_eval).get();
+  HostDeviceVector<bst_float> preds(eval->Info().num_row_, 1.0f);
+  ASSERT_TRUE(updater->UpdatePredictionCache(eval, &preds));
+  RegTree::FVec feats;
+  feats.Init(kCols);
+  for (const auto &batch : eval->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      feats.Fill(batch[i]);
+      const int leaf = tree.GetLeafIndex(feats, 0);
+      feats.Drop(batch[i]);
+      ASSERT_FLOAT_EQ(preds.HostVector()[batch.base_rowid + i],
+                      1.0f + tree[leaf].LeafValue());
+    }
+  }
+
+  delete pp_train;
+  delete pp_eval;
+}
+
+TEST(Updater, QuantileHist_EvalPredictionCacheLayout) {
+  // 8-bit and 16-bit bins, dense and sparse evaluation rows
+  size_t constexpr kRows = 400, kCols = 32;
+  auto pp_train = CreateDMatrix(kRows, kCols, 0, 3);
+  HostDeviceVector<GradientPair> gpair(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    gpair.HostVector()[i] = GradientPair(static_cast<float>((i * 13) % 7) - 3.0f, 1.0f);
+  }
+  for (const char* max_bin : {"16", "512"}) {
+    std::vector<std::pair<std::string, std::string>> cfg
+        {{"num_feature", std::to_string(kCols)}, {"max_depth", "6"},
+         {"max_bin", max_bin}, {"min_child_weight", "0"}};
+    RegTree tree;
+    tree.param.InitAllowUnknown(cfg);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker"));
+    updater->Init(cfg);
+    updater->Update(&gpair, (*pp_train).get(), {&tree});
+    ASSERT_GT(tree.NumExtraNodes(), 0);
+    // the second matrix may take the address of the first one
+    for (float sparsity : {0.0f, 0.9f}) {
+      auto pp_eval = CreateDMatrix(kRows / 2, kCols, sparsity, 5);
+      DMatrix* eval = (*pp_eval).get();
+      HostDeviceVector<bst_float> preds(eval->Info().num_row_, 1.0f);
+      ASSERT_TRUE(updater->UpdatePredictionCache(eval, &preds));
+      RegTree::FVec feats;
+      feats.Init(kCols);
+      for (const auto &batch : eval->GetRowBatches()) {
+        for (size_t i = 0; i < batch.Size(); ++i) {
+          feats.Fill(batch[i]);
+          const int leaf = tree.GetLeafIndex(feats, 0);
+          feats.Drop(batch[i]);
+          ASSERT_FLOAT_EQ(preds.HostVector()[batch.base_rowid + i],
+                          1.0f + tree[leaf].LeafValue())
+              << "max_bin=" << max_bin << " sparsity=" << sparsity;
+        }
+      }
+      delete pp_eval;
+    }
+  }
+  delete pp_train;
+}
+
 TEST(Updater, QuantileHist_EvalSplits) {
   std::vector<std::pair<std::string, std::string>> cfg
       {{"num_feature", std::to_string(QuantileHistMock::GetNumColumns())},
@@ -295,5 +642,176 @@ TEST(Updater, QuantileHist_EvalSplits) {
   maker.TestEvaluateSplit();
 }
 
+TEST(Updater, QuantileHist_ConcurrentTrees) {
+  size_t constexpr kRows = 64, kCols = 8, kTrees = 4;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.2, 7);
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(kCols)}, {"max_depth", "3"}};
+
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(static_cast<float>(i % 7) - 3.0f, 1.0f);
+  }
+
+  auto grow = [&](std::vector<RegTree>* p_trees) {
+    std::vector<RegTree*> trees;
+    for (auto& tree : *p_trees) {
+      tree.param.InitAllowUnknown(cfg);
+      trees.push_back(&tree);
+    }
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker"));
+    updater->Init(cfg);
+    updater->Update(&gpair, (*pp_dmat).get(), trees);
+  };
+
+  // with and without row subsampling, which must not depend on the path
+  for (const char* subsample : {"1", "0.5"}) {
+    cfg.emplace_back("subsample", subsample);
+    // reference: grown one after another by a single thread
+    std::vector<RegTree> expected(kTrees);
+    const int nthread = omp_get_max_threads();
+    omp_set_num_threads(1);
+    common::GlobalRandom().seed(11);
+    grow(&expected);
+    omp_set_num_threads(std::max(nthread, 2));
+    std::vector<RegTree> trees(kTrees);
+    common::GlobalRandom().seed(11);
+    grow(&trees);
+    omp_set_num_threads(nthread);
+
+    for (size_t i = 0; i < kTrees; ++i) {
+      ASSERT_GT(trees[i].NumExtraNodes(), 0);
+      ASSERT_TRUE(trees[i] == expected[i]) << "subsample=" << subsample;
+    }
+    cfg.pop_back();
+  }
+
+  delete pp_dmat;
+}
+
+TEST(Updater, QuantileHist_BuildMethod) {
+  size_t constexpr kRows = 256, kCols = 16;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0.3, 5);
+  // integral gradients sum exactly in any order, so both methods must agree
+  HostDeviceVector<GradientPair> gpair(kRows);
+  auto& h_gpair = gpair.HostVector();
+  for (size_t i = 0; i < kRows; ++i) {
+    h_gpair[i] = GradientPair(static_cast<float>(i % 5) - 2.0f, 1.0f);
+  }
+
+  auto grow = [&](const char* method) {
+    std::vector<std::pair<std::string, std::string>> cfg
+        {{"num_feature", std::to_string(kCols)}, {"max_depth", "4"},
+         {"hist_build_method", method}};
+    RegTree tree;
+    tree.param.InitAllowUnknown(cfg);
+    std::unique_ptr<TreeUpdater> updater(
+        TreeUpdater::Create("grow_quantile_histmaker"));
+    updater->Init(cfg);
+    updater->Update(&gpair, (*pp_dmat).get(), {&tree});
+    return tree;
+  };
+
+  const int nthread = omp_get_max_threads();
+  omp_set_num_threads(std::max(nthread, 2));
+  RegTree row_wise = grow("rowwise");
+  RegTree column_wise = grow("colwise");
+  omp_set_num_threads(nthread);
+  ASSERT_GT(row_wise.NumExtraNodes(), 0);
+  ASSERT_TRUE(row_wise == column_wise);
+
+  delete pp_dmat;
+}
+
+TEST(Updater, QuantileHist_MultiOutputTree) {
+  size_t constexpr kRows = 128, kCols = 6;
+  int constexpr kGroups = 2;
+  auto pp_dmat = CreateDMatrix(kRows, kCols, 0, 3);
+  DMatrix* dmat = (*pp_dmat).get();
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(kCols)}, {"max_depth", "3"},
+       {"min_child_weight", "0"}};
+
+  // every group sees the gradient of the scalar tree, so the vector tree
+  // partitions the rows alike and carries the scalar leaf in each slot
+  HostDeviceVector<GradientPair> gpair(kRows);
+  HostDeviceVector<GradientPair> gpair_multi(kRows * kGroups);
+  for (size_t i = 0; i < kRows; ++i) {
+    GradientPair g(static_cast<float>((i * 5) % 11) - 5.0f, 1.0f);
+    gpair.HostVector()[i] = g;
+    for (int k = 0; k < kGroups; ++k) {
+      gpair_multi.HostVector()[i * kGroups + k] = g;
+    }
+  }
+
+  RegTree expected;
+  expected.param.InitAllowUnknown(cfg);
+  std::unique_ptr<TreeUpdater> scalar(
+      TreeUpdater::Create("grow_quantile_histmaker"));
+  scalar->Init(cfg);
+  scalar->Update(&gpair, dmat, {&expected});
+
+  RegTree tree;
+  tree.param.InitAllowUnknown(cfg);
+  tree.param.size_leaf_vector = kGroups;
+  std::unique_ptr<TreeUpdater> updater(
+      TreeUpdater::Create("grow_quantile_histmaker"));
+  updater->Init(cfg);
+  updater->Update(&gpair_multi, dmat, {&tree});
+
+  ASSERT_GT(tree.NumExtraNodes(), 0);
+  ASSERT_EQ(tree.param.num_nodes, expected.param.num_nodes);
+  RegTree::FVec feats;
+  feats.Init(kCols);
+  for (const auto &batch : dmat->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      feats.Fill(batch[i]);
+      const bst_float* leaf = tree.LeafVector(tree.GetLeafIndex(feats, 0));
+      const bst_float value = expected[expected.GetLeafIndex(feats, 0)].LeafValue();
+      feats.Drop(batch[i]);
+      for (int k = 0; k < kGroups; ++k) {
+        ASSERT_NEAR(leaf[k], value, kRtEps);
+      }
+    }
+  }
+
+  // the prediction cache adds the leaf vector of each row's leaf
+  HostDeviceVector<bst_float> preds(kRows * kGroups, 0.5f);
+  ASSERT_TRUE(updater->UpdatePredictionCache(dmat, &preds));
+  for (const auto &batch : dmat->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      feats.Fill(batch[i]);
+      const int leaf = tree.GetLeafIndex(feats, 0);
+      feats.Drop(batch[i]);
+      const size_t ridx = batch.base_rowid + i;
+      for (int k = 0; k < kGroups; ++k) {
+        ASSERT_FLOAT_EQ(preds.HostVector()[ridx * kGroups + k],
+                        0.5f + tree.LeafVector(leaf)[k]);
+      }
+    }
+  }
+
+  // rows with a negative hessian stay out of the tree and keep their prediction
+  for (size_t i = 0; i < kRows; i += 9) {
+    gpair_multi.HostVector()[i * kGroups] = GradientPair(1.0f, -1.0f);
+  }
+  RegTree partial;
+  partial.param.InitAllowUnknown(cfg);
+  partial.param.size_leaf_vector = kGroups;
+  updater->Update(&gpair_multi, dmat, {&partial});
+  ASSERT_GT(partial.NumExtraNodes(), 0);
+  preds.HostVector().assign(kRows * kGroups, 0.5f);
+  ASSERT_TRUE(updater->UpdatePredictionCache(dmat, &preds));
+  for (size_t i = 0; i < kRows; i += 9) {
+    for (int k = 0; k < kGroups; ++k) {
+      ASSERT_EQ(preds.HostVector()[i * kGroups + k], 0.5f);
+    }
+  }
+
+  delete pp_dmat;
+}
+
 }  // namespace tree
 }  // namespace xgboost
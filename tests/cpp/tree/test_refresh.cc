@@ -49,5 +49,67 @@ TEST(Updater, Refresh) {
   delete dmat;
 }
 
+TEST(Updater, RefreshManyTrees) {
+  int constexpr kNRows = 37, kNCols = 8, kNTrees = 3;
+
+  std::vector<GradientPair> h_gpair(kNRows);
+  for (int i = 0; i < kNRows; ++i) {
+    h_gpair[i] = GradientPair(static_cast<float>(i % 5) - 2.0f, 1.0f + i % 3);
+  }
+  HostDeviceVector<GradientPair> gpair(h_gpair);
+  auto dmat = CreateDMatrix(kNRows, kNCols, 0, 3);
+  std::vector<std::pair<std::string, std::string>> cfg {
+    {"num_feature", std::to_string(kNCols)},
+    {"learning_rate", "1"},
+    {"reg_lambda", "1"}};
+
+  auto make_tree = [&](int fidx) {
+    RegTree tree;
+    tree.param.InitAllowUnknown(cfg);
+    tree.ExpandNode(0, fidx, 0.5f, false, 0.0, 0.0f, 0.0f, 0.0f, 0.0f);
+    tree.ExpandNode(tree[0].LeftChild(), fidx + 1, 0.3f, true,
+                    0.0, 0.0f, 0.0f, 0.0f, 0.0f);
+    return tree;
+  };
+
+  // all trees refreshed together, with the learning rate shared among them
+  std::vector<RegTree> together, alone;
+  std::vector<RegTree*> p_together;
+  for (int t = 0; t < kNTrees; ++t) {
+    together.push_back(make_tree(t));
+    alone.push_back(make_tree(t));
+  }
+  for (auto& tree : together) {
+    p_together.push_back(&tree);
+  }
+  std::unique_ptr<TreeUpdater> refresher(TreeUpdater::Create("refresh"));
+  auto cfg_together = cfg;
+  cfg_together[1].second = std::to_string(kNTrees);
+  refresher->Init(cfg_together);
+  refresher->Update(&gpair, dmat->get(), p_together);
+
+  for (auto& tree : alone) {
+    std::unique_ptr<TreeUpdater> single(TreeUpdater::Create("refresh"));
+    single->Init(cfg);
+    single->Update(&gpair, dmat->get(), {&tree});
+  }
+
+  for (int t = 0; t < kNTrees; ++t) {
+    ASSERT_EQ(together[t].param.num_nodes, alone[t].param.num_nodes);
+    for (int nid = 0; nid < together[t].param.num_nodes; ++nid) {
+      ASSERT_FLOAT_EQ(together[t].Stat(nid).sum_hess,
+                      alone[t].Stat(nid).sum_hess);
+      ASSERT_FLOAT_EQ(together[t].Stat(nid).loss_chg,
+                      alone[t].Stat(nid).loss_chg);
+      if (together[t][nid].IsLeaf()) {
+        ASSERT_FLOAT_EQ(together[t][nid].LeafValue(),
+                        alone[t][nid].LeafValue());
+      }
+    }
+  }
+
+  delete dmat;
+}
+
 }  // namespace tree
 }  // namespace xgboost
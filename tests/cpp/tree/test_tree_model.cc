@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 #include <xgboost/tree_model.h>
 #include "../helpers.h"
+#include "../../../src/common/io.h"
 #include "dmlc/filesystem.h"
 
 namespace xgboost {
@@ -21,7 +22,7 @@ TEST(Tree, Load) {
   int max_depth = 1;
   int num_feature = 0;
   int size_leaf_vector = 0;
-  int reserved[31];
+  int reserved[31] = {0};
   fo->Write(&num_roots, sizeof(int));
   fo->Write(&num_nodes, sizeof(int));
   fo->Write(&num_deleted, sizeof(int));
@@ -101,4 +102,68 @@ TEST(Tree, AllocateNode) {
   ASSERT_TRUE(nodes.at(1).IsLeaf());
   ASSERT_TRUE(nodes.at(2).IsLeaf());
 }
+
+TEST(Tree, CategoricalSplit) {
+  RegTree tree;
+  tree.ExpandCategoricalNode(
+      0, 2, {1, 33}, true, 0.0f, -1.0f, 1.0f, 1.0f, 4.0f);
+  tree.ExpandNode(
+      tree[0].RightChild(), 0, 0.5f, false, 0.0f, 2.0f, 3.0f, 1.0f, 2.0f);
+  ASSERT_TRUE(tree.IsCategorical(0));
+  ASSERT_FALSE(tree.IsCategorical(tree[0].RightChild()));
+  ASSERT_EQ(tree.NodeCategories(0), std::vector<uint32_t>({1, 33}));
+
+  ASSERT_EQ(tree.GetNext(0, 1.0f, false), tree[0].LeftChild());
+  ASSERT_EQ(tree.GetNext(0, 33.0f, false), tree[0].LeftChild());
+  ASSERT_EQ(tree.GetNext(0, 2.0f, false), tree[0].RightChild());
+  ASSERT_EQ(tree.GetNext(0, 100.0f, false), tree[0].RightChild());
+  ASSERT_EQ(tree.GetNext(0, -1.0f, false), tree[0].RightChild());
+  ASSERT_EQ(tree.GetNext(0, 2.0f, true), tree[0].LeftChild());
+
+  std::string str = tree.DumpModel(FeatureMap(), false, "text");
+  ASSERT_NE(str.find("0:[f2:{1,33}] yes=1,no=2,missing=1"), std::string::npos);
+
+  std::string source = tree.CompileModel("T", 0);
+  ASSERT_EQ(source.find("const uint32_t TCategories[] = {1, 33};\n"), 0);
+  ASSERT_NE(source.find("  if (!std::isnan(fvalue[2]) && "
+                        "!InCategories(fvalue[2], TCategories + 0, TCategories + 2)) goto n2;"),
+            std::string::npos);
+  ASSERT_NE(source.find(" n2:\n  if (!(fvalue[0] < 0.5f)) goto n4;"), std::string::npos);
+
+  std::string buffer;
+  common::MemoryBufferStream fo(&buffer);
+  tree.Save(&fo);
+  RegTree loaded;
+  common::MemoryBufferStream fi(&buffer);
+  loaded.Load(&fi);
+  ASSERT_TRUE(loaded == tree);
+  ASSERT_EQ(loaded.param.num_category_words, 2);
+  ASSERT_EQ(loaded.NodeCategories(0), std::vector<uint32_t>({1, 33}));
+
+  tree.CollapseToLeaf(0, 0.0f);
+  ASSERT_FALSE(tree.IsCategorical(0));
+}
+TEST(Tree, LeafVector) {
+  RegTree tree;
+  tree.param.size_leaf_vector = 3;
+  tree.ExpandNode(
+      0, 1, 0.5f, true, 0.0f, 0.0f, 0.0f, 1.0f, 2.0f);
+  const bst_float left[] = {0.1f, -0.2f, 0.3f};
+  const bst_float right[] = {-1.0f, 2.0f, 0.0f};
+  tree.SetLeafVector(tree[0].LeftChild(), left);
+  tree.SetLeafVector(tree[0].RightChild(), right);
+  ASSERT_EQ(tree.LeafVector(tree[0].RightChild())[1], 2.0f);
+
+  std::string str = tree.DumpModel(FeatureMap(), false, "text");
+  ASSERT_NE(str.find("leaf=[-1,2,0]"), std::string::npos);
+
+  std::string buffer;
+  common::MemoryBufferStream fo(&buffer);
+  tree.Save(&fo);
+  RegTree loaded;
+  common::MemoryBufferStream fi(&buffer);
+  loaded.Load(&fi);
+  ASSERT_TRUE(loaded == tree);
+  ASSERT_EQ(loaded.LeafVector(loaded[0].LeftChild())[2], 0.3f);
+}
 }  // namespace xgboost
@@ -11,3 +11,6 @@ $submit --cluster=local --num-workers=3 python test_basic.py
 
 echo "====== 2. Regression test for issue #3402 ======"
 $submit --cluster=local --num-workers=2 --worker-cores=1 python test_issue3402.py
+
+echo "====== 3. Compressed histogram allreduce with tree_method=hist ======"
+$submit --cluster=local --num-workers=3 python test_hist_sync.py
@@ -0,0 +1,31 @@
+#!/usr/bin/python
+import numpy as np
+import xgboost as xgb
+
+# Train with tree_method=hist for every histogram allreduce encoding and check
+# that the compressed ones reach the accuracy of the exact one.  Rounding may
+# break near-ties between splits differently, so predictions are not compared.
+# Run by runtests.sh with three workers under the dmlc tracker.
+xgb.rabit.init()
+
+dtrain = xgb.DMatrix('../../demo/data/agaricus.txt.train')
+dtest = xgb.DMatrix('../../demo/data/agaricus.txt.test')
+
+labels = dtest.get_label()
+errors = {}
+for precision in ['double', 'float', 'int']:
+    param = {'max_depth': 4, 'eta': 0.3, 'silent': 1,
+             'objective': 'binary:logistic', 'tree_method': 'hist',
+             'hist_sync_precision': precision}
+    bst = xgb.train(param, dtrain, 10)
+    preds = bst.predict(dtest)
+    errors[precision] = np.mean((preds > 0.5) != (labels > 0.5))
+
+for precision in ['float', 'int']:
+    assert abs(errors[precision] - errors['double']) < 0.01, \
+        '%s: test error %f, exact %f' % (precision, errors[precision], errors['double'])
+
+if xgb.rabit.get_rank() == 0:
+    xgb.rabit.tracker_print("Finished training\n")
+
+xgb.rabit.finalize()